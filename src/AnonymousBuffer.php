@@ -0,0 +1,110 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use InvalidArgumentException;
+use RuntimeException;
+
+/**
+ * A LinearBuffer on anonymous memory from mmap(2), optionally on huge pages.
+ *
+ * The memory is page aligned and zero filled. Its pages are placed on a
+ * NUMA node when they are first touched; see MemoryAllocator.
+ * A shared buffer is mapped with MAP_SHARED, so that forked processes
+ * write to the same memory; see ExecutionQueue.
+ */
+class AnonymousBuffer extends NativeBuffer
+{
+    const HUGEPAGES_NONE = 0;
+    // madvise(MADV_HUGEPAGE); a hint ignored where transparent huge pages are off
+    const HUGEPAGES_TRANSPARENT = 1;
+    // MAP_HUGETLB; needs pages reserved with vm.nr_hugepages
+    const HUGEPAGES_EXPLICIT = 2;
+
+    const DEFAULT_HUGE_PAGE_SIZE = 2097152;
+
+    protected const MAP_ANONYMOUS = [
+        'Linux' => 0x20,
+        'Darwin' => 0x1000,
+    ];
+    // Linux only
+    protected const MAP_HUGETLB = 0x40000;
+    protected const MADV_HUGEPAGE = 14;
+
+    protected int $hugePages;
+
+    public function __construct(
+        int $size,
+        int $dtype,
+        int $hugePages=self::HUGEPAGES_NONE,
+        bool $shared=false,
+        )
+    {
+        $valueSize = static::valueSizeOf($dtype);
+        if($size<1) {
+            throw new InvalidArgumentException('Argument size must be greater than 0.');
+        }
+        $libc = static::libc();
+        $bytes = $size*$valueSize;
+        $length = $bytes;
+        $flags = ($shared ? self::MAP_SHARED : self::MAP_PRIVATE)|self::MAP_ANONYMOUS[PHP_OS];
+        switch($hugePages) {
+            case self::HUGEPAGES_NONE:
+            case self::HUGEPAGES_TRANSPARENT: {
+                break;
+            }
+            case self::HUGEPAGES_EXPLICIT: {
+                if(PHP_OS!=='Linux') {
+                    throw new RuntimeException('Explicit huge pages are only supported on Linux.');
+                }
+                $pageSize = static::hugePageSize();
+                $length = intdiv($bytes+$pageSize-1, $pageSize)*$pageSize;
+                $flags |= self::MAP_HUGETLB;
+                break;
+            }
+            default: {
+                throw new InvalidArgumentException("unknown huge page mode: {$hugePages}");
+            }
+        }
+        $mapping = $libc->mmap(null, $length, self::PROT_READ|self::PROT_WRITE, $flags, -1, 0);
+        if(static::isMapFailed($mapping)) {
+            if($hugePages==self::HUGEPAGES_EXPLICIT) {
+                throw new RuntimeException("Cannot allocate {$length} bytes of huge pages. Reserve them with vm.nr_hugepages.");
+            }
+            throw new RuntimeException("Cannot allocate {$length} bytes.");
+        }
+        $this->attach($mapping, $length, 0, $dtype, $size, true, $shared);
+        $this->hugePages = $hugePages;
+        if($hugePages==self::HUGEPAGES_TRANSPARENT && PHP_OS==='Linux') {
+            try {
+                $this->adviseBytes(self::MADV_HUGEPAGE, 0, $length);
+            } catch(RuntimeException $e) {
+                // transparent huge pages are disabled
+            }
+        }
+    }
+
+    /**
+     * The default huge page size of the system in bytes.
+     */
+    public static function hugePageSize() : int
+    {
+        $meminfo = @file_get_contents('/proc/meminfo');
+        if($meminfo!==false && preg_match('/^Hugepagesize:\s+(\d+)\s+kB/m', $meminfo, $match)) {
+            return (int)$match[1]*1024;
+        }
+        return self::DEFAULT_HUGE_PAGE_SIZE;
+    }
+
+    public function hugePages() : int
+    {
+        return $this->hugePages;
+    }
+
+    /**
+     * Bytes of the mapping, rounded up to whole huge pages for HUGEPAGES_EXPLICIT.
+     */
+    public function mappedBytes() : int
+    {
+        return $this->mappingSize;
+    }
+}
@@ -0,0 +1,273 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use FFI;
+use RuntimeException;
+
+/**
+ * Short benchmarks that find the crossover points of this host.
+ *
+ * The benchmarks call the libraries directly on FFI arrays, so they do not
+ * depend on a buffer implementation.
+ */
+class Autotuner
+{
+    protected OpenBLASFactory $factory;
+    protected int $repeat;
+    /** @var callable|null $logger */
+    protected $logger;
+    protected int $maxSize;
+
+    /**
+     * maxSize limits the matrix dimension of the benchmarks; the smallest
+     * size of each benchmark is always measured.
+     */
+    public function __construct(
+        OpenBLASFactory $factory, int $repeat=5, ?callable $logger=null, int $maxSize=512)
+    {
+        $this->factory = $factory;
+        $this->repeat = max(1, $repeat);
+        $this->logger = $logger;
+        $this->maxSize = max(1, $maxSize);
+    }
+
+    /**
+     * The key of the profile for the loaded library.
+     */
+    public function key() : string
+    {
+        $blas = $this->factory->Blas();
+        return PerformanceProfile::key($blas->getCorename(), $blas->getConfig());
+    }
+
+    public function run() : PerformanceProfile
+    {
+        $blas = $this->factory->Blas();
+        $values = [];
+        if($blas->hasCapability('openblas')) {
+            $values['num_threads'] = $this->tuneNumThreads($blas);
+        }
+        if($blas->hasCapability('gemm3m')) {
+            $values['gemm3m_min_size'] = $this->tuneGemm3m($blas);
+        }
+        if($blas->hasCapability('omatcopy')) {
+            $values['omatcopy_transpose_min_size'] = $this->tuneOmatcopyTranspose($blas);
+        }
+        $values['lapack'] = $this->tuneLapack($blas);
+        return new PerformanceProfile($values);
+    }
+
+    protected function log(string $message) : void
+    {
+        if($this->logger!==null) {
+            ($this->logger)($message);
+        }
+    }
+
+    /**
+     * Best time of the repetitions in seconds.
+     */
+    protected function measure(callable $func) : float
+    {
+        $func();    // warm up
+        $best = INF;
+        for($i=0;$i<$this->repeat;$i++) {
+            $start = hrtime(true);
+            $func();
+            $best = min($best, (hrtime(true)-$start)/1e9);
+        }
+        return $best;
+    }
+
+    protected function random(object $ffi, string $type, int $size) : FFI\CData
+    {
+        $x = $ffi->new("{$type}[{$size}]");
+        for($i=0;$i<$size;$i++) {
+            $x[$i] = mt_rand()/mt_getrandmax();
+        }
+        return $x;
+    }
+
+    /**
+     * The sizes up to maxSize, and at least the first one.
+     *
+     * @param array<int> $sizes
+     * @return array<int>
+     */
+    protected function sizes(array $sizes) : array
+    {
+        $limited = array_filter($sizes, fn($n) => $n<=$this->maxSize);
+        return (count($limited)>0) ? $limited : [$sizes[0]];
+    }
+
+    /**
+     * The smallest size from which the candidate stays faster than the baseline.
+     *
+     * @param array<int,array{float,float}> $timings size => [baseline, candidate]
+     */
+    protected function crossover(array $timings, int $never) : int
+    {
+        $threshold = $never;
+        krsort($timings);
+        foreach($timings as $size => [$baseline, $candidate]) {
+            if($candidate >= $baseline) {
+                break;
+            }
+            $threshold = $size;
+        }
+        return $threshold;
+    }
+
+    protected function tuneNumThreads(Blas $blas) : int
+    {
+        $ffi = $blas->ffi();
+        $n = min(256, $this->maxSize);
+        $a = $this->random($ffi, 'float', $n*$n);
+        $b = $this->random($ffi, 'float', $n*$n);
+        $c = $ffi->new("float[".($n*$n)."]");
+        $default = $blas->getNumThreads();
+        $candidates = [$default];
+        for($threads=1; $threads<$default; $threads*=2) {
+            $candidates[] = $threads;
+        }
+        $best = $default;
+        $bestTime = INF;
+        foreach($candidates as $threads) {
+            $ffi->openblas_set_num_threads($threads);
+            $time = $this->measure(function() use ($ffi,$n,$a,$b,$c) {
+                $ffi->cblas_sgemm(BLASIF::RowMajor, BLASIF::NoTrans, BLASIF::NoTrans,
+                    $n, $n, $n, 1.0, $a, $n, $b, $n, 0.0, $c, $n);
+            });
+            $this->log(sprintf("threads=%d sgemm(%d): %.6f sec", $threads, $n, $time));
+            if($time < $bestTime) {
+                $bestTime = $time;
+                $best = $threads;
+            }
+        }
+        $ffi->openblas_set_num_threads($default);
+        return ($best==$default) ? 0 : $best;
+    }
+
+    protected function tuneGemm3m(Blas $blas) : int
+    {
+        $ffi = $blas->ffi();
+        $alpha = $ffi->new('openblas_complex_float');
+        $alpha->real = 1.0;
+        $beta = $ffi->new('openblas_complex_float');
+        $timings = [];
+        foreach($this->sizes([32, 64, 128, 256, 512]) as $n) {
+            $a = $this->random($ffi, 'float', 2*$n*$n);
+            $b = $this->random($ffi, 'float', 2*$n*$n);
+            $c = $ffi->new("float[".(2*$n*$n)."]");
+            $times = [];
+            foreach(['cblas_cgemm', 'cblas_cgemm3m'] as $func) {
+                $times[] = $this->measure(function() use ($ffi,$func,$n,$alpha,$beta,$a,$b,$c) {
+                    $ffi->{$func}(BLASIF::RowMajor, BLASIF::NoTrans, BLASIF::NoTrans,
+                        $n, $n, $n, FFI::addr($alpha), $a, $n, $b, $n, FFI::addr($beta), $c, $n);
+                });
+            }
+            $this->log(sprintf("cgemm(%d): %.6f sec, cgemm3m: %.6f sec", $n, $times[0], $times[1]));
+            $timings[$n*$n*$n] = [$times[0], $times[1]];
+        }
+        return $this->crossover($timings, PHP_INT_MAX);
+    }
+
+    protected function tuneOmatcopyTranspose(Blas $blas) : int
+    {
+        $ffi = $blas->ffi();
+        $timings = [];
+        foreach($this->sizes([8, 32, 128, 512]) as $n) {
+            $a = $this->random($ffi, 'float', $n*$n);
+            $b = $ffi->new("float[".($n*$n)."]");
+            $identity = $ffi->new("float[".($n*$n)."]");
+            for($i=0;$i<$n;$i++) {
+                $identity[$i*$n+$i] = 1.0;
+            }
+            // The transposition Lapackb does without omatcopy.
+            $gemm = $this->measure(function() use ($ffi,$n,$a,$b,$identity) {
+                $ffi->cblas_sgemm(BLASIF::ColMajor, BLASIF::Trans, BLASIF::NoTrans,
+                    $n, $n, $n, 1.0, $a, $n, $identity, $n, 0.0, $b, $n);
+            });
+            $omatcopy = $this->measure(function() use ($ffi,$n,$a,$b) {
+                $ffi->cblas_somatcopy(BLASIF::ColMajor, BLASIF::Trans, $n, $n, 1.0, $a, $n, $b, $n);
+            });
+            $this->log(sprintf("transpose(%d): gemm %.6f sec, omatcopy %.6f sec", $n, $gemm, $omatcopy));
+            $timings[$n*$n] = [$gemm, $omatcopy];
+        }
+        $threshold = $this->crossover($timings, PHP_INT_MAX);
+        // Below the smallest measured size the copy is trivially cheaper.
+        return ($threshold==8*8) ? 0 : $threshold;
+    }
+
+    /**
+     * Compare a RowMajor gesvd through LAPACKE with the Fortran interface
+     * plus the transpositions Lapackb needs.
+     */
+    protected function tuneLapack(Blas $blas) : string
+    {
+        try {
+            $lapackb = $this->factory->Lapackb();
+        } catch(RuntimeException $e) {
+            return PerformanceProfile::DEFAULTS['lapack'];
+        }
+        try {
+            $lapacke = $this->factory->Lapacke();
+        } catch(RuntimeException $e) {
+            return 'lapack';
+        }
+        $blasffi = $blas->ffi();
+        $ffi = $lapacke->ffi();
+        $fffi = $lapackb->ffi();
+        $n = min(128, $this->maxSize);
+        $size = $n*$n;
+        $source = $this->random($blasffi, 'float', $size);
+        $a = $blasffi->new("float[{$size}]");
+        $s = $blasffi->new("float[{$n}]");
+        $u = $blasffi->new("float[{$size}]");
+        $vt = $blasffi->new("float[{$size}]");
+        $tmp = $blasffi->new("float[{$size}]");
+        $superb = $blasffi->new("float[{$n}]");
+        $bytes = FFI::sizeof($a);
+
+        /** @var ffi_char_t $job */
+        $job = $ffi->new('char');
+        $job->cdata = 'A';
+        $lapackeTime = $this->measure(function() use ($ffi,$n,$source,$a,$s,$u,$vt,$superb,$job,$bytes) {
+            FFI::memcpy($a, $source, $bytes);
+            $ffi->LAPACKE_sgesvd(Lapacke::LAPACK_ROW_MAJOR, $job, $job,
+                $n, $n, $a, $n, $s, $u, $n, $vt, $n, $superb);
+        });
+
+        $job_p = $fffi->new('char[1]'); $job_p[0] = 'A';
+        $n_p = $fffi->new('lapack_int[1]'); $n_p[0] = $n;
+        $info_p = $fffi->new('lapack_int[1]');
+        $lwork_p = $fffi->new('lapack_int[1]'); $lwork_p[0] = -1;
+        $wkopt_p = $fffi->new('float[1]');
+        $fffi->sgesvd_($job_p, $job_p, $n_p, $n_p, $a, $n_p, $s, $u, $n_p, $vt, $n_p, $wkopt_p, $lwork_p, $info_p);
+        $lwork = max(1, (int)$wkopt_p[0]);
+        $lwork_p[0] = $lwork;
+        $work = $fffi->new("float[{$lwork}]");
+        $omatcopy = $blas->hasCapability('omatcopy');
+        $identity = $blasffi->new("float[{$size}]");
+        for($i=0;$i<$n;$i++) {
+            $identity[$i*$n+$i] = 1.0;
+        }
+        $transpose = function($from, $to) use ($blasffi,$n,$omatcopy,$identity) {
+            if($omatcopy) {
+                $blasffi->cblas_somatcopy(BLASIF::ColMajor, BLASIF::Trans, $n, $n, 1.0, $from, $n, $to, $n);
+            } else {
+                $blasffi->cblas_sgemm(BLASIF::ColMajor, BLASIF::Trans, BLASIF::NoTrans,
+                    $n, $n, $n, 1.0, $from, $n, $identity, $n, 0.0, $to, $n);
+            }
+        };
+        $lapackTime = $this->measure(function() use ($fffi,$source,$a,$s,$u,$vt,$tmp,$job_p,$n_p,$work,$lwork_p,$info_p,$transpose) {
+            $transpose($source, $a);
+            $fffi->sgesvd_($job_p, $job_p, $n_p, $n_p, $a, $n_p, $s, $u, $n_p, $vt, $n_p, $work, $lwork_p, $info_p);
+            $transpose($u, $tmp);
+            $transpose($vt, $tmp);
+        });
+        $this->log(sprintf("gesvd(%d): lapacke %.6f sec, lapack %.6f sec", $n, $lapackeTime, $lapackTime));
+        return ($lapackTime < $lapackeTime) ? 'lapack' : 'lapacke';
+    }
+}
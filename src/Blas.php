@@ -4,6 +4,7 @@ namespace Rindow\OpenBLAS\FFI;
 use Interop\Polite\Math\Matrix\NDArray;
 use Interop\Polite\Math\Matrix\BLAS as BLASIF;
 use InvalidArgumentException;
+use RuntimeException;
 use FFI;
 
 use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
@@ -19,14 +20,87 @@ class Blas
     // OpenBLAS is compiled using OpenMP threading model
     const OPENBLAS_OPENMP = 2;
 
+    // Number of elements in the scratch buffer used by strided batch routines
+    const BATCH_SCRATCH_SIZE = 65536;
+    // Smallest X . X that keeps full precision: the smallest normal number
+    // divided by the machine epsilon, 2^-126/2^-23 and 2^-1022/2^-52
+    const NRM2_SAFE_MIN_FLOAT = 9.860761315262648e-32;
+    const NRM2_SAFE_MIN_DOUBLE = 1.0020841800044864e-292;
+    // Rows of the panels of op(A) converted at a time by gemmInt8
+    const INT8_BLOCK_SIZE = 128;
+
     protected object $ffi;
+    protected FFI|SuffixedFFI|null $ffiGemmBatch;
+    protected FFI|SuffixedFFI|null $ffiGemmBatchStrided;
+    protected OnesCache $onesCache;
+    /** @var array<int,FFI\CData> $batchScratch */
+    protected array $batchScratch = [];
+    /** @var array<int,int> $batchScratchSize */
+    protected array $batchScratchSize = [];
+    /** @var array<string,bool> $capabilities */
+    protected array $capabilities;
+    // m*n*k from which complex gemm uses gemm3m
+    protected int $gemm3mMinSize;
 
-    public function __construct(FFI $ffi)
+    /**
+     * capabilities is the map given by OpenBLASFactory::capabilities().
+     * Without it, every routine of the bundled OpenBLAS header is assumed to exist.
+     *
+     * profile holds the thresholds measured by the autotuner.
+     *
+     * onesCache is shared with Math by the factory.
+     *
+     * @param array<string,bool> $capabilities
+     */
+    public function __construct(
+        FFI|SuffixedFFI $ffi,
+        FFI|SuffixedFFI|null $ffiGemmBatch=null,
+        FFI|SuffixedFFI|null $ffiGemmBatchStrided=null,
+        ?array $capabilities=null,
+        ?PerformanceProfile $profile=null,
+        ?OnesCache $onesCache=null,
+        )
     {
         $this->ffi = $ffi;
+        $this->onesCache = $onesCache ?? new OnesCache($ffi);
+        $this->ffiGemmBatch = $ffiGemmBatch;
+        $this->ffiGemmBatchStrided = $ffiGemmBatchStrided;
+        if($capabilities===null) {
+            $openblas = PHP_OS!=='Darwin';
+            $capabilities = [
+                'openblas' => $openblas,
+                'iamin' => $openblas,
+                'omatcopy' => $openblas,
+                'imatcopy' => $openblas,
+                'geadd' => $openblas,
+                'axpby' => $openblas,
+                'cdotu' => $openblas,
+                'crotg' => $openblas && PHP_OS!=='WINNT',
+                'gemm3m' => $openblas,
+                'gemm_batch' => $ffiGemmBatch!==null,
+                'gemm_batch_strided' => $ffiGemmBatchStrided!==null,
+            ];
+        }
+        $this->capabilities = $capabilities;
+        $profile ??= new PerformanceProfile();
+        $this->gemm3mMinSize = $this->hasCapability('gemm3m') ?
+            $profile->getInt('gemm3m_min_size') : PHP_INT_MAX;
     }
 
-    public function getFFI() : FFI
+    /**
+     * The handle as loaded, including the symbol suffix wrapper.
+     */
+    public function ffi() : object
+    {
+        return $this->ffi;
+    }
+
+    /**
+     * The handle to call cblas_* and openblas_* by their plain names.
+     * For a suffixed build this is the SuffixedFFI; its ffi() is the
+     * library handle, which only knows the suffixed names.
+     */
+    public function getFFI() : FFI|SuffixedFFI
     {
         return $this->ffi;
     }
@@ -73,19 +147,33 @@ class Blas
         return $this->ffi->openblas_get_parallel();
     }
 
+    /**
+     * @return array<string,bool>
+     */
+    public function capabilities() : array
+    {
+        return $this->capabilities;
+    }
+
+    public function hasCapability(string $name) : bool
+    {
+        return $this->capabilities[$name] ?? false;
+    }
+
     public function hasIamin() : bool
     {
-        return !$this->isVecib();
+        return $this->hasCapability('iamin');
     }
 
     public function hasOmatcopy() : bool
     {
-        return !$this->isVecib();
+        return $this->hasCapability('omatcopy');
     }
 
+    // A plain CBLAS without the OpenBLAS extensions, e.g. vecLib.
     private function isVecib(): bool
     {
-        return PHP_OS==='Darwin';
+        return !$this->hasCapability('openblas');
     }
 
     protected function toComplex(object $from,int $dtype) : object
@@ -203,6 +291,66 @@ class Blas
         }
     }
 
+    /**
+     * Y := alpha*X + beta*Y
+     */
+    public function axpby(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX,
+        float|object $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $ffi= $this->ffi;
+
+        $this->assert_shape_parameter("n", $n);
+        // Check Buffer X
+        $this->assert_vector_buffer_spec("X", $X, $n, $offsetX, $incX);
+        // Check Buffer Y
+        $this->assert_vector_buffer_spec("Y", $Y, $n, $offsetY, $incY);
+
+        // Check Buffer X and Y
+        if($X->dtype()!=$Y->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y");
+        }
+
+        if(!$this->hasCapability('axpby')) {
+            $this->scal($n,$beta,$Y,$offsetY,$incY);
+            $this->axpy($n,$alpha,$X,$offsetX,$incX,$Y,$offsetY,$incY);
+            return;
+        }
+
+        switch($X->dtype()) {
+            case NDArray::float32:{
+                $ffi->cblas_saxpby($n,$alpha,$X->addr($offsetX),$incX,$beta,$Y->addr($offsetY),$incY);
+                break;
+            }
+            case NDArray::float64:{
+                $ffi->cblas_daxpby($n,$alpha,$X->addr($offsetX),$incX,$beta,$Y->addr($offsetY),$incY);
+                break;
+            }
+            case NDArray::complex64:{
+                $alpha = $this->toComplex($alpha,$X->dtype());  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);                  // To keep object instance.
+                $beta = $this->toComplex($beta,$X->dtype());    // *** CAUTION ***
+                $betaptr = FFI::addr($beta);                    // To keep object instance.
+                $ffi->cblas_caxpby($n,$alphaptr,$X->addr($offsetX),$incX,$betaptr,$Y->addr($offsetY),$incY);
+                break;
+            }
+            case NDArray::complex128:{
+                $alpha = $this->toComplex($alpha,$X->dtype());  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);                  // To keep object instance.
+                $beta = $this->toComplex($beta,$X->dtype());    // *** CAUTION ***
+                $betaptr = FFI::addr($beta);                    // To keep object instance.
+                $ffi->cblas_zaxpby($n,$alphaptr,$X->addr($offsetX),$incX,$betaptr,$Y->addr($offsetY),$incY);
+                break;
+            }
+            default: {
+                throw new InvalidArgumentException('Unsuppored data type');
+            }
+        }
+    }
+
     public function dot(
         int $n,
         BufferInterface $X, int $offsetX, int $incX,
@@ -257,7 +405,7 @@ class Blas
 
         switch($X->dtype()) {
             case NDArray::complex64:{
-                if($this->isVecib()) {
+                if(!$this->hasCapability('cdotu')) {
                     $result = $ffi->new('openblas_complex_float');
                     $ffi->cblas_cdotu_sub($n,$X->addr($offsetX),$incX,$Y->addr($offsetY),$incY,FFI::addr($result));
                 } else {
@@ -266,7 +414,7 @@ class Blas
                 break;
             }
             case NDArray::complex128:{
-                if($this->isVecib()) {
+                if(!$this->hasCapability('cdotu')) {
                     $result = $ffi->new('openblas_complex_double');
                     $ffi->cblas_zdotu_sub($n,$X->addr($offsetX),$incX,$Y->addr($offsetY),$incY,FFI::addr($result));
                 } else {
@@ -340,7 +488,7 @@ class Blas
 
         switch($X->dtype()) {
             case NDArray::complex64:{
-                if($this->isVecib()) {
+                if(!$this->hasCapability('cdotu')) {
                     $result = $ffi->new('openblas_complex_float');
                     $ffi->cblas_cdotc_sub($n,$X->addr($offsetX),$incX,$Y->addr($offsetY),$incY,FFI::addr($result));
                 } else {
@@ -349,7 +497,7 @@ class Blas
                 break;
             }
             case NDArray::complex128:{
-                if($this->isVecib()) {
+                if(!$this->hasCapability('cdotu')) {
                     $result = $ffi->new('openblas_complex_double');
                     $ffi->cblas_zdotc_sub($n,$X->addr($offsetX),$incX,$Y->addr($offsetY),$incY,FFI::addr($result));
                 } else {
@@ -476,8 +624,8 @@ class Blas
         int $n,
         BufferInterface $X, int $offsetX, int $incX ) : int
     {
-        if($this->isVecib()) {
-            throw new InvalidArgumentException("iamin is not supported on macOS.");
+        if(!$this->hasCapability('iamin')) {
+            throw new InvalidArgumentException("iamin is not supported by the loaded BLAS library.");
         }
         $ffi= $this->ffi;
 
@@ -640,13 +788,8 @@ class Blas
                 break;
             }
             case NDArray::complex64:{
-                if(PHP_OS==='WINNT') {
-                    $ffi->crotg_(
-                        $A->addr($offsetA),
-                        $B->addr($offsetB),
-                        $C->addr($offsetC),
-                        $S->addr($offsetS),
-                    );
+                if(!$this->hasCapability('crotg')) {
+                    $this->fortranRotg('crotg_', $A, $offsetA, $B, $offsetB, $C, $offsetC, $S, $offsetS);
                 } else {
                     $ffi->cblas_crotg(
                         $A->addr($offsetA),
@@ -658,13 +801,8 @@ class Blas
                 break;
             }
             case NDArray::complex128:{
-                if(PHP_OS==='WINNT') {
-                    $ffi->zrotg_(
-                        $A->addr($offsetA),
-                        $B->addr($offsetB),
-                        $C->addr($offsetC),
-                        $S->addr($offsetS),
-                    );
+                if(!$this->hasCapability('crotg')) {
+                    $this->fortranRotg('zrotg_', $A, $offsetA, $B, $offsetB, $C, $offsetC, $S, $offsetS);
                 } else {
                     $ffi->cblas_zrotg(
                         $A->addr($offsetA),
@@ -934,19 +1072,346 @@ class Blas
         }
     }
 
-    public function gemv(
-        int $order,
+    /**
+     * The Fortran complex rotg, for libraries whose CBLAS does not export it.
+     */
+    protected function fortranRotg(
+        string $name,
+        BufferInterface $A, int $offsetA,
+        BufferInterface $B, int $offsetB,
+        BufferInterface $C, int $offsetC,
+        BufferInterface $S, int $offsetS,
+        ) : void
+    {
+        try {
+            $this->ffi->{$name}(
+                $A->addr($offsetA),
+                $B->addr($offsetB),
+                $C->addr($offsetC),
+                $S->addr($offsetS),
+            );
+        } catch(FFI\Exception $e) {
+            throw new RuntimeException(
+                "The BLAS library exports neither cblas_".substr($name, 0, -1)." nor {$name}.", 0, $e);
+        }
+    }
+
+    /**
+     * Get a cached vector of at least n ones.
+     */
+    protected function ones(int $n, int $dtype) : FFI\CData
+    {
+        return $this->onesCache->get($n, $dtype);
+    }
+
+    /**
+     * Get the cached scratch buffer of at least size elements.
+     */
+    protected function batchScratch(int $size, int $dtype) : FFI\CData
+    {
+        if(($this->batchScratchSize[$dtype] ?? 0) >= $size) {
+            return $this->batchScratch[$dtype];
+        }
+        $size = max($size, self::BATCH_SCRATCH_SIZE);
+        $type = ($dtype==NDArray::float32) ? 'float' : 'double';
+        $scratch = $this->ffi->new("{$type}[{$size}]");
+        $this->batchScratch[$dtype] = $scratch;
+        $this->batchScratchSize[$dtype] = $size;
+        return $scratch;
+    }
+
+    /**
+     *  R[i] := X[i] . Y[i]
+     *
+     *  X[i] starts at offsetX + i*strideX (Y likewise).
+     *  Packed batches are computed in two native passes per chunk:
+     *  an elementwise product (sbmv with a zero bandwidth) and a row sum (gemv).
+     */
+    public function dotStridedBatch(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX, int $strideX,
+        BufferInterface $Y, int $offsetY, int $incY, int $strideY,
+        BufferInterface $R, int $offsetR, int $incR,
+        int $batchCount ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        // Check Buffer X
+        $this->assert_strided_vector_buffer_spec("X", $X, $n, $offsetX, $incX, $strideX, $batchCount);
+        // Check Buffer Y
+        $this->assert_strided_vector_buffer_spec("Y", $Y, $n, $offsetY, $incY, $strideY, $batchCount);
+        // Check Buffer R
+        $this->assert_vector_buffer_spec("R", $R, $batchCount, $offsetR, $incR);
+
+        // Check Buffer X and Y and R
+        $dtype = $X->dtype();
+        if($dtype!=$Y->dtype() || $dtype!=$R->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y and R");
+        }
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+
+        if($strideX!=$n*$incX || $strideY!=$n*$incY) {
+            for($i=0; $i<$batchCount; $i++) {
+                $R[$offsetR+$i*$incR] = $this->dot(
+                    $n,
+                    $X, $offsetX+$i*$strideX, $incX,
+                    $Y, $offsetY+$i*$strideY, $incY,
+                );
+            }
+            return;
+        }
+        $this->productRowSums(
+            $n, $dtype,
+            $X, $offsetX, $incX,
+            $Y, $offsetY, $incY,
+            $R, $offsetR, $incR,
+            $batchCount
+        );
+    }
+
+    /**
+     *  R[i] := || X[i] ||
+     *
+     *  X[i] starts at offsetX + i*strideX.
+     *  Packed batches are computed as sqrt(X[i] . X[i]). A vector whose
+     *  X[i] . X[i] overflows or falls below the normal range divided by the
+     *  machine epsilon is computed again with cblas_?nrm2, which scales.
+     */
+    public function nrm2StridedBatch(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX, int $strideX,
+        BufferInterface $R, int $offsetR, int $incR,
+        int $batchCount ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        // Check Buffer X
+        $this->assert_strided_vector_buffer_spec("X", $X, $n, $offsetX, $incX, $strideX, $batchCount);
+        // Check Buffer R
+        $this->assert_vector_buffer_spec("R", $R, $batchCount, $offsetR, $incR);
+
+        // Check Buffer X and R
+        $dtype = $X->dtype();
+        if($dtype!=$R->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and R");
+        }
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+
+        if($strideX!=$n*$incX) {
+            for($i=0; $i<$batchCount; $i++) {
+                $R[$offsetR+$i*$incR] = $this->nrm2(
+                    $n,
+                    $X, $offsetX+$i*$strideX, $incX,
+                );
+            }
+            return;
+        }
+        $this->productRowSums(
+            $n, $dtype,
+            $X, $offsetX, $incX,
+            $X, $offsetX, $incX,
+            $R, $offsetR, $incR,
+            $batchCount
+        );
+        // X[i] . X[i] overflows or loses its precision to underflow outside
+        // this range; those vectors are computed again with the scaling of nrm2.
+        $tiny = ($dtype==NDArray::float32) ? self::NRM2_SAFE_MIN_FLOAT : self::NRM2_SAFE_MIN_DOUBLE;
+        for($i=0,$idR=$offsetR; $i<$batchCount; $i++,$idR+=$incR) {
+            $squares = $R[$idR];
+            if(is_finite($squares) && $squares>=$tiny) {
+                $R[$idR] = sqrt($squares);
+            } else {
+                $R[$idR] = $this->nrm2($n, $X, $offsetX+$i*$strideX, $incX);
+            }
+        }
+    }
+
+    /**
+     *  Y[i] := alpha * X[i] + Y[i]
+     *
+     *  X[i] starts at offsetX + i*strideX (Y likewise).
+     *  Packed batches become one axpy over the whole batch; unit-increment
+     *  batches become one geadd over the batch viewed as a matrix.
+     */
+    public function axpyStridedBatch(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX, int $strideX,
+        BufferInterface $Y, int $offsetY, int $incY, int $strideY,
+        int $batchCount ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        // Check Buffer X
+        $this->assert_strided_vector_buffer_spec("X", $X, $n, $offsetX, $incX, $strideX, $batchCount);
+        // Check Buffer Y
+        $this->assert_strided_vector_buffer_spec("Y", $Y, $n, $offsetY, $incY, $strideY, $batchCount);
+
+        // Check Buffer X and Y
+        $dtype = $X->dtype();
+        if($dtype!=$Y->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y");
+        }
+
+        if($strideX==$n*$incX && $strideY==$n*$incY) {
+            $this->axpy(
+                $n*$batchCount,
+                $alpha,
+                $X, $offsetX, $incX,
+                $Y, $offsetY, $incY,
+            );
+            return;
+        }
+        if($incX==1 && $incY==1 && $strideX>=$n && $strideY>=$n && $this->hasCapability('geadd')) {
+            switch($dtype) {
+                case NDArray::float32:{
+                    $this->ffi->cblas_sgeadd(
+                        BLASIF::RowMajor,
+                        $batchCount, $n,
+                        $alpha,
+                        $X->addr($offsetX), $strideX,
+                        1.0,
+                        $Y->addr($offsetY), $strideY);
+                    return;
+                }
+                case NDArray::float64:{
+                    $this->ffi->cblas_dgeadd(
+                        BLASIF::RowMajor,
+                        $batchCount, $n,
+                        $alpha,
+                        $X->addr($offsetX), $strideX,
+                        1.0,
+                        $Y->addr($offsetY), $strideY);
+                    return;
+                }
+            }
+        }
+        for($i=0; $i<$batchCount; $i++) {
+            $this->axpy(
+                $n,
+                $alpha,
+                $X, $offsetX+$i*$strideX, $incX,
+                $Y, $offsetY+$i*$strideY, $incY,
+            );
+        }
+    }
+
+    /**
+     *  X[i] := alpha * X[i]
+     *
+     *  X[i] starts at offsetX + i*strideX.
+     *  Packed batches become one scal over the whole batch; unit-increment
+     *  batches become one geadd over the batch viewed as a matrix.
+     */
+    public function scalStridedBatch(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX, int $strideX,
+        int $batchCount ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        // Check Buffer X
+        $this->assert_strided_vector_buffer_spec("X", $X, $n, $offsetX, $incX, $strideX, $batchCount);
+
+        $dtype = $X->dtype();
+        if($strideX==$n*$incX) {
+            $this->scal(
+                $n*$batchCount,
+                $alpha,
+                $X, $offsetX, $incX,
+            );
+            return;
+        }
+        if($incX==1 && $strideX>=$n && $this->hasCapability('geadd')) {
+            switch($dtype) {
+                case NDArray::float32:{
+                    $this->ffi->cblas_sgeadd(
+                        BLASIF::RowMajor,
+                        $batchCount, $n,
+                        0.0,
+                        $X->addr($offsetX), $strideX,
+                        $alpha,
+                        $X->addr($offsetX), $strideX);
+                    return;
+                }
+                case NDArray::float64:{
+                    $this->ffi->cblas_dgeadd(
+                        BLASIF::RowMajor,
+                        $batchCount, $n,
+                        0.0,
+                        $X->addr($offsetX), $strideX,
+                        $alpha,
+                        $X->addr($offsetX), $strideX);
+                    return;
+                }
+            }
+        }
+        for($i=0; $i<$batchCount; $i++) {
+            $this->scal(
+                $n,
+                $alpha,
+                $X, $offsetX+$i*$strideX, $incX,
+            );
+        }
+    }
+
+    /**
+     *  R[i] := sum_j X[i][j] * Y[i][j]  for packed X and Y.
+     *
+     *  The batch is processed in chunks so that the scratch buffer stays bounded;
+     *  the buffer is kept for the next call.
+     */
+    protected function productRowSums(
+        int $n, int $dtype,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY,
+        BufferInterface $R, int $offsetR, int $incR,
+        int $batchCount ) : void
+    {
+        $ffi = $this->ffi;
+        $sbmv = ($dtype==NDArray::float32) ? 'cblas_ssbmv' : 'cblas_dsbmv';
+        $gemv = ($dtype==NDArray::float32) ? 'cblas_sgemv' : 'cblas_dgemv';
+
+        $chunk = min($batchCount, max(1, intdiv(self::BATCH_SCRATCH_SIZE, $n)));
+        $size = $chunk*$n;
+        $T = $this->batchScratch($size, $dtype);
+        $ones = $this->ones($n, $dtype);
+        for($i=0; $i<$batchCount; $i+=$chunk) {
+            $rows = min($chunk, $batchCount-$i);
+            // T := diag(X) * Y   (a band matrix without off-diagonals)
+            $ffi->{$sbmv}(
+                BLASIF::RowMajor, BLASIF::Upper,
+                $rows*$n, 0,
+                1.0,
+                $X->addr($offsetX+$i*$n*$incX), $incX,
+                $Y->addr($offsetY+$i*$n*$incY), $incY,
+                0.0,
+                $T, 1);
+            // R := T * ones
+            $ffi->{$gemv}(
+                BLASIF::RowMajor, BLASIF::NoTrans,
+                $rows, $n,
+                1.0,
+                $T, $n,
+                $ones, 1,
+                0.0,
+                $R->addr($offsetR+$i*$incR), $incR);
+        }
+    }
+
+    protected function assert_gemv_spec(
         int $trans,
         int $m,
         int $n,
-        float|object $alpha,
         BufferInterface $A, int $offsetA, int $ldA,
         BufferInterface $X, int $offsetX, int $incX,
-        float|object $beta,
-        BufferInterface $Y, int $offsetY, int $incY ) : void
+        BufferInterface $Y, int $offsetY, int $incY ) : int
     {
-        $ffi= $this->ffi;
-
         $this->assert_shape_parameter("m", $m);
         $this->assert_shape_parameter("n", $n);
         // Check Buffer A
@@ -973,6 +1438,29 @@ class Blas
         if($trans==BLASIF::ConjNoTrans && $this->isVecib()) {
             throw new InvalidArgumentException("Unsupported dtype on MacOS: {$trans}");
         }
+        return $dtype;
+    }
+
+    public function gemv(
+        int $order,
+        int $trans,
+        int $m,
+        int $n,
+        float|object $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $X, int $offsetX, int $incX,
+        float|object $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $ffi= $this->ffi;
+
+        $dtype = $this->assert_gemv_spec(
+            $trans,
+            $m, $n,
+            $A, $offsetA, $ldA,
+            $X, $offsetX, $incX,
+            $Y, $offsetY, $incY,
+        );
 
         switch($dtype) {
             case NDArray::float32:{
@@ -1110,21 +1598,16 @@ class Blas
     }
 
 
-    public function gemm(
-        int $order,
+    protected function assert_gemm_spec(
         int $transA,
         int $transB,
         int $m,
         int $n,
         int $k,
-        float|object $alpha,
         BufferInterface $A, int $offsetA, int $ldA,
         BufferInterface $B, int $offsetB, int $ldB,
-        float|object $beta,
-        BufferInterface $C, int $offsetC, int $ldC ) : void
+        BufferInterface $C, int $offsetC, int $ldC ) : int
     {
-        $ffi= $this->ffi;
-
         $this->assert_shape_parameter("m", $m);
         $this->assert_shape_parameter("n", $n);
         $this->assert_shape_parameter("k", $k);
@@ -1164,6 +1647,34 @@ class Blas
         if($transB==BLASIF::ConjNoTrans && $this->isVecib()) {
             throw new InvalidArgumentException("Unsupported dtype int TransB on MacOS: {$transB}");
         }
+        return $dtype;
+    }
+
+    public function gemm(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float|object $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float|object $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        $ffi= $this->ffi;
+
+        $dtype = $this->assert_gemm_spec(
+            $transA, $transB,
+            $m, $n, $k,
+            $A, $offsetA, $ldA,
+            $B, $offsetB, $ldB,
+            $C, $offsetC, $ldC,
+        );
+
+        // gemm3m saves a quarter of the multiplications on large complex matrices.
+        $gemm3m = ($m*$n*$k >= $this->gemm3mMinSize);
 
         switch($dtype) {
             case NDArray::float32:{
@@ -1197,7 +1708,8 @@ class Blas
                 $alphaptr = FFI::addr($alpha);                  // To keep object instance.
                 $beta = $this->toComplex($beta,$A->dtype());
                 $betaptr = FFI::addr($beta);
-                $ffi->cblas_cgemm(
+                $func = $gemm3m ? 'cblas_cgemm3m' : 'cblas_cgemm';
+                $ffi->{$func}(
                     $order,
                     $transA,
                     $transB,
@@ -1214,7 +1726,8 @@ class Blas
                 $alphaptr = FFI::addr($alpha);                  // To keep object instance.
                 $beta = $this->toComplex($beta,$A->dtype());
                 $betaptr = FFI::addr($beta);
-                $ffi->cblas_zgemm(
+                $func = $gemm3m ? 'cblas_zgemm3m' : 'cblas_zgemm';
+                $ffi->{$func}(
                     $order,
                     $transA,
                     $transB,
@@ -1232,6 +1745,388 @@ class Blas
         }
     }
 
+    /**
+     *  C[i] := alpha * op(A[i]) * op(B[i]) + beta * C[i]
+     *
+     *  All matrices in the batch have the same shape and leading dimensions.
+     *  The whole batch is passed to cblas_?gemm_batch in a single call when the
+     *  loaded library exports it. Otherwise cblas_?gemm is called for each matrix.
+     *
+     * @param array<BufferInterface> $A
+     * @param array<int> $offsetA
+     * @param array<BufferInterface> $B
+     * @param array<int> $offsetB
+     * @param array<BufferInterface> $C
+     * @param array<int> $offsetC
+     */
+    public function gemmBatch(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float|object $alpha,
+        array $A, array $offsetA, int $ldA,
+        array $B, array $offsetB, int $ldB,
+        float|object $beta,
+        array $C, array $offsetC, int $ldC ) : void
+    {
+        $batchCount = count($C);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        if(count($offsetC)!=$batchCount ||
+            count($A)!=$batchCount || count($offsetA)!=$batchCount ||
+            count($B)!=$batchCount || count($offsetB)!=$batchCount) {
+            throw new InvalidArgumentException("Unmatch batch count for A and B and C");
+        }
+        $A = array_values($A); $offsetA = array_values($offsetA);
+        $B = array_values($B); $offsetB = array_values($offsetB);
+        $C = array_values($C); $offsetC = array_values($offsetC);
+
+        // Check every matrix in the batch
+        $dtype = null;
+        for($i=0; $i<$batchCount; $i++) {
+            $itemType = $this->assert_gemm_spec(
+                $transA, $transB,
+                $m, $n, $k,
+                $A[$i], $offsetA[$i], $ldA,
+                $B[$i], $offsetB[$i], $ldB,
+                $C[$i], $offsetC[$i], $ldC,
+            );
+            if($dtype!==null && $dtype!=$itemType) {
+                throw new InvalidArgumentException("Unmatch data type in the batch");
+            }
+            $dtype = $itemType;
+        }
+
+        if($this->ffiGemmBatch!==null) {
+            $bffi = $this->ffiGemmBatch;
+            // A single group that contains the whole batch
+            $transA_p = $bffi->new('CBLAS_TRANSPOSE[1]'); $transA_p[0] = $transA;
+            $transB_p = $bffi->new('CBLAS_TRANSPOSE[1]'); $transB_p[0] = $transB;
+            $m_p = $bffi->new('blasint[1]'); $m_p[0] = $m;
+            $n_p = $bffi->new('blasint[1]'); $n_p[0] = $n;
+            $k_p = $bffi->new('blasint[1]'); $k_p[0] = $k;
+            $ldA_p = $bffi->new('blasint[1]'); $ldA_p[0] = $ldA;
+            $ldB_p = $bffi->new('blasint[1]'); $ldB_p[0] = $ldB;
+            $ldC_p = $bffi->new('blasint[1]'); $ldC_p[0] = $ldC;
+            $groupSize_p = $bffi->new('blasint[1]'); $groupSize_p[0] = $batchCount;
+            $A_p = $bffi->new("void*[{$batchCount}]");
+            $B_p = $bffi->new("void*[{$batchCount}]");
+            $C_p = $bffi->new("void*[{$batchCount}]");
+            for($i=0; $i<$batchCount; $i++) {
+                $A_p[$i] = $A[$i]->addr($offsetA[$i]);
+                $B_p[$i] = $B[$i]->addr($offsetB[$i]);
+                $C_p[$i] = $C[$i]->addr($offsetC[$i]);
+            }
+            switch($dtype) {
+                case NDArray::float32:
+                case NDArray::float64: {
+                    $type = ($dtype==NDArray::float32) ? 'float' : 'double';
+                    $func = ($dtype==NDArray::float32) ? 'cblas_sgemm_batch' : 'cblas_dgemm_batch';
+                    $alpha_p = $bffi->new("{$type}[1]"); $alpha_p[0] = $alpha;
+                    $beta_p = $bffi->new("{$type}[1]"); $beta_p[0] = $beta;
+                    break;
+                }
+                case NDArray::complex64:
+                case NDArray::complex128: {
+                    $func = ($dtype==NDArray::complex64) ? 'cblas_cgemm_batch' : 'cblas_zgemm_batch';
+                    $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                    $alpha_p = FFI::addr($alpha);              // To keep object instance.
+                    $beta = $this->toComplex($beta,$dtype);
+                    $beta_p = FFI::addr($beta);
+                    break;
+                }
+                default: {
+                    throw new InvalidArgumentException('Unsuppored data type');
+                }
+            }
+            $bffi->{$func}(
+                $order,
+                $transA_p,
+                $transB_p,
+                $m_p,$n_p,$k_p,
+                $alpha_p,
+                $A_p,$ldA_p,
+                $B_p,$ldB_p,
+                $beta_p,
+                $C_p,$ldC_p,
+                1,$groupSize_p);
+            return;
+        }
+
+        $ffi= $this->ffi;
+        switch($dtype) {
+            case NDArray::float32:{
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_sgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A[$i]->addr($offsetA[$i]),$ldA,
+                        $B[$i]->addr($offsetB[$i]),$ldB,
+                        $beta,
+                        $C[$i]->addr($offsetC[$i]),$ldC);
+                }
+                break;
+            }
+            case NDArray::float64:{
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_dgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A[$i]->addr($offsetA[$i]),$ldA,
+                        $B[$i]->addr($offsetB[$i]),$ldB,
+                        $beta,
+                        $C[$i]->addr($offsetC[$i]),$ldC);
+                }
+                break;
+            }
+            case NDArray::complex64:{
+                $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                $beta = $this->toComplex($beta,$dtype);
+                $betaptr = FFI::addr($beta);
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_cgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A[$i]->addr($offsetA[$i]),$ldA,
+                        $B[$i]->addr($offsetB[$i]),$ldB,
+                        $betaptr,
+                        $C[$i]->addr($offsetC[$i]),$ldC);
+                }
+                break;
+            }
+            case NDArray::complex128:{
+                $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                $beta = $this->toComplex($beta,$dtype);
+                $betaptr = FFI::addr($beta);
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_zgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A[$i]->addr($offsetA[$i]),$ldA,
+                        $B[$i]->addr($offsetB[$i]),$ldB,
+                        $betaptr,
+                        $C[$i]->addr($offsetC[$i]),$ldC);
+                }
+                break;
+            }
+            default: {
+                throw new InvalidArgumentException('Unsuppored data type');
+            }
+        }
+    }
+
+    /**
+     *  C[i] := alpha * op(A[i]) * op(B[i]) + beta * C[i]
+     *
+     *  A[i] starts at offsetA + i*strideA (B and C likewise).
+     *  The whole batch is passed to cblas_?gemm_batch_strided in a single call
+     *  when the loaded library exports it.
+     */
+    public function gemmStridedBatch(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float|object $alpha,
+        BufferInterface $A, int $offsetA, int $ldA, int $strideA,
+        BufferInterface $B, int $offsetB, int $ldB, int $strideB,
+        float|object $beta,
+        BufferInterface $C, int $offsetC, int $ldC, int $strideC,
+        int $batchCount ) : void
+    {
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        if($strideA<0) {
+            throw new InvalidArgumentException("Argument strideA must be greater than equals 0.");
+        }
+        if($strideB<0) {
+            throw new InvalidArgumentException("Argument strideB must be greater than equals 0.");
+        }
+        if($strideC<0) {
+            throw new InvalidArgumentException("Argument strideC must be greater than equals 0.");
+        }
+        // Check the first and the last matrix in the batch
+        $dtype = $this->assert_gemm_spec(
+            $transA, $transB,
+            $m, $n, $k,
+            $A, $offsetA, $ldA,
+            $B, $offsetB, $ldB,
+            $C, $offsetC, $ldC,
+        );
+        $last = $batchCount-1;
+        $this->assert_gemm_spec(
+            $transA, $transB,
+            $m, $n, $k,
+            $A, $offsetA+$last*$strideA, $ldA,
+            $B, $offsetB+$last*$strideB, $ldB,
+            $C, $offsetC+$last*$strideC, $ldC,
+        );
+        // The outputs must not overlap; the batch routines write them concurrently.
+        [$rowsC, $colsC] = ($order==BLASIF::ColMajor) ? [$n, $m] : [$m, $n];
+        $footprintC = ($rowsC-1)*$ldC+$colsC;
+        if($batchCount>1 && $strideC<$footprintC) {
+            throw new InvalidArgumentException("Argument strideC must be greater than or equal {$footprintC}.");
+        }
+
+        if($this->ffiGemmBatchStrided!==null) {
+            $bffi = $this->ffiGemmBatchStrided;
+            switch($dtype) {
+                case NDArray::float32:{
+                    $bffi->cblas_sgemm_batch_strided(
+                        $order,$transA,$transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A->addr($offsetA),$ldA,$strideA,
+                        $B->addr($offsetB),$ldB,$strideB,
+                        $beta,
+                        $C->addr($offsetC),$ldC,$strideC,
+                        $batchCount);
+                    break;
+                }
+                case NDArray::float64:{
+                    $bffi->cblas_dgemm_batch_strided(
+                        $order,$transA,$transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A->addr($offsetA),$ldA,$strideA,
+                        $B->addr($offsetB),$ldB,$strideB,
+                        $beta,
+                        $C->addr($offsetC),$ldC,$strideC,
+                        $batchCount);
+                    break;
+                }
+                case NDArray::complex64:{
+                    $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                    $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                    $beta = $this->toComplex($beta,$dtype);
+                    $betaptr = FFI::addr($beta);
+                    $bffi->cblas_cgemm_batch_strided(
+                        $order,$transA,$transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A->addr($offsetA),$ldA,$strideA,
+                        $B->addr($offsetB),$ldB,$strideB,
+                        $betaptr,
+                        $C->addr($offsetC),$ldC,$strideC,
+                        $batchCount);
+                    break;
+                }
+                case NDArray::complex128:{
+                    $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                    $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                    $beta = $this->toComplex($beta,$dtype);
+                    $betaptr = FFI::addr($beta);
+                    $bffi->cblas_zgemm_batch_strided(
+                        $order,$transA,$transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A->addr($offsetA),$ldA,$strideA,
+                        $B->addr($offsetB),$ldB,$strideB,
+                        $betaptr,
+                        $C->addr($offsetC),$ldC,$strideC,
+                        $batchCount);
+                    break;
+                }
+                default: {
+                    throw new InvalidArgumentException('Unsuppored data type');
+                }
+            }
+            return;
+        }
+
+        $ffi= $this->ffi;
+        switch($dtype) {
+            case NDArray::float32:{
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_sgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A->addr($offsetA+$i*$strideA),$ldA,
+                        $B->addr($offsetB+$i*$strideB),$ldB,
+                        $beta,
+                        $C->addr($offsetC+$i*$strideC),$ldC);
+                }
+                break;
+            }
+            case NDArray::float64:{
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_dgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alpha,
+                        $A->addr($offsetA+$i*$strideA),$ldA,
+                        $B->addr($offsetB+$i*$strideB),$ldB,
+                        $beta,
+                        $C->addr($offsetC+$i*$strideC),$ldC);
+                }
+                break;
+            }
+            case NDArray::complex64:{
+                $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                $beta = $this->toComplex($beta,$dtype);
+                $betaptr = FFI::addr($beta);
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_cgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A->addr($offsetA+$i*$strideA),$ldA,
+                        $B->addr($offsetB+$i*$strideB),$ldB,
+                        $betaptr,
+                        $C->addr($offsetC+$i*$strideC),$ldC);
+                }
+                break;
+            }
+            case NDArray::complex128:{
+                $alpha = $this->toComplex($alpha,$dtype);  // *** CAUTION ***
+                $alphaptr = FFI::addr($alpha);             // To keep object instance.
+                $beta = $this->toComplex($beta,$dtype);
+                $betaptr = FFI::addr($beta);
+                for($i=0; $i<$batchCount; $i++) {
+                    $ffi->cblas_zgemm(
+                        $order,
+                        $transA,
+                        $transB,
+                        $m,$n,$k,
+                        $alphaptr,
+                        $A->addr($offsetA+$i*$strideA),$ldA,
+                        $B->addr($offsetB+$i*$strideB),$ldB,
+                        $betaptr,
+                        $C->addr($offsetC+$i*$strideC),$ldC);
+                }
+                break;
+            }
+            default: {
+                throw new InvalidArgumentException('Unsuppored data type');
+            }
+        }
+    }
+
     public function symm(
         int $order,
         int $side,
@@ -1752,8 +2647,8 @@ class Blas
         BufferInterface $B, int $offsetB, int $ldB,
     ) : void
     {
-        if($this->isVecib()) {
-            throw new InvalidArgumentException("omatcopy is not supported on macOS.");
+        if(!$this->hasCapability('omatcopy')) {
+            throw new InvalidArgumentException("omatcopy is not supported by the loaded BLAS library.");
         }
         $ffi = $this->ffi;
         $this->assert_shape_parameter("m", $m);
@@ -1832,4 +2727,499 @@ class Blas
         }
     }
 
+
+    /**
+     *  Y := X for N-D views given by a shape and the strides of each dimension
+     *
+     *  Dimensions that are contiguous in both views are merged first. When
+     *  X and Y have their unit strides on different dimensions, each of those
+     *  2D slices is transposed with omatcopy. Otherwise the copy runs along
+     *  the dimension with the smallest stride in Y.
+     *
+     * @param array<int> $shape
+     * @param array<int> $stridesX
+     * @param array<int> $stridesY
+     */
+    public function copyStrided(
+        array $shape,
+        BufferInterface $X, int $offsetX, array $stridesX,
+        BufferInterface $Y, int $offsetY, array $stridesY,
+        ) : void
+    {
+        $shape = array_values($shape);
+        $stridesX = array_values($stridesX);
+        $stridesY = array_values($stridesY);
+        $ndim = count($shape);
+        if($ndim==0) {
+            throw new InvalidArgumentException("Argument shape must not be empty.");
+        }
+        if(count($stridesX)!=$ndim || count($stridesY)!=$ndim) {
+            throw new InvalidArgumentException("Unmatch number of dimensions for shape and strides.");
+        }
+        if($X->dtype()!=$Y->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y");
+        }
+        $lastX = $offsetX;
+        $lastY = $offsetY;
+        foreach($shape as $i => $size) {
+            $this->assert_shape_parameter("shape", $size);
+            if($stridesX[$i]<1) {
+                throw new InvalidArgumentException("Argument stridesX must be greater than 0.");
+            }
+            if($stridesY[$i]<1) {
+                throw new InvalidArgumentException("Argument stridesY must be greater than 0.");
+            }
+            $lastX += ($size-1)*$stridesX[$i];
+            $lastY += ($size-1)*$stridesY[$i];
+        }
+        foreach(['X'=>[$X, $offsetX, $lastX], 'Y'=>[$Y, $offsetY, $lastY]] as $name => [$buffer, $offset, $last]) {
+            if($offset<0) {
+                throw new InvalidArgumentException("Argument offset$name must be greater than equals 0.");
+            }
+            if($last>=count($buffer)) {
+                throw new InvalidArgumentException("Strided specification too large for buffer$name.");
+            }
+        }
+
+        // [size, strideX, strideY] without unit dimensions, contiguous ones merged
+        $dims = [];
+        foreach($shape as $i => $size) {
+            if($size==1) {
+                continue;
+            }
+            $last = count($dims)-1;
+            if($last>=0 && $dims[$last][1]==$size*$stridesX[$i] && $dims[$last][2]==$size*$stridesY[$i]) {
+                $dims[$last] = [$dims[$last][0]*$size, $stridesX[$i], $stridesY[$i]];
+            } else {
+                $dims[] = [$size, $stridesX[$i], $stridesY[$i]];
+            }
+        }
+        if(count($dims)==0) {
+            $dims[] = [1, 1, 1];
+        }
+
+        $innerY = $innerX = 0;
+        foreach($dims as $d => [, $strideX, $strideY]) {
+            if($strideY<=$dims[$innerY][2]) {
+                $innerY = $d;
+            }
+            if($strideX<=$dims[$innerX][1]) {
+                $innerX = $d;
+            }
+        }
+        $dtype = $X->dtype();
+        $transpose = $innerX!=$innerY &&
+            ($dtype==NDArray::float32 || $dtype==NDArray::float64) &&
+            $this->hasCapability('omatcopy') &&
+            $dims[$innerY][2]==1 && $dims[$innerX][1]==1 &&
+            $dims[$innerY][1]>=$dims[$innerX][0] && $dims[$innerX][2]>=$dims[$innerY][0];
+        [$rows, $ldX] = [$dims[$innerY][0], $dims[$innerY][1]];
+        [$cols, $ldY] = [$dims[$innerX][0], $dims[$innerX][2]];
+        $incY = $dims[$innerY][2];
+        $outer = $dims;
+        unset($outer[$innerY]);
+        if($transpose) {
+            unset($outer[$innerX]);
+        }
+        $outer = array_values($outer);
+
+        // walk the outer dimensions like an odometer
+        $index = array_fill(0, count($outer), 0);
+        $total = (int)array_product(array_column($outer, 0));
+        $posX = $offsetX;
+        $posY = $offsetY;
+        for($count=0; $count<$total; $count++) {
+            if($transpose) {
+                // X is a rows x cols RowMajor matrix, Y its transpose
+                $this->omatcopy(BLASIF::RowMajor, BLASIF::Trans, $rows, $cols, 1.0,
+                    $X, $posX, $ldX, $Y, $posY, $ldY);
+            } else {
+                $this->copy($rows, $X, $posX, $ldX, $Y, $posY, $incY);
+            }
+            for($d=count($outer)-1; $d>=0; $d--) {
+                [$size, $strideX, $strideY] = $outer[$d];
+                $index[$d]++;
+                $posX += $strideX;
+                $posY += $strideY;
+                if($index[$d]<$size) {
+                    break;
+                }
+                $index[$d] = 0;
+                $posX -= $size*$strideX;
+                $posY -= $size*$strideY;
+            }
+        }
+    }
+
+    /**
+     *  Y := X with the axes permuted, for contiguous RowMajor X and Y
+     *
+     *  Axis i of Y is axis perm[i] of X, as numpy.transpose(X, perm).
+     *
+     * @param array<int> $shape shape of X
+     * @param array<int> $perm
+     */
+    public function permute(
+        array $shape,
+        array $perm,
+        BufferInterface $X, int $offsetX,
+        BufferInterface $Y, int $offsetY,
+        ) : void
+    {
+        $shape = array_values($shape);
+        $perm = array_values($perm);
+        $ndim = count($shape);
+        $sorted = $perm;
+        sort($sorted);
+        if($ndim==0 || $sorted!==range(0, $ndim-1)) {
+            throw new InvalidArgumentException("Argument perm must be a permutation of the axes.");
+        }
+        $stridesX = [];
+        $stride = 1;
+        for($i=$ndim-1; $i>=0; $i--) {
+            $stridesX[$i] = $stride;
+            $stride *= $shape[$i];
+        }
+        // the stride in Y of each axis of X
+        $stridesY = [];
+        $stride = 1;
+        for($i=$ndim-1; $i>=0; $i--) {
+            $stridesY[$perm[$i]] = $stride;
+            $stride *= $shape[$perm[$i]];
+        }
+        ksort($stridesX);
+        ksort($stridesY);
+        $this->copyStrided($shape, $X, $offsetX, $stridesX, $Y, $offsetY, $stridesY);
+    }
+
+    /**
+     *  C := op(A - zeroPointA) * op(B - zeroPointB)
+     *
+     *  A and B are int8 or uint8. zeroPointA (int32) has an element for each
+     *  row of op(A) and zeroPointB for each column of op(B). An int32 C receives
+     *  the accumulators. A float32 or float64 C receives them multiplied by
+     *  scaleA[i]*scaleB[j], where the scales have the dtype of C.
+     *
+     *  This is a compatibility path, not a fast one. OpenBLAS has no integer
+     *  gemm, so op(B) and panels of rows of op(A) are converted to double,
+     *  each element once, the zero points are subtracted with dger and the
+     *  panels are multiplied with dgemm, which is exact for the int32 range.
+     *  The scales are applied to each finished panel with dscal. The
+     *  conversion runs in PHP and the product in double precision, so it is
+     *  slower than sgemm on the same matrices in float32, and op(B) takes
+     *  k*n doubles during the call.
+     */
+    public function gemmInt8(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $B, int $offsetB, int $ldB,
+        BufferInterface $C, int $offsetC, int $ldC,
+        ?BufferInterface $zeroPointA=null, int $offsetZeroPointA=0,
+        ?BufferInterface $zeroPointB=null, int $offsetZeroPointB=0,
+        ?BufferInterface $scaleA=null, int $offsetScaleA=0,
+        ?BufferInterface $scaleB=null, int $offsetScaleB=0,
+        ) : void
+    {
+        $ffi = $this->ffi;
+        if($order==BLASIF::ColMajor) {
+            // C^T := op(B)^T * op(A)^T in RowMajor
+            [$transA, $transB] = [$transB, $transA];
+            [$m, $n] = [$n, $m];
+            [$A, $offsetA, $ldA, $B, $offsetB, $ldB] = [$B, $offsetB, $ldB, $A, $offsetA, $ldA];
+            [$zeroPointA, $offsetZeroPointA, $zeroPointB, $offsetZeroPointB] =
+                [$zeroPointB, $offsetZeroPointB, $zeroPointA, $offsetZeroPointA];
+            [$scaleA, $offsetScaleA, $scaleB, $offsetScaleB] =
+                [$scaleB, $offsetScaleB, $scaleA, $offsetScaleA];
+        } elseif($order!=BLASIF::RowMajor) {
+            throw new InvalidArgumentException("unknown order: {$order}");
+        }
+        foreach(['A'=>$transA, 'B'=>$transB] as $name => $trans) {
+            if($trans!=BLASIF::NoTrans && $trans!=BLASIF::Trans) {
+                throw new InvalidArgumentException("unknown transpose mode for buffer{$name}.");
+            }
+        }
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("k", $k);
+        [$rowsA, $colsA] = ($transA==BLASIF::NoTrans) ? [$m, $k] : [$k, $m];
+        [$rowsB, $colsB] = ($transB==BLASIF::NoTrans) ? [$k, $n] : [$n, $k];
+        // Check Buffer A and B and C
+        $this->assert_matrix_buffer_spec("A", $A, $rowsA, $colsA, $offsetA, $ldA);
+        $this->assert_matrix_buffer_spec("B", $B, $rowsB, $colsB, $offsetB, $ldB);
+        $this->assert_matrix_buffer_spec("C", $C, $m, $n, $offsetC, $ldC);
+        foreach(['A'=>$A, 'B'=>$B] as $name => $buffer) {
+            if($buffer->dtype()!=NDArray::int8 && $buffer->dtype()!=NDArray::uint8) {
+                throw new InvalidArgumentException("Buffer{$name} must be int8 or uint8.");
+            }
+        }
+        $dtypeC = $C->dtype();
+        if($dtypeC==NDArray::int32) {
+            if($scaleA!==null || $scaleB!==null) {
+                throw new InvalidArgumentException("Scales need a float32 or float64 bufferC.");
+            }
+        } elseif($dtypeC!=NDArray::float32 && $dtypeC!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        $za = $this->readQuantizationParameter("zeroPointA", $zeroPointA, $offsetZeroPointA, $m, NDArray::int32);
+        $zb = $this->readQuantizationParameter("zeroPointB", $zeroPointB, $offsetZeroPointB, $n, NDArray::int32);
+        $sa = $this->readQuantizationParameter("scaleA", $scaleA, $offsetScaleA, $m, $dtypeC);
+        $sb = $this->readQuantizationParameter("scaleB", $scaleB, $offsetScaleB, $n, $dtypeC);
+        $ZA = ($za!==null) ? $this->packDoubles($za) : null;
+        $ZB = ($zb!==null) ? $this->packDoubles($zb) : null;
+
+        // op(B) is widened once for the whole product and op(A) one panel of
+        // rows at a time, so that each element is converted only once. The
+        // panel and, unless C is float64 and is accumulated in place, its rows
+        // of C are kept in the reusable scratch.
+        $mb = min($m, self::INT8_BLOCK_SIZE);
+        $BF = $ffi->new('double['.($k*$n).']');
+        if($transB==BLASIF::NoTrans) {
+            $this->widenInt8Block($B, $offsetB, $ldB, $k, $n, $BF);
+            $this->subtractZeroPoints($k, $n, $BF, $ZB, 0, false);
+        } else {
+            $this->widenInt8Block($B, $offsetB, $ldB, $n, $k, $BF);
+            $this->subtractZeroPoints($n, $k, $BF, $ZB, 0, true);
+        }
+        $inPlace = ($dtypeC==NDArray::float64);
+        $scratch = $this->batchScratch($mb*$k+($inPlace ? 0 : $mb*$n), NDArray::float64);
+        $AF = FFI::addr($scratch[0]);
+        for($i=0; $i<$m; $i+=$mb) {
+            $rows = min($mb, $m-$i);
+            // op(A)[i:i+rows] - zeroPointA[i:i+rows]
+            if($transA==BLASIF::NoTrans) {
+                $this->widenInt8Block($A, $offsetA+$i*$ldA, $ldA, $rows, $k, $AF);
+                $this->subtractZeroPoints($rows, $k, $AF, $ZA, $i, true);
+            } else {
+                $this->widenInt8Block($A, $offsetA+$i, $ldA, $k, $rows, $AF);
+                $this->subtractZeroPoints($k, $rows, $AF, $ZA, $i, false);
+            }
+            [$T, $ldT] = $inPlace ?
+                [$C->addr($offsetC+$i*$ldC), $ldC] : [FFI::addr($scratch[$mb*$k]), $n];
+            $ffi->cblas_dgemm(
+                BLASIF::RowMajor, $transA, $transB,
+                $rows, $n, $k,
+                1.0,
+                $AF, ($transA==BLASIF::NoTrans) ? $k : $rows,
+                $BF, ($transB==BLASIF::NoTrans) ? $n : $k,
+                0.0,
+                $T, $ldT);
+            // the accumulators are exact; scale them only once they are complete
+            if($sa!==null) {
+                for($r=0; $r<$rows; $r++) {
+                    $ffi->cblas_dscal($n, $sa[$i+$r], $T+$r*$ldT, 1);
+                }
+            }
+            if($sb!==null) {
+                for($c=0; $c<$n; $c++) {
+                    $ffi->cblas_dscal($rows, $sb[$c], $T+$c, $ldT);
+                }
+            }
+            if(!$inPlace) {
+                $format = ($dtypeC==NDArray::int32) ? 'l' : 'f';
+                for($r=0; $r<$rows; $r++) {
+                    $values = unpack('d*', FFI::string($T+$r*$ldT, $n*8));
+                    $data = pack($format.'*', ...$values);
+                    FFI::memcpy($C->addr($offsetC+($i+$r)*$ldC), $data, strlen($data));
+                }
+            }
+        }
+    }
+
+    /**
+     * Copy a rows x cols block of an int8 or uint8 matrix into packed doubles.
+     */
+    protected function widenInt8Block(
+        BufferInterface $X, int $offset, int $ld, int $rows, int $cols, FFI\CData $dst) : void
+    {
+        $format = ($X->dtype()==NDArray::int8) ? 'c' : 'C';
+        for($r=0; $r<$rows; $r++) {
+            $data = pack('d*', ...unpack($format.'*', FFI::string($X->addr($offset+$r*$ld), $cols)));
+            FFI::memcpy($dst+$r*$cols, $data, strlen($data));
+        }
+    }
+
+    /**
+     * Subtract zeroPoint[start+r] from each row r of a packed block, or
+     * zeroPoint[start+c] from each column c, as a rank-1 update.
+     */
+    protected function subtractZeroPoints(
+        int $rows, int $cols, FFI\CData $X, ?FFI\CData $zeroPoint, int $start, bool $perRow) : void
+    {
+        if($zeroPoint===null) {
+            return;
+        }
+        $z = FFI::addr($zeroPoint[$start]);
+        $ones = $this->ones(max($rows, $cols), NDArray::float64);
+        [$x, $y] = $perRow ? [$z, $ones] : [$ones, $z];
+        $this->ffi->cblas_dger(BLASIF::RowMajor, $rows, $cols, -1.0, $x, 1, $y, 1, $X, $cols);
+    }
+
+    /**
+     *  Q[i][j] := clamp(round(X[i][j] / scale) + zeroPoint)
+     *
+     *  Q is int8 or uint8. scale has the dtype of X and zeroPoint is int32.
+     *  Both have an element for each row, or for each column with perColumn.
+     */
+    public function quantize(
+        int $m,
+        int $n,
+        BufferInterface $X, int $offsetX, int $ldX,
+        BufferInterface $scale, int $offsetScale,
+        ?BufferInterface $zeroPoint, int $offsetZeroPoint,
+        BufferInterface $Q, int $offsetQ, int $ldQ,
+        bool $perColumn=false,
+        ) : void
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_matrix_buffer_spec("X", $X, $m, $n, $offsetX, $ldX);
+        $this->assert_matrix_buffer_spec("Q", $Q, $m, $n, $offsetQ, $ldQ);
+        $dtype = $X->dtype();
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        [$min, $max] = $this->quantizedRange($Q->dtype());
+        $size = $perColumn ? $n : $m;
+        $s = $this->readQuantizationParameter("scale", $scale, $offsetScale, $size, $dtype);
+        $z = $this->readQuantizationParameter("zeroPoint", $zeroPoint, $offsetZeroPoint, $size, NDArray::int32);
+
+        $values = $this->readMatrixValues($X, $offsetX, $m, $n, $ldX);
+        foreach($values as $idx => $value) {
+            $param = $perColumn ? $idx % $n : intdiv($idx, $n);
+            $q = (int)round($value / $s[$param]) + ($z!==null ? $z[$param] : 0);
+            $values[$idx] = min($max, max($min, $q));
+        }
+        $this->writeMatrixValues($Q, $offsetQ, $m, $n, $ldQ, $values);
+    }
+
+    /**
+     *  Y[i][j] := (Q[i][j] - zeroPoint) * scale
+     *
+     *  Q is int8, uint8 or int32 and Y is float32 or float64. scale has the
+     *  dtype of Y and zeroPoint is int32, as for quantize().
+     */
+    public function dequantize(
+        int $m,
+        int $n,
+        BufferInterface $Q, int $offsetQ, int $ldQ,
+        BufferInterface $scale, int $offsetScale,
+        ?BufferInterface $zeroPoint, int $offsetZeroPoint,
+        BufferInterface $Y, int $offsetY, int $ldY,
+        bool $perColumn=false,
+        ) : void
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_matrix_buffer_spec("Q", $Q, $m, $n, $offsetQ, $ldQ);
+        $this->assert_matrix_buffer_spec("Y", $Y, $m, $n, $offsetY, $ldY);
+        $dtype = $Y->dtype();
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        if($Q->dtype()!=NDArray::int32) {
+            $this->quantizedRange($Q->dtype());
+        }
+        $size = $perColumn ? $n : $m;
+        $s = $this->readQuantizationParameter("scale", $scale, $offsetScale, $size, $dtype);
+        $z = $this->readQuantizationParameter("zeroPoint", $zeroPoint, $offsetZeroPoint, $size, NDArray::int32);
+
+        $values = $this->readMatrixValues($Q, $offsetQ, $m, $n, $ldQ);
+        foreach($values as $idx => $value) {
+            $param = $perColumn ? $idx % $n : intdiv($idx, $n);
+            $values[$idx] = ($value - ($z!==null ? $z[$param] : 0)) * $s[$param];
+        }
+        $this->writeMatrixValues($Y, $offsetY, $m, $n, $ldY, $values);
+    }
+
+    /**
+     * @return array{int,int}
+     */
+    protected function quantizedRange(int $dtype) : array
+    {
+        switch($dtype) {
+            case NDArray::int8: {
+                return [-128, 127];
+            }
+            case NDArray::uint8: {
+                return [0, 255];
+            }
+            default: {
+                throw new InvalidArgumentException('Quantized data must be int8 or uint8.');
+            }
+        }
+    }
+
+    /**
+     * @return array<int,int|float>|null
+     */
+    protected function readQuantizationParameter(
+        string $name, ?BufferInterface $buffer, int $offset, int $size, int $dtype) : ?array
+    {
+        if($buffer===null) {
+            return null;
+        }
+        $this->assert_vector_buffer_spec($name, $buffer, $size, $offset, 1);
+        if($buffer->dtype()!=$dtype) {
+            throw new InvalidArgumentException("Unmatch data type for {$name}");
+        }
+        $values = $this->readMatrixValues($buffer, $offset, 1, $size, $size);
+        // scales are float; a zero or non-finite scale has no quantized form
+        if($dtype==NDArray::float32 || $dtype==NDArray::float64) {
+            foreach($values as $value) {
+                if($value==0.0 || !is_finite($value)) {
+                    throw new InvalidArgumentException("{$name} must be finite and non-zero.");
+                }
+            }
+        }
+        return $values;
+    }
+
+    /**
+     * The elements of a RowMajor matrix as a packed PHP array.
+     *
+     * @return array<int,int|float>
+     */
+    protected function readMatrixValues(
+        BufferInterface $X, int $offset, int $rows, int $cols, int $ld) : array
+    {
+        if($ld==$cols) {
+            return $this->readValues($X, $offset, $rows*$cols);
+        }
+        $values = [];
+        for($i=0; $i<$rows; $i++) {
+            array_push($values, ...$this->readValues($X, $offset+$i*$ld, $cols));
+        }
+        return $values;
+    }
+
+    /**
+     * @param array<int,int|float> $values packed rows
+     */
+    protected function writeMatrixValues(
+        BufferInterface $X, int $offset, int $rows, int $cols, int $ld, array $values) : void
+    {
+        if($ld==$cols) {
+            $this->writeValues($X, $offset, $values);
+            return;
+        }
+        foreach(array_chunk($values, $cols) as $i => $row) {
+            $this->writeValues($X, $offset+$i*$ld, $row);
+        }
+    }
+
+    /**
+     * @param array<int,int|float> $values
+     */
+    protected function packDoubles(array $values) : FFI\CData
+    {
+        $data = pack('d*', ...$values);
+        $buffer = $this->ffi->new('double['.count($values).']');
+        FFI::memcpy($buffer, $data, strlen($data));
+        return $buffer;
+    }
 }
@@ -0,0 +1,299 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+use InvalidArgumentException;
+use RuntimeException;
+use FFI;
+
+/**
+ * Bulk transfer between buffers and raw binary or NumPy .npy files.
+ *
+ * Data is streamed in chunks of CHUNK_SIZE bytes that are copied into the
+ * buffer memory with FFI::memcpy, and bytes are swapped only when the file
+ * has the other byte order than the host.
+ */
+class BufferIO
+{
+    use Utils;
+
+    const CHUNK_SIZE = 1048576;
+    const NPY_MAGIC = "\x93NUMPY";
+    // .npy headers are padded so that the data is aligned for any type
+    const NPY_ALIGNMENT = 64;
+
+    /**
+     * The .npy type of each data type, without the byte order.
+     */
+    const NPY_TYPES = [
+        NDArray::bool       => 'b1',
+        NDArray::int8       => 'i1',
+        NDArray::uint8      => 'u1',
+        NDArray::int16      => 'i2',
+        NDArray::uint16     => 'u2',
+        NDArray::int32      => 'i4',
+        NDArray::uint32     => 'u4',
+        NDArray::int64      => 'i8',
+        NDArray::uint64     => 'u8',
+        NDArray::float32    => 'f4',
+        NDArray::float64    => 'f8',
+        NDArray::complex64  => 'c8',
+        NDArray::complex128 => 'c16',
+    ];
+
+    protected bool $littleEndianHost;
+
+    public function __construct()
+    {
+        $this->littleEndianHost = (pack('S', 1)==="\x01\x00");
+    }
+
+    /**
+     * Read count elements from a raw file at a byte offset into the buffer.
+     * count defaults to the rest of the file. Returns the elements read.
+     */
+    public function readRaw(
+        string $filename,
+        BufferInterface $buffer, int $offset=0, ?int $count=null,
+        int $fileOffset=0,
+        bool $bigEndian=false,
+        ) : int
+    {
+        $fp = $this->open($filename, 'rb');
+        try {
+            if($count===null) {
+                $fileSize = fstat($fp)['size'];
+                $count = intdiv(max($fileSize-$fileOffset, 0), $buffer->value_size());
+            }
+            if($fileOffset>0 && fseek($fp, $fileOffset)!=0) {
+                throw new RuntimeException("Cannot seek in file: {$filename}");
+            }
+            $this->readStream($fp, $filename, $buffer, $offset, $count, $bigEndian);
+        } finally {
+            fclose($fp);
+        }
+        return $count;
+    }
+
+    /**
+     * Write count elements of the buffer to a raw file, or append them.
+     */
+    public function writeRaw(
+        string $filename,
+        BufferInterface $buffer, int $offset=0, ?int $count=null,
+        bool $bigEndian=false,
+        bool $append=false,
+        ) : void
+    {
+        $count ??= count($buffer)-$offset;
+        $fp = $this->open($filename, $append ? 'ab' : 'wb');
+        try {
+            $this->writeStream($fp, $filename, $buffer, $offset, $count, $bigEndian);
+        } finally {
+            fclose($fp);
+        }
+    }
+
+    /**
+     * The header of a .npy file. The data starts dataOffset bytes into the
+     * file, which is also the offset to map it with MappedBuffer.
+     *
+     * @return array{dtype:int,shape:array<int>,fortranOrder:bool,bigEndian:bool,dataOffset:int}
+     */
+    public function npyHeader(string $filename) : array
+    {
+        $fp = $this->open($filename, 'rb');
+        try {
+            return $this->readNpyHeader($fp, $filename);
+        } finally {
+            fclose($fp);
+        }
+    }
+
+    /**
+     * Load a .npy file into the buffer and return its header.
+     * Fortran-ordered data is loaded as stored; see fortranOrder.
+     *
+     * @return array{dtype:int,shape:array<int>,fortranOrder:bool,bigEndian:bool,dataOffset:int}
+     */
+    public function loadNpy(string $filename, BufferInterface $buffer, int $offset=0) : array
+    {
+        $fp = $this->open($filename, 'rb');
+        try {
+            $header = $this->readNpyHeader($fp, $filename);
+            if($header['dtype']!=$buffer->dtype()) {
+                throw new InvalidArgumentException("Unmatch data type for the buffer and {$filename}");
+            }
+            $count = (int)array_product($header['shape']);
+            $this->readStream($fp, $filename, $buffer, $offset, $count, $header['bigEndian']);
+        } finally {
+            fclose($fp);
+        }
+        return $header;
+    }
+
+    /**
+     * Save size-of-shape elements of the buffer as a C-ordered .npy file.
+     *
+     * @param array<int> $shape
+     */
+    public function saveNpy(string $filename, BufferInterface $buffer, int $offset, array $shape) : void
+    {
+        $dtype = $buffer->dtype();
+        if(!isset(self::NPY_TYPES[$dtype])) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        $count = (int)array_product($shape);
+        $byteOrder = (self::NPY_TYPES[$dtype][1]=='1') ? '|' : '<';
+        $dims = implode(', ', array_map('intval', $shape)).((count($shape)==1) ? ',' : '');
+        $dict = "{'descr': '{$byteOrder}".self::NPY_TYPES[$dtype]."', 'fortran_order': False, 'shape': ({$dims}), }";
+        $prefixSize = strlen(self::NPY_MAGIC)+4;
+        $length = strlen($dict)+1;
+        $length += (self::NPY_ALIGNMENT - ($prefixSize+$length) % self::NPY_ALIGNMENT) % self::NPY_ALIGNMENT;
+        if($length>0xffff) {
+            throw new InvalidArgumentException('The shape is too long for a .npy header.');
+        }
+        $header = self::NPY_MAGIC."\x01\x00".pack('v', $length).str_pad($dict, $length-1)."\n";
+
+        $fp = $this->open($filename, 'wb');
+        try {
+            if(fwrite($fp, $header)!==strlen($header)) {
+                throw new RuntimeException("Cannot write file: {$filename}");
+            }
+            $this->writeStream($fp, $filename, $buffer, $offset, $count, false);
+        } finally {
+            fclose($fp);
+        }
+    }
+
+    /**
+     * @return resource
+     */
+    protected function open(string $filename, string $mode)
+    {
+        $fp = @fopen($filename, $mode);
+        if($fp===false) {
+            throw new RuntimeException("Cannot open file: {$filename}");
+        }
+        return $fp;
+    }
+
+    /**
+     * @param resource $fp
+     * @return array{dtype:int,shape:array<int>,fortranOrder:bool,bigEndian:bool,dataOffset:int}
+     */
+    protected function readNpyHeader($fp, string $filename) : array
+    {
+        $prefix = fread($fp, strlen(self::NPY_MAGIC)+2);
+        if($prefix===false || strncmp($prefix, self::NPY_MAGIC, strlen(self::NPY_MAGIC))!=0) {
+            throw new InvalidArgumentException("Not a .npy file: {$filename}");
+        }
+        $major = ord($prefix[strlen(self::NPY_MAGIC)]);
+        $lengthSize = ($major==1) ? 2 : 4;
+        $lengthData = fread($fp, $lengthSize);
+        if($lengthData===false || strlen($lengthData)!=$lengthSize) {
+            throw new InvalidArgumentException("Broken .npy header: {$filename}");
+        }
+        $length = unpack(($major==1) ? 'v' : 'V', $lengthData)[1];
+        $dict = fread($fp, $length);
+        if($dict===false || strlen($dict)!=$length) {
+            throw new InvalidArgumentException("Broken .npy header: {$filename}");
+        }
+        if(!preg_match("/'descr'\s*:\s*'([<>|=])([a-z]\d+)'/", $dict, $descr) ||
+            !preg_match("/'fortran_order'\s*:\s*(True|False)/", $dict, $order) ||
+            !preg_match("/'shape'\s*:\s*\(([\d,\s]*)\)/", $dict, $shape)) {
+            throw new InvalidArgumentException("Broken .npy header: {$filename}");
+        }
+        $dtype = array_search($descr[2], self::NPY_TYPES, true);
+        if($dtype===false) {
+            throw new InvalidArgumentException("Unsupported .npy type {$descr[1]}{$descr[2]}: {$filename}");
+        }
+        $dims = array_values(array_filter(array_map('trim', explode(',', $shape[1])), 'strlen'));
+        $bigEndian = ($descr[1]=='>') || ($descr[1]=='=' && !$this->littleEndianHost);
+        return [
+            'dtype' => $dtype,
+            'shape' => array_map('intval', $dims),
+            'fortranOrder' => $order[1]=='True',
+            'bigEndian' => $bigEndian,
+            'dataOffset' => strlen(self::NPY_MAGIC)+2+$lengthSize+$length,
+        ];
+    }
+
+    /**
+     * @param resource $fp
+     */
+    protected function readStream(
+        $fp, string $filename,
+        BufferInterface $buffer, int $offset, int $count, bool $bigEndian) : void
+    {
+        if($count==0) {
+            return;
+        }
+        $this->assert_buffer_size($buffer, $offset, $count, "Buffer size is too small for {$count} elements.");
+        $valueSize = $buffer->value_size();
+        $swap = $this->swapWidth($buffer->dtype(), $bigEndian);
+        $chunk = intdiv(self::CHUNK_SIZE, $valueSize);
+        for($done=0; $done<$count; $done+=$n) {
+            $n = min($chunk, $count-$done);
+            $bytes = $n*$valueSize;
+            $data = fread($fp, $bytes);
+            if($data===false || strlen($data)!=$bytes) {
+                throw new RuntimeException("Unexpected end of file: {$filename}");
+            }
+            if($swap>1) {
+                $data = $this->swapBytes($data, $swap);
+            }
+            $addr = $buffer->addr($offset+$done);
+            FFI::memcpy($addr, $data, $bytes);
+        }
+    }
+
+    /**
+     * @param resource $fp
+     */
+    protected function writeStream(
+        $fp, string $filename,
+        BufferInterface $buffer, int $offset, int $count, bool $bigEndian) : void
+    {
+        if($count==0) {
+            return;
+        }
+        $this->assert_buffer_size($buffer, $offset, $count, "Buffer size is too small for {$count} elements.");
+        $valueSize = $buffer->value_size();
+        $swap = $this->swapWidth($buffer->dtype(), $bigEndian);
+        $chunk = intdiv(self::CHUNK_SIZE, $valueSize);
+        for($done=0; $done<$count; $done+=$n) {
+            $n = min($chunk, $count-$done);
+            $bytes = $n*$valueSize;
+            $data = FFI::string($buffer->addr($offset+$done), $bytes);
+            if($swap>1) {
+                $data = $this->swapBytes($data, $swap);
+            }
+            if(fwrite($fp, $data)!==$bytes) {
+                throw new RuntimeException("Cannot write file: {$filename}");
+            }
+        }
+    }
+
+    /**
+     * Width of the values to byte-swap, or 0 when the file has the host byte order.
+     */
+    protected function swapWidth(int $dtype, bool $bigEndian) : int
+    {
+        if(!isset(self::NPY_TYPES[$dtype])) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        if($bigEndian!=$this->littleEndianHost) {
+            return 0;
+        }
+        $width = (int)substr(self::NPY_TYPES[$dtype], 1);
+        // the real and imaginary parts are swapped separately
+        return ($dtype==NDArray::complex64 || $dtype==NDArray::complex128) ? intdiv($width, 2) : $width;
+    }
+
+    protected function swapBytes(string $data, int $width) : string
+    {
+        return implode('', array_map('strrev', str_split($data, $width)));
+    }
+}
@@ -0,0 +1,170 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use InvalidArgumentException;
+use RuntimeException;
+
+/**
+ * Replays a trace of CallTracer on synthetic buffers and times the calls again.
+ *
+ * Every buffer of a call is replaced by a buffer of the same type and size,
+ * filled with fixed pseudo-random values for floating point types and zeros
+ * otherwise. The buffers are reused by later calls, so the replay measures
+ * warm calls like a loop of the traced job does.
+ */
+class CallReplayer
+{
+    use Utils;
+
+    // values repeated to fill a buffer
+    protected const PATTERN_SIZE = 65536;
+    // upper bound of the values of the pattern generator
+    protected const RANDOM_MAX = 2147483647;
+
+    protected Blas $blas;
+    protected ?Lapack $lapack;
+    /** @var array<string,AnonymousBuffer> $buffers */
+    protected array $buffers = [];
+
+    public function __construct(Blas $blas, ?Lapack $lapack=null)
+    {
+        $this->blas = $blas;
+        $this->lapack = $lapack;
+    }
+
+    /**
+     * Run each call repeat times. Returns the calls with the traced time "ns"
+     * and the fastest replayed time "replayed" in nanoseconds.
+     *
+     * @param iterable<array<string,mixed>> $records calls from CallTracer::read()
+     * @return array<int,array{library:string,routine:string,dtype:?int,ns:int,replayed:int}>
+     */
+    public function replay(iterable $records, int $repeat=1) : array
+    {
+        if($repeat<1) {
+            throw new InvalidArgumentException('Argument repeat must be greater than 0.');
+        }
+        $results = [];
+        foreach($records as $record) {
+            switch($record['library']) {
+                case 'blas': {
+                    $target = $this->blas;
+                    break;
+                }
+                case 'lapack': {
+                    if($this->lapack===null) {
+                        throw new RuntimeException('lapack is not available for the replay.');
+                    }
+                    $target = $this->lapack;
+                    break;
+                }
+                default: {
+                    throw new InvalidArgumentException("Unknown library in the trace: {$record['library']}");
+                }
+            }
+            $routine = $record['routine'];
+            if(!method_exists($target, $routine)) {
+                throw new InvalidArgumentException("Unknown routine in the trace: {$record['library']}.{$routine}");
+            }
+            $ordinals = [];
+            $assigned = [];
+            $args = [];
+            foreach($record['args'] as $name => $value) {
+                $args[$name] = $this->restore($value, $ordinals, $assigned);
+            }
+            $best = PHP_INT_MAX;
+            for($i=0; $i<$repeat; $i++) {
+                $start = hrtime(true);
+                $target->$routine(...$args);
+                $best = min($best, hrtime(true)-$start);
+            }
+            $results[] = [
+                'library' => $record['library'],
+                'routine' => $routine,
+                'dtype' => $record['dtype'] ?? null,
+                'ns' => (int)($record['ns'] ?? 0),
+                'replayed' => $best,
+            ];
+        }
+        return $results;
+    }
+
+    /**
+     * Release the synthetic buffers.
+     */
+    public function clear() : void
+    {
+        foreach($this->buffers as $buffer) {
+            $buffer->close();
+        }
+        $this->buffers = [];
+    }
+
+    /**
+     * @param array<string,int> $ordinals buffers of each type and size taken by this call
+     * @param array<int,AnonymousBuffer> $assigned buffers of this call by traced id
+     */
+    protected function restore(mixed $value, array &$ordinals, array &$assigned) : mixed
+    {
+        if(!is_array($value)) {
+            return $value;
+        }
+        if(isset($value['buffer'], $value['size'], $value['id'])) {
+            $id = $value['id'];
+            if(!isset($assigned[$id])) {
+                $key = $value['buffer'].':'.$value['size'];
+                $ordinals[$key] = ($ordinals[$key] ?? -1)+1;
+                $assigned[$id] = $this->buffer($value['buffer'], $value['size'], $ordinals[$key]);
+            }
+            return $assigned[$id];
+        }
+        if(array_key_exists('real', $value) && array_key_exists('imag', $value)) {
+            return (object)['real' => $value['real'], 'imag' => $value['imag']];
+        }
+        $list = [];
+        foreach($value as $key => $item) {
+            $list[$key] = $this->restore($item, $ordinals, $assigned);
+        }
+        return $list;
+    }
+
+    protected function buffer(int $dtype, int $size, int $ordinal) : AnonymousBuffer
+    {
+        $key = "{$dtype}:{$size}:{$ordinal}";
+        if(!isset($this->buffers[$key])) {
+            $buffer = new AnonymousBuffer($size, $dtype);
+            $this->fill($buffer, $dtype, $size);
+            $this->buffers[$key] = $buffer;
+        }
+        return $this->buffers[$key];
+    }
+
+    protected function fill(AnonymousBuffer $buffer, int $dtype, int $size) : void
+    {
+        $complex = ($dtype==NDArray::complex64 || $dtype==NDArray::complex128);
+        if(!$complex && $dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            return;
+        }
+        [$format] = $this->packFormat($dtype);
+        $count = $complex ? 2*$size : $size;
+        // a generator of its own, so that the global mt_rand sequence is kept
+        if(PHP_VERSION_ID>=80200) {
+            $randomizer = new \Random\Randomizer(new \Random\Engine\Mt19937($size));
+            $next = fn() => $randomizer->getInt(0, self::RANDOM_MAX);
+        } else {
+            $state = $size & self::RANDOM_MAX;
+            $next = function() use (&$state) {
+                $state = ($state*1103515245+12345) & self::RANDOM_MAX;
+                return $state;
+            };
+        }
+        $values = [];
+        for($i=0; $i<min($count, self::PATTERN_SIZE); $i++) {
+            $values[] = $next()/self::RANDOM_MAX*2.0-1.0;
+        }
+        $pattern = pack($format.'*', ...$values);
+        $bytes = $size*$buffer->value_size();
+        $buffer->load(substr(str_repeat($pattern, intdiv($bytes, strlen($pattern))+1), 0, $bytes));
+    }
+}
@@ -0,0 +1,174 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+use InvalidArgumentException;
+use RuntimeException;
+use ReflectionMethod;
+use Generator;
+use FFI;
+use FFI\Exception as FFIException;
+
+/**
+ * Writes the calls of TracedBlas and TracedLapack to a JSONL file, one call per line:
+ *
+ *   {"library":"blas","routine":"gemm","dtype":12,"args":{"order":101,...},"ns":52310}
+ *
+ * Scalars are kept as they are, complex scalars become {"real":..,"imag":..} and
+ * buffers {"buffer":dtype,"size":count,"id":n}, where calls that pass the same
+ * buffer twice have the same id. No buffer contents are written, so the trace
+ * can be replayed on synthetic buffers with CallReplayer.
+ * Any stream wrapper can be used, e.g. "compress.zlib://trace.jsonl.gz".
+ */
+class CallTracer
+{
+    /** @var array<string,array<string>> $parameterNames */
+    protected static array $parameterNames = [];
+
+    /** @var resource|null $stream */
+    protected $stream;
+    protected string $path;
+    protected int $calls = 0;
+
+    public function __construct(string $path, bool $append=false)
+    {
+        $stream = @fopen($path, $append ? 'ab' : 'wb');
+        if($stream===false) {
+            throw new RuntimeException("Cannot open trace file: {$path}");
+        }
+        $this->stream = $stream;
+        $this->path = $path;
+    }
+
+    public function __destruct()
+    {
+        $this->close();
+    }
+
+    public function close() : void
+    {
+        if($this->stream!==null) {
+            fclose($this->stream);
+            $this->stream = null;
+        }
+    }
+
+    /**
+     * Number of calls written.
+     */
+    public function calls() : int
+    {
+        return $this->calls;
+    }
+
+    /**
+     * Write one call of class::routine. Positional arguments are named after
+     * the parameters of the method.
+     *
+     * @param array<mixed> $args
+     */
+    public function record(string $library, string $class, string $routine, array $args, int $elapsed) : void
+    {
+        if($this->stream===null) {
+            throw new RuntimeException('The trace file is closed.');
+        }
+        $names = static::parameterNames($class, $routine);
+        $ids = [];
+        $dtype = null;
+        $named = [];
+        foreach($args as $key => $value) {
+            $name = is_int($key) ? ($names[$key] ?? (string)$key) : $key;
+            $named[$name] = $this->describe($value, $ids, $dtype);
+        }
+        $line = json_encode([
+            'library' => $library,
+            'routine' => $routine,
+            'dtype' => $dtype,
+            'args' => (object)$named,
+            'ns' => $elapsed,
+        ], JSON_PRESERVE_ZERO_FRACTION);
+        if($line===false || fwrite($this->stream, $line."\n")===false) {
+            throw new RuntimeException("Cannot write trace file: {$this->path}");
+        }
+        $this->calls++;
+    }
+
+    /**
+     * The calls of a trace file.
+     *
+     * @return Generator<int,array{library:string,routine:string,dtype:?int,args:array<string,mixed>,ns:int}>
+     */
+    public static function read(string $path) : Generator
+    {
+        $stream = @fopen($path, 'rb');
+        if($stream===false) {
+            throw new RuntimeException("Cannot open trace file: {$path}");
+        }
+        try {
+            $number = 0;
+            while(($line = fgets($stream))!==false) {
+                $number++;
+                $line = trim($line);
+                if($line==='') {
+                    continue;
+                }
+                $record = json_decode($line, true);
+                if(!is_array($record) || !isset($record['library'], $record['routine'], $record['args'])) {
+                    throw new InvalidArgumentException("Broken trace record at line {$number} of {$path}");
+                }
+                yield $record;
+            }
+        } finally {
+            fclose($stream);
+        }
+    }
+
+    /**
+     * @return array<string>
+     */
+    protected static function parameterNames(string $class, string $routine) : array
+    {
+        $key = $class.'::'.$routine;
+        if(!isset(self::$parameterNames[$key])) {
+            $names = [];
+            if(method_exists($class, $routine)) {
+                foreach((new ReflectionMethod($class, $routine))->getParameters() as $parameter) {
+                    $names[] = $parameter->getName();
+                }
+            }
+            self::$parameterNames[$key] = $names;
+        }
+        return self::$parameterNames[$key];
+    }
+
+    /**
+     * @param array<int,int> $ids buffer ids of this call by object id
+     */
+    protected function describe(mixed $value, array &$ids, ?int &$dtype) : mixed
+    {
+        if($value instanceof BufferInterface) {
+            $objectId = spl_object_id($value);
+            $ids[$objectId] ??= count($ids);
+            $dtype ??= $value->dtype();
+            return ['buffer' => $value->dtype(), 'size' => count($value), 'id' => $ids[$objectId]];
+        }
+        if(is_array($value)) {
+            $list = [];
+            foreach($value as $key => $item) {
+                $list[$key] = $this->describe($item, $ids, $dtype);
+            }
+            return $list;
+        }
+        if(is_object($value)) {
+            try {
+                if(isset($value->real) || $value instanceof FFI\CData) {
+                    return ['real' => (float)$value->real, 'imag' => (float)$value->imag];
+                }
+            } catch(FFIException $e) {
+                // not a complex number
+            }
+            return ['object' => get_class($value)];
+        }
+        return $value;
+    }
+}
@@ -0,0 +1,140 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use FFI;
+
+/**
+ * A sparse matrix prepared by Sparse::csr() or Sparse::csc().
+ *
+ * The structure is validated once and kept as the compressed rows of A and,
+ * the first time a transposed product needs them, of A^T. The values are
+ * copied, so later changes to the buffers they came from are not seen.
+ */
+class CompressedMatrix
+{
+    protected object $ffi;
+    protected int $rows;
+    protected int $cols;
+    protected int $dtype;
+    protected int $nnz;
+    /**
+     * The compressed rows [indptr, indices, values] of A (false) and A^T (true).
+     *
+     * @var array<int,array{array<int,int>,array<int,int>,FFI\CData}> $forms
+     */
+    protected array $forms = [];
+
+    /**
+     * indptr starts at 0 and indices are in range; Sparse checks both.
+     * With transposed, the arrays are the compressed rows of A^T, as given
+     * by the CSC form of A.
+     *
+     * @param array<int,int> $indptr
+     * @param array<int,int> $indices
+     * @param array<int,float> $values
+     */
+    public function __construct(
+        FFI|SuffixedFFI $ffi,
+        int $rows,
+        int $cols,
+        int $dtype,
+        array $indptr,
+        array $indices,
+        array $values,
+        bool $transposed=false,
+        )
+    {
+        $this->ffi = $ffi;
+        $this->rows = $rows;
+        $this->cols = $cols;
+        $this->dtype = $dtype;
+        $this->nnz = count($values);
+        $this->forms[(int)$transposed] = [$indptr, $indices, $this->pack($values)];
+    }
+
+    public function rows() : int
+    {
+        return $this->rows;
+    }
+
+    public function cols() : int
+    {
+        return $this->cols;
+    }
+
+    public function dtype() : int
+    {
+        return $this->dtype;
+    }
+
+    public function nnz() : int
+    {
+        return $this->nnz;
+    }
+
+    /**
+     * The compressed rows [indptr, indices, values] of A, or of A^T with
+     * transpose. values is a C array of the dtype.
+     *
+     * @return array{array<int,int>,array<int,int>,FFI\CData}
+     */
+    public function compressedRows(bool $transpose) : array
+    {
+        if(!isset($this->forms[(int)$transpose])) {
+            $this->forms[(int)$transpose] = $this->transpose(
+                $transpose ? $this->cols : $this->rows, ...$this->forms[(int)!$transpose]);
+        }
+        return $this->forms[(int)$transpose];
+    }
+
+    /**
+     * The compressed rows of the transpose, which has minor rows, by a
+     * counting sort of the indices.
+     *
+     * @param array<int,int> $indptr
+     * @param array<int,int> $indices
+     * @return array{array<int,int>,array<int,int>,FFI\CData}
+     */
+    protected function transpose(int $minor, array $indptr, array $indices, FFI\CData $values) : array
+    {
+        $major = count($indptr)-1;
+        $format = ($this->dtype==NDArray::float32) ? 'f' : 'd';
+        $size = ($this->dtype==NDArray::float32) ? 4 : 8;
+        $val = ($this->nnz>0) ?
+            array_values(unpack($format.'*', FFI::string($values, $this->nnz*$size))) : [];
+
+        $ptr = array_fill(0, $minor+1, 0);
+        foreach($indices as $j) {
+            $ptr[$j+1]++;
+        }
+        for($j=0; $j<$minor; $j++) {
+            $ptr[$j+1] += $ptr[$j];
+        }
+        $next = $ptr;
+        $idx = array_fill(0, $this->nnz, 0);
+        $valT = array_fill(0, $this->nnz, 0.0);
+        for($i=0; $i<$major; $i++) {
+            for($p=$indptr[$i]; $p<$indptr[$i+1]; $p++) {
+                $q = $next[$indices[$p]]++;
+                $idx[$q] = $i;
+                $valT[$q] = $val[$p];
+            }
+        }
+        return [$ptr, $idx, $this->pack($valT)];
+    }
+
+    /**
+     * @param array<int,float> $values
+     */
+    protected function pack(array $values) : FFI\CData
+    {
+        $type = ($this->dtype==NDArray::float32) ? 'float' : 'double';
+        $buffer = $this->ffi->new("{$type}[".max(count($values), 1)."]");
+        if(count($values)>0) {
+            $data = pack(($this->dtype==NDArray::float32) ? 'f*' : 'd*', ...$values);
+            FFI::memcpy($buffer, $data, strlen($data));
+        }
+        return $buffer;
+    }
+}
@@ -0,0 +1,363 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use InvalidArgumentException;
+use FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+
+/**
+ * im2col, col2im and convolution by gemm for 1D, 2D and 3D channels-last images.
+ *
+ *   images:  [batches, ...imageShape, channels]
+ *   cols:    [batches, ...outputShape, ...kernelShape, channels]
+ *   kernel:  [...kernelShape, channels, filters]
+ *   outputs: [batches, ...outputShape, filters]
+ *
+ * outputShape[i] = (imageShape[i] + 2*paddings[i] - dilations[i]*(kernelShape[i]-1) - 1) / strides[i] + 1
+ *
+ * Patches are moved with one memcpy per run of contiguous channels, or per
+ * kernel row when the innermost dilation is 1, and padding is filled with memset.
+ */
+class Convolution
+{
+    use Utils;
+
+    // Number of elements in the patch scratch buffer of convolution()
+    const SCRATCH_SIZE = 1048576;
+
+    protected object $ffi;
+    /** @var array<int,FFI\CData> $scratch */
+    protected array $scratch = [];
+
+    public function __construct(FFI|SuffixedFFI $ffi)
+    {
+        $this->ffi = $ffi;
+    }
+
+    /**
+     * Output shape of a convolution.
+     *
+     * @param array<int> $imageShape
+     * @param array<int> $kernelShape
+     * @param array<int>|null $strides
+     * @param array<int>|null $paddings
+     * @param array<int>|null $dilations
+     * @return array<int>
+     */
+    public function outputShape(
+        array $imageShape,
+        array $kernelShape,
+        ?array $strides=null,
+        ?array $paddings=null,
+        ?array $dilations=null) : array
+    {
+        $geometry = $this->geometry(1, $imageShape, 1, $kernelShape, $strides, $paddings, $dilations);
+        return array_slice($geometry['out'], 3-count($imageShape));
+    }
+
+    /**
+     * Extract the patches of images into cols.
+     *
+     * @param array<int> $imageShape
+     * @param array<int> $kernelShape
+     * @param array<int>|null $strides
+     * @param array<int>|null $paddings
+     * @param array<int>|null $dilations
+     */
+    public function im2col(
+        int $batches,
+        array $imageShape,
+        int $channels,
+        array $kernelShape,
+        ?array $strides,
+        ?array $paddings,
+        ?array $dilations,
+        BufferInterface $images, int $offsetImages,
+        BufferInterface $cols, int $offsetCols ) : void
+    {
+        $geometry = $this->geometry($batches, $imageShape, $channels, $kernelShape, $strides, $paddings, $dilations);
+        $dtype = $this->assert_buffers($geometry, $images, $offsetImages, $cols, $offsetCols);
+        $this->copyPatches(
+            $geometry, $dtype,
+            $images->addr($offsetImages),
+            0, $geometry['rows'],
+            $cols->addr($offsetCols), false);
+    }
+
+    /**
+     * Add the patches in cols back to images. The images are cleared first.
+     *
+     * @param array<int> $imageShape
+     * @param array<int> $kernelShape
+     * @param array<int>|null $strides
+     * @param array<int>|null $paddings
+     * @param array<int>|null $dilations
+     */
+    public function col2im(
+        int $batches,
+        array $imageShape,
+        int $channels,
+        array $kernelShape,
+        ?array $strides,
+        ?array $paddings,
+        ?array $dilations,
+        BufferInterface $cols, int $offsetCols,
+        BufferInterface $images, int $offsetImages ) : void
+    {
+        $geometry = $this->geometry($batches, $imageShape, $channels, $kernelShape, $strides, $paddings, $dilations);
+        $dtype = $this->assert_buffers($geometry, $images, $offsetImages, $cols, $offsetCols);
+        $imagesPtr = $images->addr($offsetImages);
+        FFI::memset($imagesPtr, 0, $geometry['imageSize']*$this->elementSize($dtype));
+        $this->copyPatches(
+            $geometry, $dtype,
+            $imagesPtr,
+            0, $geometry['rows'],
+            $cols->addr($offsetCols), true);
+    }
+
+    /**
+     * outputs := im2col(images) * kernel
+     *
+     * The patches are extracted into a scratch buffer of at most SCRATCH_SIZE
+     * elements, one tile of output rows at a time, and each tile is one gemm.
+     *
+     * @param array<int> $imageShape
+     * @param array<int> $kernelShape
+     * @param array<int>|null $strides
+     * @param array<int>|null $paddings
+     * @param array<int>|null $dilations
+     */
+    public function convolution(
+        int $batches,
+        array $imageShape,
+        int $channels,
+        array $kernelShape,
+        int $filters,
+        ?array $strides,
+        ?array $paddings,
+        ?array $dilations,
+        BufferInterface $images, int $offsetImages,
+        BufferInterface $kernel, int $offsetKernel,
+        BufferInterface $outputs, int $offsetOutputs ) : void
+    {
+        $ffi = $this->ffi;
+        $this->assert_shape_parameter("filters", $filters);
+        $geometry = $this->geometry($batches, $imageShape, $channels, $kernelShape, $strides, $paddings, $dilations);
+        $dtype = $images->dtype();
+        $this->assert_dtype($dtype);
+        $this->assert_buffer_size($images, $offsetImages, $geometry['imageSize'],
+            "Image specification too large for bufferImages.");
+        $this->assert_buffer_size($kernel, $offsetKernel, $geometry['patchSize']*$filters,
+            "Kernel specification too large for bufferKernel.");
+        $this->assert_buffer_size($outputs, $offsetOutputs, $geometry['rows']*$filters,
+            "Output specification too large for bufferOutputs.");
+        if($dtype!=$kernel->dtype() || $dtype!=$outputs->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for images and kernel and outputs");
+        }
+
+        $k = $geometry['patchSize'];
+        $tile = min($geometry['rows'], max(1, intdiv(static::SCRATCH_SIZE, $k)));
+        $scratch = $this->scratch($dtype, $tile*$k);
+        $gemm = ($dtype==NDArray::float32) ? 'cblas_sgemm' : 'cblas_dgemm';
+        $imagesPtr = $images->addr($offsetImages);
+        $kernelPtr = $kernel->addr($offsetKernel);
+        for($row=0; $row<$geometry['rows']; $row+=$tile) {
+            $rows = min($tile, $geometry['rows']-$row);
+            $this->copyPatches($geometry, $dtype, $imagesPtr, $row, $rows, $scratch, false);
+            $ffi->{$gemm}(
+                BLASIF::RowMajor, BLASIF::NoTrans, BLASIF::NoTrans,
+                $rows, $filters, $k,
+                1.0,
+                $scratch, $k,
+                $kernelPtr, $filters,
+                0.0,
+                $outputs->addr($offsetOutputs+$row*$filters), $filters);
+        }
+    }
+
+    /**
+     * Shapes extended to three dimensions with leading ones.
+     *
+     * @param array<int> $imageShape
+     * @param array<int> $kernelShape
+     * @param array<int>|null $strides
+     * @param array<int>|null $paddings
+     * @param array<int>|null $dilations
+     * @return array<string,mixed>
+     */
+    protected function geometry(
+        int $batches,
+        array $imageShape,
+        int $channels,
+        array $kernelShape,
+        ?array $strides,
+        ?array $paddings,
+        ?array $dilations) : array
+    {
+        $this->assert_shape_parameter("batches", $batches);
+        $this->assert_shape_parameter("channels", $channels);
+        $ndim = count($imageShape);
+        if($ndim<1 || $ndim>3) {
+            throw new InvalidArgumentException("Images must be 1D, 2D or 3D.");
+        }
+        $strides ??= array_fill(0, $ndim, 1);
+        $paddings ??= array_fill(0, $ndim, 0);
+        $dilations ??= array_fill(0, $ndim, 1);
+        foreach(['kernelShape'=>$kernelShape,'strides'=>$strides,'paddings'=>$paddings,'dilations'=>$dilations] as $name => $values) {
+            if(count($values)!=$ndim) {
+                throw new InvalidArgumentException("The number of dimensions of {$name} must be {$ndim}.");
+            }
+        }
+        $fill = 3-$ndim;
+        $geometry = [
+            'batches' => $batches,
+            'channels' => $channels,
+            'in' => array_merge(array_fill(0, $fill, 1), array_values($imageShape)),
+            'k' => array_merge(array_fill(0, $fill, 1), array_values($kernelShape)),
+            's' => array_merge(array_fill(0, $fill, 1), array_values($strides)),
+            'p' => array_merge(array_fill(0, $fill, 0), array_values($paddings)),
+            'd' => array_merge(array_fill(0, $fill, 1), array_values($dilations)),
+            'out' => [],
+        ];
+        for($i=0; $i<3; $i++) {
+            $this->assert_shape_parameter("imageShape", $geometry['in'][$i]);
+            $this->assert_shape_parameter("kernelShape", $geometry['k'][$i]);
+            $this->assert_shape_parameter("strides", $geometry['s'][$i]);
+            $this->assert_shape_parameter("dilations", $geometry['d'][$i]);
+            if($geometry['p'][$i]<0) {
+                throw new InvalidArgumentException("Argument paddings must be greater than equals 0.");
+            }
+            $span = $geometry['in'][$i] + 2*$geometry['p'][$i] - $geometry['d'][$i]*($geometry['k'][$i]-1) - 1;
+            if($span<0) {
+                throw new InvalidArgumentException("The kernel is larger than the padded image.");
+            }
+            $geometry['out'][$i] = intdiv($span, $geometry['s'][$i]) + 1;
+        }
+        $geometry['rows'] = $batches*(int)array_product($geometry['out']);
+        $geometry['patchSize'] = (int)array_product($geometry['k'])*$channels;
+        $geometry['imageSize'] = $batches*(int)array_product($geometry['in'])*$channels;
+        return $geometry;
+    }
+
+    /**
+     * @param array<string,mixed> $geometry
+     */
+    protected function assert_buffers(
+        array $geometry,
+        BufferInterface $images, int $offsetImages,
+        BufferInterface $cols, int $offsetCols ) : int
+    {
+        $this->assert_buffer_size($images, $offsetImages, $geometry['imageSize'],
+            "Image specification too large for bufferImages.");
+        $this->assert_buffer_size($cols, $offsetCols, $geometry['rows']*$geometry['patchSize'],
+            "Cols specification too large for bufferCols.");
+        $dtype = $images->dtype();
+        if($dtype!=$cols->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for images and cols");
+        }
+        $this->assert_dtype($dtype);
+        return $dtype;
+    }
+
+    protected function assert_dtype(int $dtype) : void
+    {
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+    }
+
+    protected function elementSize(int $dtype) : int
+    {
+        return ($dtype==NDArray::float32) ? 4 : 8;
+    }
+
+    /**
+     * Pointer to a scratch buffer of at least size elements, kept between calls.
+     */
+    protected function scratch(int $dtype, int $size) : FFI\CData
+    {
+        if(!isset($this->scratch[$dtype]) || FFI::typeof($this->scratch[$dtype])->getArrayLength()<$size) {
+            $type = ($dtype==NDArray::float32) ? 'float' : 'double';
+            $this->scratch[$dtype] = $this->ffi->new("{$type}[{$size}]");
+        }
+        return FFI::addr($this->scratch[$dtype][0]);
+    }
+
+    /**
+     * Copy the patches of the output rows [rowStart, rowStart+rows) between
+     * the images and cols, where cols points at the patch of rowStart.
+     * With reverse, the patches are added to the images.
+     *
+     * @param array<string,mixed> $geometry
+     */
+    protected function copyPatches(
+        array $geometry, int $dtype,
+        FFI\CData $images,
+        int $rowStart, int $rows,
+        FFI\CData $cols,
+        bool $reverse) : void
+    {
+        $ffi = $this->ffi;
+        $axpy = ($dtype==NDArray::float32) ? 'cblas_saxpy' : 'cblas_daxpy';
+        $size = $this->elementSize($dtype);
+        $c = $geometry['channels'];
+        [$inD, $inH, $inW] = $geometry['in'];
+        [$kD, $kH, $kW] = $geometry['k'];
+        [$sD, $sH, $sW] = $geometry['s'];
+        [$pD, $pH, $pW] = $geometry['p'];
+        [$dD, $dH, $dW] = $geometry['d'];
+        [$outD, $outH, $outW] = $geometry['out'];
+        $patchSize = $geometry['patchSize'];
+        $runSize = $kW*$c;
+
+        for($r=0; $r<$rows; $r++) {
+            $row = $rowStart+$r;
+            $ow = $row % $outW;
+            $oh = intdiv($row, $outW) % $outH;
+            $od = intdiv($row, $outW*$outH) % $outD;
+            $b = intdiv($row, $outW*$outH*$outD);
+            $iw0 = $ow*$sW - $pW;
+            // kernel columns inside the image: [kMin, kMax)
+            $kMin = ($iw0<0) ? intdiv(-$iw0+$dW-1, $dW) : 0;
+            $kMax = ($iw0>$inW-1) ? 0 : min($kW, intdiv($inW-1-$iw0, $dW)+1);
+            $kMin = min($kMin, $kMax);
+            for($kd=0; $kd<$kD; $kd++) {
+                $id = $od*$sD - $pD + $kd*$dD;
+                for($kh=0; $kh<$kH; $kh++) {
+                    $ih = $oh*$sH - $pH + $kh*$dH;
+                    $col = $cols + ($r*$patchSize + ($kd*$kH+$kh)*$runSize);
+                    if($id<0 || $id>=$inD || $ih<0 || $ih>=$inH || $kMin==$kMax) {
+                        if(!$reverse) {
+                            FFI::memset($col, 0, $runSize*$size);
+                        }
+                        continue;
+                    }
+                    $base = (($b*$inD + $id)*$inH + $ih)*$inW;
+                    if(!$reverse) {
+                        if($kMin>0) {
+                            FFI::memset($col, 0, $kMin*$c*$size);
+                        }
+                        if($kMax<$kW) {
+                            $tail = $col + $kMax*$c;
+                            FFI::memset($tail, 0, ($kW-$kMax)*$c*$size);
+                        }
+                    }
+                    // One run when the kernel columns are adjacent in the image
+                    $step = ($dW==1) ? $kMax-$kMin : 1;
+                    for($kw=$kMin; $kw<$kMax; $kw+=$step) {
+                        $image = $images + ($base + $iw0 + $kw*$dW)*$c;
+                        $patch = $col + $kw*$c;
+                        if($reverse) {
+                            $ffi->{$axpy}($step*$c, 1.0, $patch, 1, $image, 1);
+                        } else {
+                            FFI::memcpy($patch, $image, $step*$c*$size);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,663 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use InvalidArgumentException;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+
+/**
+ * Blas that records scal, axpy, axpby, copy, gemv and gemm and runs them on flush().
+ *
+ * The recorded calls are rewritten into fewer library calls:
+ *   - scal on the output of the next or the previous operation is folded into its alpha and beta,
+ *     e.g. scal + axpy becomes axpby and gemm + scal becomes a single gemm.
+ *   - copy into a vector or matrix that is then overwritten by gemv or gemm with beta=0 is dropped.
+ *   - consecutive RowMajor gemv on the same matrix with evenly spaced X and Y become one gemm.
+ * Only real scalars are folded. Calls whose buffers may alias are left as they are.
+ *
+ * Arguments are checked when the call is recorded. Every other Blas method
+ * flushes first, but buffers read or written outside Blas need an explicit flush(),
+ * and so does the end of the recording: the destructor drops what is left.
+ */
+class DeferredBlas extends Blas
+{
+    /** @var array<int,array{string,array<string,mixed>}> $operations */
+    protected array $operations = [];
+    // Set while Blas code runs, so that its internal calls are not recorded
+    protected bool $direct = false;
+
+    /**
+     * Recorded operations are not run here: an exception thrown by a
+     * destructor during unwinding or shutdown is fatal. They are logged and
+     * dropped, so call flush() before the last reference goes away.
+     */
+    public function __destruct()
+    {
+        $count = $this->discard();
+        if($count>0) {
+            error_log("Warning: DeferredBlas destroyed without flush(). ".$count." recorded operations were dropped.");
+        }
+    }
+
+    /**
+     * Number of recorded operations.
+     */
+    public function pending() : int
+    {
+        return count($this->operations);
+    }
+
+    /**
+     * Drop the recorded operations without running them. Returns how many were dropped.
+     */
+    public function discard() : int
+    {
+        $count = count($this->operations);
+        $this->operations = [];
+        return $count;
+    }
+
+    /**
+     * Fuse and run the recorded operations. Returns the number of library calls issued.
+     */
+    public function flush() : int
+    {
+        $operations = $this->fuse($this->operations);
+        $this->operations = [];
+        $this->direct = true;
+        try {
+            foreach($operations as [$name, $args]) {
+                parent::$name(...$args);
+            }
+        } finally {
+            $this->direct = false;
+        }
+        return count($operations);
+    }
+
+    public function scal(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_vector_buffer_spec("X", $X, $n, $offsetX, $incX);
+        $this->record('scal', compact('n','alpha','X','offsetX','incX'));
+    }
+
+    public function axpy(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $this->assert_vector_pair_spec($n, $X, $offsetX, $incX, $Y, $offsetY, $incY);
+        $this->record('axpy', compact('n','alpha','X','offsetX','incX','Y','offsetY','incY'));
+    }
+
+    public function axpby(
+        int $n,
+        float|object $alpha,
+        BufferInterface $X, int $offsetX, int $incX,
+        float|object $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $this->assert_vector_pair_spec($n, $X, $offsetX, $incX, $Y, $offsetY, $incY);
+        $this->record('axpby', compact('n','alpha','X','offsetX','incX','beta','Y','offsetY','incY'));
+    }
+
+    public function copy(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $this->assert_vector_pair_spec($n, $X, $offsetX, $incX, $Y, $offsetY, $incY);
+        $this->record('copy', compact('n','X','offsetX','incX','Y','offsetY','incY'));
+    }
+
+    public function gemv(
+        int $order,
+        int $trans,
+        int $m,
+        int $n,
+        float|object $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $X, int $offsetX, int $incX,
+        float|object $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $this->assert_gemv_spec(
+            $trans,
+            $m, $n,
+            $A, $offsetA, $ldA,
+            $X, $offsetX, $incX,
+            $Y, $offsetY, $incY,
+        );
+        $this->record('gemv', compact(
+            'order','trans','m','n','alpha','A','offsetA','ldA',
+            'X','offsetX','incX','beta','Y','offsetY','incY'));
+    }
+
+    public function gemm(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float|object $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float|object $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        $this->assert_gemm_spec(
+            $transA, $transB,
+            $m, $n, $k,
+            $A, $offsetA, $ldA,
+            $B, $offsetB, $ldB,
+            $C, $offsetC, $ldC,
+        );
+        $this->record('gemm', compact(
+            'order','transA','transB','m','n','k','alpha','A','offsetA','ldA',
+            'B','offsetB','ldB','beta','C','offsetC','ldC'));
+    }
+
+    public function dot(mixed ...$args) : float
+    {
+        return $this->passThrough('dot', $args);
+    }
+
+    public function dotu(mixed ...$args) : object
+    {
+        return $this->passThrough('dotu', $args);
+    }
+
+    public function dotuSub(mixed ...$args) : void
+    {
+        $this->passThrough('dotuSub', $args);
+    }
+
+    public function dotc(mixed ...$args) : object
+    {
+        return $this->passThrough('dotc', $args);
+    }
+
+    public function dotcSub(mixed ...$args) : void
+    {
+        $this->passThrough('dotcSub', $args);
+    }
+
+    public function asum(mixed ...$args) : float
+    {
+        return $this->passThrough('asum', $args);
+    }
+
+    public function iamax(mixed ...$args) : int
+    {
+        return $this->passThrough('iamax', $args);
+    }
+
+    public function iamin(mixed ...$args) : int
+    {
+        return $this->passThrough('iamin', $args);
+    }
+
+    public function nrm2(mixed ...$args) : float
+    {
+        return $this->passThrough('nrm2', $args);
+    }
+
+    public function rotg(mixed ...$args) : void
+    {
+        $this->passThrough('rotg', $args);
+    }
+
+    public function rot(mixed ...$args) : void
+    {
+        $this->passThrough('rot', $args);
+    }
+
+    public function rotm(mixed ...$args) : void
+    {
+        $this->passThrough('rotm', $args);
+    }
+
+    public function rotmg(mixed ...$args) : void
+    {
+        $this->passThrough('rotmg', $args);
+    }
+
+    public function swap(mixed ...$args) : void
+    {
+        $this->passThrough('swap', $args);
+    }
+
+    public function dotStridedBatch(mixed ...$args) : void
+    {
+        $this->passThrough('dotStridedBatch', $args);
+    }
+
+    public function nrm2StridedBatch(mixed ...$args) : void
+    {
+        $this->passThrough('nrm2StridedBatch', $args);
+    }
+
+    public function axpyStridedBatch(mixed ...$args) : void
+    {
+        $this->passThrough('axpyStridedBatch', $args);
+    }
+
+    public function scalStridedBatch(mixed ...$args) : void
+    {
+        $this->passThrough('scalStridedBatch', $args);
+    }
+
+    public function trsv(mixed ...$args) : void
+    {
+        $this->passThrough('trsv', $args);
+    }
+
+    public function gemmBatch(mixed ...$args) : void
+    {
+        $this->passThrough('gemmBatch', $args);
+    }
+
+    public function gemmStridedBatch(mixed ...$args) : void
+    {
+        $this->passThrough('gemmStridedBatch', $args);
+    }
+
+    public function symm(mixed ...$args) : void
+    {
+        $this->passThrough('symm', $args);
+    }
+
+    public function syrk(mixed ...$args) : void
+    {
+        $this->passThrough('syrk', $args);
+    }
+
+    public function syr2k(mixed ...$args) : void
+    {
+        $this->passThrough('syr2k', $args);
+    }
+
+    public function trmm(mixed ...$args) : void
+    {
+        $this->passThrough('trmm', $args);
+    }
+
+    public function trsm(mixed ...$args) : void
+    {
+        $this->passThrough('trsm', $args);
+    }
+
+    public function omatcopy(mixed ...$args) : void
+    {
+        $this->passThrough('omatcopy', $args);
+    }
+
+    public function copyStrided(mixed ...$args) : void
+    {
+        $this->passThrough('copyStrided', $args);
+    }
+
+    public function permute(mixed ...$args) : void
+    {
+        $this->passThrough('permute', $args);
+    }
+
+    public function gemmInt8(mixed ...$args) : void
+    {
+        $this->passThrough('gemmInt8', $args);
+    }
+
+    public function quantize(mixed ...$args) : void
+    {
+        $this->passThrough('quantize', $args);
+    }
+
+    public function dequantize(mixed ...$args) : void
+    {
+        $this->passThrough('dequantize', $args);
+    }
+
+    /**
+     * @param array<string,mixed> $args
+     */
+    protected function record(string $name, array $args) : void
+    {
+        if($this->direct) {
+            parent::$name(...$args);
+            return;
+        }
+        $this->operations[] = [$name, $args];
+    }
+
+    /**
+     * Flush, then run a method that is not recorded.
+     *
+     * @param array<mixed> $args
+     */
+    protected function passThrough(string $name, array $args) : mixed
+    {
+        $this->flush();
+        $this->direct = true;
+        try {
+            return parent::$name(...$args);
+        } finally {
+            $this->direct = false;
+        }
+    }
+
+    protected function assert_vector_pair_spec(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        // Check Buffer X
+        $this->assert_vector_buffer_spec("X", $X, $n, $offsetX, $incX);
+        // Check Buffer Y
+        $this->assert_vector_buffer_spec("Y", $Y, $n, $offsetY, $incY);
+
+        // Check Buffer X and Y
+        if($X->dtype()!=$Y->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y");
+        }
+    }
+
+    /**
+     * @param array<int,array{string,array<string,mixed>}> $operations
+     * @return array<int,array{string,array<string,mixed>}>
+     */
+    protected function fuse(array $operations) : array
+    {
+        $fused = [];
+        foreach($operations as $operation) {
+            $fused[] = $operation;
+            while(count($fused)>=2) {
+                $merged = $this->fusePair($fused[count($fused)-2], $fused[count($fused)-1]);
+                if($merged===null) {
+                    break;
+                }
+                array_splice($fused, -2, 2, [$merged]);
+            }
+        }
+        return $this->batchGemv($fused);
+    }
+
+    /**
+     * The single operation that does the same as first followed by second, or null.
+     *
+     * @param array{string,array<string,mixed>} $first
+     * @param array{string,array<string,mixed>} $second
+     * @return array{string,array<string,mixed>}|null
+     */
+    protected function fusePair(array $first, array $second) : ?array
+    {
+        [$name, $args] = $second;
+        $output = $this->outputOf($second);
+        if($output===null) {
+            return null;
+        }
+        // scal before an operation that overwrites or accumulates into the scaled vector
+        if($first[0]=='scal' && $this->isRealScalar($first[1]['alpha']) &&
+            $this->sameRegion($this->outputOf($first), $output) &&
+            !$this->readsBuffer($second, $output[0])) {
+            $alpha = $first[1]['alpha'];
+            switch($name) {
+                case 'scal': {
+                    if(!$this->isRealScalar($args['alpha'])) {
+                        return null;
+                    }
+                    $args['alpha'] *= $alpha;
+                    return [$name, $args];
+                }
+                case 'axpy': {
+                    return ['axpby', $this->axpbyArgs($args, $args['alpha'], $alpha)];
+                }
+                case 'copy': {
+                    return $second;
+                }
+                case 'axpby':
+                case 'gemv':
+                case 'gemm': {
+                    if(!$this->isRealScalar($args['beta'])) {
+                        return null;
+                    }
+                    $args['beta'] *= $alpha;
+                    return [$name, $args];
+                }
+            }
+            return null;
+        }
+        // copy that is overwritten by the next operation
+        if($first[0]=='copy' &&
+            $this->sameRegion($this->outputOf($first), $output) &&
+            !$this->readsBuffer($second, $output[0])) {
+            if($name=='copy') {
+                return $second;
+            }
+            if(($name=='gemv' || $name=='gemm') &&
+                $this->isRealScalar($args['beta']) && $args['beta']==0.0) {
+                return $second;
+            }
+            return null;
+        }
+        // scal of the result of the previous operation
+        if($name=='scal' && $this->isRealScalar($args['alpha']) &&
+            $this->sameRegion($this->outputOf($first), $output)) {
+            $scale = $args['alpha'];
+            [$name, $args] = $first;
+            switch($name) {
+                case 'scal': {
+                    if(!$this->isRealScalar($args['alpha'])) {
+                        return null;
+                    }
+                    $args['alpha'] *= $scale;
+                    return [$name, $args];
+                }
+                case 'axpy': {
+                    if(!$this->isRealScalar($args['alpha'])) {
+                        return null;
+                    }
+                    return ['axpby', $this->axpbyArgs($args, $args['alpha']*$scale, $scale)];
+                }
+                case 'axpby':
+                case 'gemv':
+                case 'gemm': {
+                    if(!$this->isRealScalar($args['alpha']) || !$this->isRealScalar($args['beta'])) {
+                        return null;
+                    }
+                    $args['alpha'] *= $scale;
+                    $args['beta'] *= $scale;
+                    return [$name, $args];
+                }
+            }
+            return null;
+        }
+        return null;
+    }
+
+    /**
+     * The vector written by the operation as [buffer, offset, inc, n].
+     * A gemm result is a vector only when its rows are contiguous.
+     *
+     * @param array{string,array<string,mixed>} $operation
+     * @return array{BufferInterface,int,int,int}|null
+     */
+    protected function outputOf(array $operation) : ?array
+    {
+        [$name, $args] = $operation;
+        switch($name) {
+            case 'scal': {
+                return [$args['X'], $args['offsetX'], $args['incX'], $args['n']];
+            }
+            case 'axpy':
+            case 'axpby':
+            case 'copy': {
+                return [$args['Y'], $args['offsetY'], $args['incY'], $args['n']];
+            }
+            case 'gemv': {
+                $trans = $args['trans'];
+                $rows = ($trans==BLASIF::NoTrans || $trans==BLASIF::ConjNoTrans) ? $args['m'] : $args['n'];
+                return [$args['Y'], $args['offsetY'], $args['incY'], $rows];
+            }
+            case 'gemm': {
+                $cols = ($args['order']==BLASIF::RowMajor) ? $args['n'] : $args['m'];
+                if($args['ldC']!=$cols) {
+                    return null;
+                }
+                return [$args['C'], $args['offsetC'], 1, $args['m']*$args['n']];
+            }
+        }
+        return null;
+    }
+
+    /**
+     * Whether the operation reads the buffer other than through its output.
+     *
+     * @param array{string,array<string,mixed>} $operation
+     */
+    protected function readsBuffer(array $operation, BufferInterface $buffer) : bool
+    {
+        [$name, $args] = $operation;
+        if($name=='scal') {
+            return false;
+        }
+        foreach(['A','B','X'] as $input) {
+            if(isset($args[$input]) && $args[$input]===$buffer) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Arguments of axpby for the arguments of axpy.
+     *
+     * @param array<string,mixed> $args
+     * @return array<string,mixed>
+     */
+    protected function axpbyArgs(array $args, float|object $alpha, float|object $beta) : array
+    {
+        return [
+            'n' => $args['n'],
+            'alpha' => $alpha,
+            'X' => $args['X'], 'offsetX' => $args['offsetX'], 'incX' => $args['incX'],
+            'beta' => $beta,
+            'Y' => $args['Y'], 'offsetY' => $args['offsetY'], 'incY' => $args['incY'],
+        ];
+    }
+
+    /**
+     * @param array{BufferInterface,int,int,int}|null $a
+     * @param array{BufferInterface,int,int,int}|null $b
+     */
+    protected function sameRegion(?array $a, ?array $b) : bool
+    {
+        if($a===null || $b===null) {
+            return false;
+        }
+        return $a[0]===$b[0] && $a[1]==$b[1] && $a[2]==$b[2] && $a[3]==$b[3];
+    }
+
+    protected function isRealScalar(mixed $value) : bool
+    {
+        return is_float($value) || is_int($value);
+    }
+
+    /**
+     * Fold runs of gemv on the same matrix into gemm.
+     *
+     * Y_i := alpha*op(A)*X_i + beta*Y_i for i=0..k-1 is
+     * Y := alpha*X*op(A)^T + beta*Y, where the rows of X and Y are X_i and Y_i.
+     *
+     * @param array<int,array{string,array<string,mixed>}> $operations
+     * @return array<int,array{string,array<string,mixed>}>
+     */
+    protected function batchGemv(array $operations) : array
+    {
+        $result = [];
+        $count = count($operations);
+        for($i=0; $i<$count; $i+=$length) {
+            $length = $this->gemvRunLength($operations, $i);
+            if($length<2) {
+                $result[] = $operations[$i];
+                continue;
+            }
+            $args = $operations[$i][1];
+            $trans = $args['trans'];
+            $rows = ($trans==BLASIF::NoTrans) ? $args['m'] : $args['n'];
+            $cols = ($trans==BLASIF::NoTrans) ? $args['n'] : $args['m'];
+            $result[] = ['gemm', [
+                'order' => BLASIF::RowMajor,
+                'transA' => BLASIF::NoTrans,
+                'transB' => ($trans==BLASIF::NoTrans) ? BLASIF::Trans : BLASIF::NoTrans,
+                'm' => $length,
+                'n' => $rows,
+                'k' => $cols,
+                'alpha' => $args['alpha'],
+                'A' => $args['X'],
+                'offsetA' => $args['offsetX'],
+                'ldA' => $operations[$i+1][1]['offsetX'] - $args['offsetX'],
+                'B' => $args['A'],
+                'offsetB' => $args['offsetA'],
+                'ldB' => $args['ldA'],
+                'beta' => $args['beta'],
+                'C' => $args['Y'],
+                'offsetC' => $args['offsetY'],
+                'ldC' => $operations[$i+1][1]['offsetY'] - $args['offsetY'],
+            ]];
+        }
+        return $result;
+    }
+
+    /**
+     * Number of operations from start that can be folded into one gemm.
+     *
+     * @param array<int,array{string,array<string,mixed>}> $operations
+     */
+    protected function gemvRunLength(array $operations, int $start) : int
+    {
+        [$name, $first] = $operations[$start];
+        if($name!='gemv' || $first['order']!=BLASIF::RowMajor ||
+            ($first['trans']!=BLASIF::NoTrans && $first['trans']!=BLASIF::Trans) ||
+            !$this->isRealScalar($first['alpha']) || !$this->isRealScalar($first['beta']) ||
+            $first['incX']!=1 || $first['incY']!=1 ||
+            $first['Y']===$first['X'] || $first['Y']===$first['A']) {
+            return 1;
+        }
+        $rows = ($first['trans']==BLASIF::NoTrans) ? $first['m'] : $first['n'];
+        $cols = ($first['trans']==BLASIF::NoTrans) ? $first['n'] : $first['m'];
+        $strideX = $strideY = 0;
+        $length = 1;
+        for($i=$start+1; $i<count($operations); $i++) {
+            [$name, $args] = $operations[$i];
+            if($name!='gemv') {
+                break;
+            }
+            foreach(['order','trans','m','n','alpha','A','offsetA','ldA','X','incX','beta','Y','incY'] as $key) {
+                if($args[$key]!==$first[$key]) {
+                    break 2;
+                }
+            }
+            if($length==1) {
+                $strideX = $args['offsetX'] - $first['offsetX'];
+                $strideY = $args['offsetY'] - $first['offsetY'];
+                if($strideX<$cols || $strideY<$rows) {
+                    break;
+                }
+            }
+            if($args['offsetX']!=$first['offsetX']+$length*$strideX ||
+                $args['offsetY']!=$first['offsetY']+$length*$strideY) {
+                break;
+            }
+            $length++;
+        }
+        return $length;
+    }
+}
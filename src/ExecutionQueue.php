@@ -0,0 +1,335 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+use InvalidArgumentException;
+use RuntimeException;
+use LogicException;
+use Throwable;
+use Closure;
+use FFI;
+
+/**
+ * Runs BLAS and LAPACK operations in a worker process while PHP goes on.
+ *
+ * A worker is forked when operations are waiting and none is running. It
+ * runs every operation submitted up to then in submission order and sends
+ * each result or exception back over a socket, and operations submitted
+ * later go to the next worker. The buffers must be NativeBuffers that the
+ * worker shares with this process: shared AnonymousBuffers, SHARED
+ * MappedBuffers, or read-only buffers, which are only inputs. They must be
+ * kept alive and not be written until the future of the operation is done.
+ *
+ * This needs the pcntl extension. With the OpenMP build of OpenBLAS the
+ * worker may hang after the fork; use the serial or pthread build.
+ */
+class ExecutionQueue
+{
+    // bytes read from the worker at a time
+    protected const READ_SIZE = 65536;
+
+    protected static ?FFI $libc = null;
+
+    protected Blas $blas;
+    protected ?Lapack $lapack = null;
+    protected ?Closure $lapackResolver = null;
+    /** @var array<int,array{callable,array<mixed>,Future}> $waiting operations not sent to a worker */
+    protected array $waiting = [];
+    /** @var array<int,Future> $running operations of the worker without a result yet */
+    protected array $running = [];
+    protected ?int $pid = null;
+    /** @var resource|null $stream */
+    protected $stream = null;
+    protected string $received = '';
+
+    /**
+     * lapack may be a closure that returns the Lapack. It is called on the
+     * first lapack() submission, and a RuntimeException from it means that
+     * lapack is not available.
+     */
+    public function __construct(Blas $blas, Lapack|Closure|null $lapack=null)
+    {
+        if(!function_exists('pcntl_fork')) {
+            throw new RuntimeException('ExecutionQueue needs the pcntl extension.');
+        }
+        static::libc();
+        $this->blas = $blas;
+        if($lapack instanceof Closure) {
+            $this->lapackResolver = $lapack;
+        } else {
+            $this->lapack = $lapack;
+        }
+    }
+
+    /**
+     * Run the operations that are still waiting and wait for the worker, so
+     * that it does not outlive the buffers. Operations that cannot run are
+     * reported with error_log.
+     */
+    public function __destruct()
+    {
+        if(count($this->waiting)>0) {
+            try {
+                $this->flush();
+            } catch(Throwable $e) {
+                error_log("Warning: ExecutionQueue destroyed with pending operations. ".
+                    count($this->waiting)." operations were dropped: ".$e->getMessage());
+                $this->waiting = [];
+            }
+        }
+        if($this->pid===null) {
+            return;
+        }
+        if($this->stream!==null) {
+            fclose($this->stream);
+            $this->stream = null;
+        }
+        pcntl_waitpid($this->pid, $status);
+        $this->pid = null;
+    }
+
+    /**
+     * Submit an arbitrary operation. It runs in the worker, so only its
+     * result and its writes to shared buffers are seen here.
+     *
+     * @param array<mixed> $args
+     */
+    public function submit(callable $operation, array $args=[]) : Future
+    {
+        $this->assert_shared_buffers($args);
+        $future = new Future($this);
+        $this->waiting[] = [$operation, $args, $future];
+        $this->progress(false);
+        return $future;
+    }
+
+    /**
+     * Submit a Blas method, e.g. blas('gemm', $order, $transA, ...).
+     */
+    public function blas(string $method, mixed ...$args) : Future
+    {
+        if(!method_exists($this->blas, $method)) {
+            throw new InvalidArgumentException("Unknown Blas method: {$method}");
+        }
+        return $this->submit([$this->blas, $method], $args);
+    }
+
+    /**
+     * Submit a Lapack method, e.g. lapack('gesvd', $matrix_layout, ...).
+     */
+    public function lapack(string $method, mixed ...$args) : Future
+    {
+        if($this->lapackResolver!==null) {
+            $resolver = $this->lapackResolver;
+            $this->lapackResolver = null;
+            try {
+                $this->lapack = $resolver();
+            } catch(RuntimeException $e) {
+                $this->lapack = null;
+            }
+        }
+        if($this->lapack===null) {
+            throw new RuntimeException('lapack is not available for this queue.');
+        }
+        if(!method_exists($this->lapack, $method)) {
+            throw new InvalidArgumentException("Unknown Lapack method: {$method}");
+        }
+        return $this->submit([$this->lapack, $method], $args);
+    }
+
+    /**
+     * Number of operations not done yet.
+     */
+    public function pending() : int
+    {
+        return count($this->waiting)+count($this->running);
+    }
+
+    /**
+     * Take the results the worker has sent and start the next worker when
+     * the running one has finished. With block, wait until at least one
+     * operation is done. Returns false when no operation is pending.
+     */
+    public function progress(bool $block) : bool
+    {
+        if($this->pid===null) {
+            if(count($this->waiting)==0) {
+                return false;
+            }
+            $this->start();
+        }
+        do {
+            $done = $this->receive($block);
+        } while($block && $done==0 && $this->pid!==null);
+        if($this->pid===null && count($this->waiting)>0) {
+            $this->start();
+        }
+        return true;
+    }
+
+    /**
+     * Wait for every pending operation.
+     */
+    public function flush() : void
+    {
+        while($this->progress(true)) {
+        }
+    }
+
+    /**
+     * @param array<mixed> $args
+     */
+    protected function assert_shared_buffers(array $args) : void
+    {
+        foreach($args as $arg) {
+            if(is_array($arg)) {
+                $this->assert_shared_buffers($arg);
+            } elseif($arg instanceof BufferInterface) {
+                if(!($arg instanceof NativeBuffer) || !($arg->isShared() || !$arg->isWritable())) {
+                    throw new InvalidArgumentException(
+                        'The buffers of a queued operation must be shared with the worker: '.
+                        'use a shared AnonymousBuffer, a SHARED MappedBuffer or a read-only buffer.');
+                }
+            }
+        }
+    }
+
+    /**
+     * Fork a worker for the waiting operations.
+     */
+    protected function start() : void
+    {
+        $pair = stream_socket_pair(STREAM_PF_UNIX, STREAM_SOCK_STREAM, STREAM_IPPROTO_IP);
+        if($pair===false) {
+            throw new RuntimeException('Cannot create a socket for the worker.');
+        }
+        $operations = $this->waiting;
+        $this->waiting = [];
+        $pid = pcntl_fork();
+        if($pid==-1) {
+            fclose($pair[0]);
+            fclose($pair[1]);
+            $this->waiting = $operations;
+            throw new RuntimeException('Cannot fork a worker.');
+        }
+        if($pid==0) {
+            fclose($pair[0]);
+            $this->work($pair[1], $operations);
+        }
+        fclose($pair[1]);
+        stream_set_blocking($pair[0], false);
+        $this->pid = $pid;
+        $this->stream = $pair[0];
+        $this->received = '';
+        foreach($operations as [, , $future]) {
+            $this->running[] = $future;
+        }
+    }
+
+    /**
+     * The worker: run the operations, send the results and exit without
+     * running the destructors and shutdown functions of the parent's objects.
+     *
+     * @param resource $stream
+     * @param array<int,array{callable,array<mixed>,Future}> $operations
+     */
+    protected function work($stream, array $operations) : never
+    {
+        try {
+            stream_set_blocking($stream, true);
+            foreach($operations as [$operation, $args]) {
+                try {
+                    $message = ['result', $this->portable($operation(...$args))];
+                    $data = serialize($message);
+                } catch(Throwable $e) {
+                    $data = serialize(['error', get_class($e), $e->getMessage(), $e->getCode()]);
+                }
+                fwrite($stream, pack('N', strlen($data)).$data);
+            }
+            fclose($stream);
+        } finally {
+            static::libc()->_exit(0);
+        }
+    }
+
+    /**
+     * Complex results come back as objects with real and imag.
+     */
+    protected function portable(mixed $result) : mixed
+    {
+        if($result instanceof FFI\CData) {
+            return (object)['real' => $result->real, 'imag' => $result->imag];
+        }
+        return $result;
+    }
+
+    /**
+     * Complete the futures of the results that have arrived.
+     * Returns the number of futures completed.
+     */
+    protected function receive(bool $block) : int
+    {
+        $read = [$this->stream];
+        $write = $except = null;
+        if(stream_select($read, $write, $except, $block ? null : 0)===0) {
+            return 0;
+        }
+        $data = fread($this->stream, self::READ_SIZE);
+        $completed = 0;
+        if($data!==false && $data!=='') {
+            $this->received .= $data;
+            while(strlen($this->received)>=4) {
+                $length = unpack('N', $this->received)[1];
+                if(strlen($this->received)<4+$length) {
+                    break;
+                }
+                $message = unserialize(substr($this->received, 4, $length));
+                $this->received = substr($this->received, 4+$length);
+                $future = array_shift($this->running);
+                if($future===null) {
+                    throw new LogicException('The worker sent more results than operations.');
+                }
+                if($message[0]=='result') {
+                    $future->complete($message[1]);
+                } else {
+                    $future->complete(null, $this->rebuild($message[1], $message[2], $message[3]));
+                }
+                $completed++;
+            }
+        }
+        if(feof($this->stream)) {
+            fclose($this->stream);
+            $this->stream = null;
+            pcntl_waitpid($this->pid, $status);
+            $this->pid = null;
+            foreach($this->running as $future) {
+                $future->complete(null, new RuntimeException(
+                    'The worker exited before the operation finished.'));
+                $completed++;
+            }
+            $this->running = [];
+        }
+        return $completed;
+    }
+
+    /**
+     * The exception thrown by the worker, as far as it can be rebuilt.
+     */
+    protected function rebuild(string $class, string $message, int $code) : Throwable
+    {
+        if(is_a($class, Throwable::class, true)) {
+            try {
+                return new $class($message, $code);
+            } catch(Throwable $e) {
+                // the constructor takes other arguments
+            }
+        }
+        return new RuntimeException("{$class}: {$message}", $code);
+    }
+
+    protected static function libc() : FFI
+    {
+        self::$libc ??= FFI::cdef('void _exit(int status);');
+        return self::$libc;
+    }
+}
@@ -0,0 +1,63 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Throwable;
+
+/**
+ * Handle of an operation submitted to an ExecutionQueue.
+ */
+class Future
+{
+    protected ExecutionQueue $queue;
+    protected bool $done = false;
+    protected mixed $result = null;
+    protected ?Throwable $error = null;
+
+    public function __construct(ExecutionQueue $queue)
+    {
+        $this->queue = $queue;
+    }
+
+    public function isDone() : bool
+    {
+        return $this->done;
+    }
+
+    /**
+     * Take the results that have arrived, without waiting, and report whether this one is done.
+     */
+    public function poll() : bool
+    {
+        if(!$this->done) {
+            $this->queue->progress(false);
+        }
+        return $this->done;
+    }
+
+    /**
+     * Wait for this operation and return its result.
+     * An exception raised by the operation is thrown here.
+     */
+    public function wait() : mixed
+    {
+        while(!$this->done) {
+            if(!$this->queue->progress(true)) {
+                break;
+            }
+        }
+        if($this->error!==null) {
+            throw $this->error;
+        }
+        return $this->result;
+    }
+
+    /**
+     * @internal called by ExecutionQueue
+     */
+    public function complete(mixed $result, ?Throwable $error=null) : void
+    {
+        $this->result = $result;
+        $this->error = $error;
+        $this->done = true;
+    }
+}
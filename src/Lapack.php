@@ -1,6 +1,7 @@
 <?php
 namespace Rindow\OpenBLAS\FFI;
 
+use Interop\Polite\Math\Matrix\NDArray;
 use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
 
 interface Lapack
@@ -17,7 +18,41 @@ interface Lapack
         BufferInterface $S,  int $offsetS,
         BufferInterface $U,  int $offsetU,  int $ldU,
         BufferInterface $VT, int $offsetVT, int $ldVT,
-        BufferInterface $SuperB,  int $offsetSuperB
+        BufferInterface $SuperB,  int $offsetSuperB,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void;
+
+    public function gesvdWorkspaceSize(
+        int $matrix_layout,
+        int $jobu,
+        int $jobvt,
+        int $m,
+        int $n,
+        int $dtype=NDArray::float32,
+    ) : int;
+
+    public function gesvdStridedBatch(
+        int $matrix_layout,
+        int $jobu,
+        int $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void;
+
+    public function syevStridedBatch(
+        int $matrix_layout,
+        int $jobz,
+        int $uplo,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $W,  int $offsetW,  int $strideW,
+        int $batchCount
     ) : void;
 
 }
\ No newline at end of file
@@ -0,0 +1,352 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use InvalidArgumentException;
+use FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+
+/**
+ * Strided batch and workspace drivers shared by Lapacke and Lapackb.
+ *
+ * The arguments are checked once for the whole batch, and the backend runs
+ * all matrices with a single workspace, either its own or one given by the
+ * caller and sized with gesvdWorkspaceSize().
+ */
+trait LapackBatch
+{
+    abstract protected function gesvdColMajorBatch(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void;
+
+    abstract protected function gesvdColMajorWorkspaceSize(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+    ) : int;
+
+    abstract protected function syevBatch(
+        int $dtype,
+        int $matrix_layout,
+        string $jobz,
+        string $uplo,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $W,  int $offsetW,  int $strideW,
+        int $batchCount
+    ) : void;
+
+    /**
+     * Check a strided batch of matrices stored in the given layout.
+     */
+    protected function assert_strided_matrix_buffer_spec(
+        string $name, BufferInterface $buffer, int $matrix_layout,
+        int $rows, int $cols, int $offset, int $ld, int $stride, int $batchCount) : void
+    {
+        if($stride<0) {
+            throw new InvalidArgumentException("Argument stride$name must be greater than equals 0.");
+        }
+        if($matrix_layout==self::LAPACK_COL_MAJOR) {
+            [$rows,$cols] = [$cols,$rows];
+        }
+        $this->assert_matrix_buffer_spec($name, $buffer, $rows, $cols, $offset, $ld);
+        $this->assert_matrix_buffer_spec($name, $buffer, $rows, $cols, $offset+($batchCount-1)*$stride, $ld);
+    }
+
+    /**
+     * Check the job of U or VT and return the number of its columns or rows.
+     */
+    protected function gesvd_job_size(string $name, string $job, int $m, int $n) : int
+    {
+        return match($job) {
+            'A' => $m, 'S' => min($m, $n), 'N' => 0,
+            default => throw new InvalidArgumentException("$name must be 'A', 'S' or 'N'"),
+        };
+    }
+
+    protected function assert_work_buffer_spec(
+        int $dtype, ?BufferInterface $work, int $offsetWork, int $lwork) : void
+    {
+        if($work===null) {
+            return;
+        }
+        if($lwork<1) {
+            throw new InvalidArgumentException("Argument lwork must be greater than 0.");
+        }
+        $this->assert_buffer_size($work, $offsetWork, $lwork, "BufferWork size is too small");
+        if($work->dtype()!=$dtype) {
+            throw new InvalidArgumentException("Unmatch data type", 0);
+        }
+    }
+
+    /**
+     * Size in elements of the optimal work buffer of gesvd and gesvdStridedBatch
+     * for matrices of this shape, layout and dtype.
+     */
+    public function gesvdWorkspaceSize(
+        int $matrix_layout,
+        int $jobu,
+        int $jobvt,
+        int $m,
+        int $n,
+        int $dtype=NDArray::float32,
+    ) : int
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $jobu = chr($jobu);
+        $jobvt = chr($jobvt);
+        $this->gesvd_job_size("jobu", $jobu, $m, $n);
+        $this->gesvd_job_size("jobvt", $jobvt, $n, $m);
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException("Unsupported data type", 0);
+        }
+        switch($matrix_layout) {
+            case self::LAPACK_COL_MAJOR: {
+                return $this->gesvdColMajorWorkspaceSize($dtype, $jobu, $jobvt, $m, $n);
+            }
+            case self::LAPACK_ROW_MAJOR: {
+                // the same problem as gesvdColumns() runs
+                return $this->gesvdColMajorWorkspaceSize($dtype, $jobvt, $jobu, $n, $m);
+            }
+            default: {
+                throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+            }
+        }
+    }
+
+    /**
+     * Run checked gesvd arguments in ColMajor.
+     */
+    protected function gesvdColumns(
+        int $matrix_layout,
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work, int $offsetWork, int $lwork,
+    ) : void
+    {
+        if($matrix_layout==self::LAPACK_COL_MAJOR) {
+            $this->gesvdColMajorBatch(
+                $dtype, $jobu, $jobvt, $m, $n,
+                $A,  $offsetA,  $ldA,  $strideA,
+                $S,  $offsetS,  $strideS,
+                $U,  $offsetU,  $ldU,  $strideU,
+                $VT, $offsetVT, $ldVT, $strideVT,
+                $batchCount,
+                $work, $offsetWork, $lwork,
+            );
+            return;
+        }
+        // A RowMajor matrix is the ColMajor storage of its transpose.
+        // A^T = U' S V'^T gives U = V' and VT = U'^T, and the RowMajor storage
+        // of U and VT is exactly the ColMajor storage of V'^T and U'.
+        // So the batch runs without any transposition.
+        $this->gesvdColMajorBatch(
+            $dtype, $jobvt, $jobu, $n, $m,
+            $A,  $offsetA,  $ldA,  $strideA,
+            $S,  $offsetS,  $strideS,
+            $VT, $offsetVT, $ldVT, $strideVT,
+            $U,  $offsetU,  $ldU,  $strideU,
+            $batchCount,
+            $work, $offsetWork, $lwork,
+        );
+    }
+
+    /**
+     * gesvd on the work buffer of the caller, for checked arguments.
+     * The superdiagonal left in work is copied to SuperB.
+     */
+    protected function gesvdWithWork(
+        int $matrix_layout,
+        int $jobu,
+        int $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,
+        BufferInterface $S,  int $offsetS,
+        BufferInterface $U,  int $offsetU,  int $ldU,
+        BufferInterface $VT, int $offsetVT, int $ldVT,
+        BufferInterface $SuperB,  int $offsetSuperB,
+        BufferInterface $work, int $offsetWork, int $lwork,
+    ) : void
+    {
+        if($matrix_layout!=self::LAPACK_ROW_MAJOR && $matrix_layout!=self::LAPACK_COL_MAJOR) {
+            throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+        }
+        $dtype = $A->dtype();
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException("Unsupported data type", 0);
+        }
+        $jobu = chr($jobu);
+        $jobvt = chr($jobvt);
+        $this->gesvd_job_size("jobu", $jobu, $m, $n);
+        $this->gesvd_job_size("jobvt", $jobvt, $n, $m);
+        $this->assert_work_buffer_spec($dtype, $work, $offsetWork, $lwork);
+        $this->gesvdColumns(
+            $matrix_layout, $dtype, $jobu, $jobvt, $m, $n,
+            $A,  $offsetA,  $ldA,  0,
+            $S,  $offsetS,  0,
+            $U,  $offsetU,  $ldU,  0,
+            $VT, $offsetVT, $ldVT, 0,
+            1,
+            $work, $offsetWork, $lwork,
+        );
+        $superbSize = min($m, $n)-1;
+        if($superbSize>0 && $lwork>$superbSize) {
+            $to = $SuperB->addr($offsetSuperB);
+            $from = $work->addr($offsetWork+1);
+            FFI::memcpy($to, $from, $superbSize*$work->value_size());
+        }
+    }
+
+    /**
+     * Singular value decomposition of every matrix in a strided batch.
+     *
+     * A[i] starts at offsetA + i*strideA (S, U and VT likewise).
+     * jobu and jobvt accept ord('A'), ord('S') and ord('N').
+     * The contents of A are destroyed.
+     * With work, lwork elements of it are used as the workspace of every matrix;
+     * see gesvdWorkspaceSize().
+     */
+    public function gesvdStridedBatch(
+        int $matrix_layout,
+        int $jobu,
+        int $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        if($matrix_layout!=self::LAPACK_ROW_MAJOR && $matrix_layout!=self::LAPACK_COL_MAJOR) {
+            throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+        }
+        $k = min($m, $n);
+        $jobu = chr($jobu);
+        $jobvt = chr($jobvt);
+        $colsU = $this->gesvd_job_size("jobu", $jobu, $m, $n);
+        $rowsVT = $this->gesvd_job_size("jobvt", $jobvt, $n, $m);
+
+        // Check Buffer A
+        $this->assert_strided_matrix_buffer_spec("A", $A, $matrix_layout, $m, $n, $offsetA, $ldA, $strideA, $batchCount);
+        // Check Buffer S
+        if($strideS<0) {
+            throw new InvalidArgumentException("Argument strideS must be greater than equals 0.");
+        }
+        $this->assert_buffer_size($S, $offsetS+($batchCount-1)*$strideS, $k, "BufferS size is too small");
+        // Check Buffer U
+        if($colsU>0) {
+            $this->assert_strided_matrix_buffer_spec("U", $U, $matrix_layout, $m, $colsU, $offsetU, $ldU, $strideU, $batchCount);
+        }
+        // Check Buffer VT
+        if($rowsVT>0) {
+            $this->assert_strided_matrix_buffer_spec("VT", $VT, $matrix_layout, $rowsVT, $n, $offsetVT, $ldVT, $strideVT, $batchCount);
+        }
+
+        $dtype = $A->dtype();
+        if($dtype!=$S->dtype() ||
+            $dtype!=$U->dtype() ||
+            $dtype!=$VT->dtype()
+        ) {
+            throw new InvalidArgumentException("Unmatch data type", 0);
+        }
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException("Unsupported data type", 0);
+        }
+        $this->assert_work_buffer_spec($dtype, $work, $offsetWork, $lwork);
+
+        $this->gesvdColumns(
+            $matrix_layout, $dtype, $jobu, $jobvt, $m, $n,
+            $A,  $offsetA,  $ldA,  $strideA,
+            $S,  $offsetS,  $strideS,
+            $U,  $offsetU,  $ldU,  $strideU,
+            $VT, $offsetVT, $ldVT, $strideVT,
+            $batchCount,
+            $work, $offsetWork, $lwork,
+        );
+    }
+
+    /**
+     * Eigenvalues and eigenvectors of every symmetric matrix in a strided batch.
+     *
+     * A[i] starts at offsetA + i*strideA (W likewise).
+     * jobz accepts ord('N') and ord('V'), uplo accepts ord('U') and ord('L').
+     * Eigenvalues are stored in ascending order. When jobz is 'V', the
+     * eigenvectors overwrite A as columns.
+     */
+    public function syevStridedBatch(
+        int $matrix_layout,
+        int $jobz,
+        int $uplo,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $W,  int $offsetW,  int $strideW,
+        int $batchCount
+    ) : void
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        if($matrix_layout!=self::LAPACK_ROW_MAJOR && $matrix_layout!=self::LAPACK_COL_MAJOR) {
+            throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+        }
+        $jobz = chr($jobz);
+        $uplo = chr($uplo);
+        if($jobz!='N' && $jobz!='V') {
+            throw new InvalidArgumentException("jobz must be 'N' or 'V'");
+        }
+        if($uplo!='U' && $uplo!='L') {
+            throw new InvalidArgumentException("uplo must be 'U' or 'L'");
+        }
+
+        // Check Buffer A
+        $this->assert_strided_matrix_buffer_spec("A", $A, $matrix_layout, $n, $n, $offsetA, $ldA, $strideA, $batchCount);
+        // Check Buffer W
+        if($strideW<0) {
+            throw new InvalidArgumentException("Argument strideW must be greater than equals 0.");
+        }
+        $this->assert_buffer_size($W, $offsetW+($batchCount-1)*$strideW, $n, "BufferW size is too small");
+
+        $dtype = $A->dtype();
+        if($dtype!=$W->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type", 0);
+        }
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException("Unsupported data type", 0);
+        }
+
+        $this->syevBatch(
+            $dtype, $matrix_layout, $jobz, $uplo, $n,
+            $A,  $offsetA,  $ldA,  $strideA,
+            $W,  $offsetW,  $strideW,
+            $batchCount
+        );
+    }
+}
@@ -18,19 +18,36 @@ class ffi_char_t2
 class Lapackb implements Lapack
 {
     use Utils;
+    use LapackBatch;
 
     const LAPACK_WORK_MEMORY_ERROR      = -1010;
     const LAPACK_TRANSPOSE_MEMORY_ERROR = -1010;
     const LAPACK_ROW_MAJOR = 101;
     const LAPACK_COL_MAJOR = 102;
 
-    protected FFI $ffi;
-    protected FFI $blas;
+    protected FFI|SuffixedFFI $ffi;
+    protected FFI|SuffixedFFI $blas;
+    protected ScratchPool $pool;
+    // m*n from which transpositions use omatcopy instead of gemm
+    protected int $omatcopyMinSize;
 
-    public function __construct(FFI $ffi, FFI $blas)
+    /**
+     * @param array<string,bool> $capabilities capabilities of the blas library
+     */
+    public function __construct(
+        FFI|SuffixedFFI $ffi,
+        FFI|SuffixedFFI $blas,
+        ?array $capabilities=null,
+        ?PerformanceProfile $profile=null,
+        ?ScratchPool $pool=null,
+        )
     {
         $this->ffi = $ffi;
         $this->blas = $blas;
+        $this->pool = $pool ?? new ScratchPool($ffi);
+        $profile ??= new PerformanceProfile();
+        $this->omatcopyMinSize = ($capabilities['omatcopy'] ?? false) ?
+            $profile->getInt('omatcopy_transpose_min_size') : PHP_INT_MAX;
     }
 
     public function ffi() : object
@@ -39,14 +56,21 @@ class Lapackb implements Lapack
     }
 
     /**
-     * Get a temporary identity matrix (ColMajor layout).
-     * Consider caching these if memory/performance becomes an issue.
+     * The pool of the temporaries.
+     */
+    public function scratchPool() : ScratchPool
+    {
+        return $this->pool;
+    }
+
+    /**
+     * Get a temporary identity matrix (ColMajor layout) from the scratch pool.
      */
     private function getIdentity(int $size, int $dtype, string $type) : FFI\CData
     {
-        $identity_p = $this->ffi->new("{$type}[$size * $size]");
+        $identity_p = $this->pool->acquire($type, $size * $size);
         // Initialize with zeros
-        $this->ffi::memset($identity_p, 0, $this->ffi::sizeof($identity_p));
+        FFI::memset($identity_p, 0, $size * $size * FFI::sizeof($this->ffi->type($type)));
         // Set diagonal elements to 1.0 (ColMajor: I[i,i] is at offset i*size + i)
         for($i = 0; $i < $size; $i++) {
             $identity_p[$i * $size + $i] = 1.0;
@@ -67,6 +91,13 @@ class Lapackb implements Lapack
     {
         if ($ldA < $n) throw new InvalidArgumentException("transpose_row_to_col_gemm: ldA must be >= n");
         if ($ldB < $m) throw new InvalidArgumentException("transpose_row_to_col_gemm: ldB must be >= m");
+
+        if ($m*$n >= $this->omatcopyMinSize) {
+            // A is the ColMajor n x m matrix, B its ColMajor transpose.
+            $omatcopy_func = ($dtype == NDArray::float32) ? 'cblas_somatcopy' : 'cblas_domatcopy';
+            $this->blas->{$omatcopy_func}(BLAS::ColMajor, BLAS::Trans, $n, $m, 1.0, $A_ptr, $ldA, $B_ptr, $ldB);
+            return;
+        }
     
         $type = ($dtype == NDArray::float32) ? 'float' : 'double';
         $gemm_func = ($dtype == NDArray::float32) ? 'cblas_sgemm' : 'cblas_dgemm';
@@ -97,6 +128,7 @@ class Lapackb implements Lapack
             0.0,
             $B_ptr, $ldB        // C is ColMajor(m,n) ld=m
         );
+        $this->pool->release($identity_n);
     }
     
     /**
@@ -112,6 +144,13 @@ class Lapackb implements Lapack
     {
         if ($ldA < $m) throw new InvalidArgumentException("transpose_col_to_row_gemm: ldA must be >= m");
         if ($ldB < $n) throw new InvalidArgumentException("transpose_col_to_row_gemm: ldB must be >= n");
+
+        if ($m*$n >= $this->omatcopyMinSize) {
+            // B is the ColMajor n x m transpose of A.
+            $omatcopy_func = ($dtype == NDArray::float32) ? 'cblas_somatcopy' : 'cblas_domatcopy';
+            $this->blas->{$omatcopy_func}(BLAS::ColMajor, BLAS::Trans, $m, $n, 1.0, $A_ptr, $ldA, $B_ptr, $ldB);
+            return;
+        }
     
         $type = ($dtype == NDArray::float32) ? 'float' : 'double';
         $gemm_func = ($dtype == NDArray::float32) ? 'cblas_sgemm' : 'cblas_dgemm';
@@ -143,6 +182,7 @@ class Lapackb implements Lapack
             0.0,
             $B_ptr, $ldB        // C is ColMajor(n,m) ld=n (target buffer for RowMajor m x n)
         );
+        $this->pool->release($identity_m);
     }
 
     public function gesvd(
@@ -155,7 +195,8 @@ class Lapackb implements Lapack
         BufferInterface $S,  int $offsetS,
         BufferInterface $U,  int $offsetU,  int $ldU, // For ROW_MAJOR, ldU=colsU; For COL_MAJOR, ldU=$m
         BufferInterface $VT, int $offsetVT, int $ldVT, // For ROW_MAJOR, ldVT=$n; For COL_MAJOR, ldVT=rowsVT
-        BufferInterface $SuperB,  int $offsetSuperB
+        BufferInterface $SuperB,  int $offsetSuperB,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
     ) : void
     {
         $ffi = $this->ffi;
@@ -204,6 +245,20 @@ class Lapackb implements Lapack
             throw new InvalidArgumentException("bufferSuperB size is too small", 0);
         }
 
+        if($work!==null) {
+            // the workspace of the caller, without a query or a transposed copy
+            $this->gesvdWithWork(
+                $matrix_layout, $jobu, $jobvt, $m, $n,
+                $A,  $offsetA,  $ldA,
+                $S,  $offsetS,
+                $U,  $offsetU,  $ldU,
+                $VT, $offsetVT, $ldVT,
+                $SuperB, $offsetSuperB,
+                $work, $offsetWork, $lwork,
+            );
+            return;
+        }
+
         $k = min($m, $n);
         $dtype = $A->dtype();
         if($dtype==NDArray::float32) {
@@ -216,118 +271,343 @@ class Lapackb implements Lapack
             throw new InvalidArgumentException("Unsupported data type", 0);
         }
 
-        $targetA_ptr = null; // Pointer for COL_MAJOR A (if layout is RowMajor)
-        $targetU_ptr = null; // Pointer for COL_MAJOR U (if layout is RowMajor)
-        $targetVT_ptr = null;// Pointer for COL_MAJOR VT (if layout is RowMajor)
-        $ptrA = null;      // Pointer to A data for gesvd_
-        $ptrU = null;      // Pointer to U data for gesvd_
-        $ptrVT = null;     // Pointer to VT data for gesvd_
-        $ldA0 = 0;         // Leading dimension for A in gesvd_ (ColMajor ld = rows)
-        $ldU0 = 0;         // Leading dimension for U in gesvd_ (ColMajor ld = rows)
-        $ldVT0 = 0;        // Leading dimension for VT in gesvd_ (ColMajor ld = rows)
-
-        // Determine dimensions for sgesvd_ output (COL_MAJOR perspective)
-        // Actual number of columns computed for U (m x m or m x k)
-        $colsU_computed = ($jobu == ord('A')) ? $m : $k;
-        // Actual number of rows computed for VT (n x n or k x n)
-        $rowsVT_computed = ($jobvt == ord('A')) ? $n : $k;
-
-        if($matrix_layout == self::LAPACK_ROW_MAJOR) {
-            // --- Input Transpose: RowMajor A -> ColMajor targetA_ptr ---
-            $sizeA = $m * $n;
-            $targetA_ptr = $ffi->new("{$type}[{$sizeA}]");
-            $ldA_col = $m; // Target ColMajor LD is rows (m)
-            $this->transpose_row_to_col_gemm($m, $n, $dtype, $A->addr($offsetA), $ldA, $targetA_ptr, $ldA_col);
-            $ptrA = $targetA_ptr;
-            $ldA0 = $ldA_col; // LD for gesvd_ is m
-
-            // --- Allocate temporary ColMajor buffers for U and VT ---
-            $sizeU = $m * $colsU_computed;
-            $targetU_ptr = $ffi->new("{$type}[{$sizeU}]");
-            $ldU0 = $m; // gesvd_ needs ColMajor LD (rows)
-            $ptrU = $targetU_ptr;
-
-            // VT is rowsVT_computed x n (ColMajor layout), ld = rowsVT_computed
-            $ldVT0 = $rowsVT_computed;
-            $sizeVT = $ldVT0 * $n;
-            $targetVT_ptr = $ffi->new("{$type}[{$sizeVT}]");
-            $ptrVT = $targetVT_ptr;
-
-        } elseif($matrix_layout == self::LAPACK_COL_MAJOR) {
-            // Data is already in COL_MAJOR, use buffers directly
-            $ptrA = $A->addr($offsetA);
-            $ldA0 = $ldA; // Caller provided ColMajor ld (m)
-            $ptrU = $U->addr($offsetU);
-            $ldU0 = $ldU; // Caller provided ColMajor ld (m)
-            $ptrVT = $VT->addr($offsetVT);
-            $ldVT0 = $ldVT; // Caller provided ColMajor ld (rowsVT_computed)
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            $targetA_ptr = null; // Pointer for COL_MAJOR A (if layout is RowMajor)
+            $targetU_ptr = null; // Pointer for COL_MAJOR U (if layout is RowMajor)
+            $targetVT_ptr = null;// Pointer for COL_MAJOR VT (if layout is RowMajor)
+            $ptrA = null;      // Pointer to A data for gesvd_
+            $ptrU = null;      // Pointer to U data for gesvd_
+            $ptrVT = null;     // Pointer to VT data for gesvd_
+            $ldA0 = 0;         // Leading dimension for A in gesvd_ (ColMajor ld = rows)
+            $ldU0 = 0;         // Leading dimension for U in gesvd_ (ColMajor ld = rows)
+            $ldVT0 = 0;        // Leading dimension for VT in gesvd_ (ColMajor ld = rows)
+
+            // Determine dimensions for sgesvd_ output (COL_MAJOR perspective)
+            // Actual number of columns computed for U (m x m or m x k)
+            $colsU_computed = ($jobu == ord('A')) ? $m : $k;
+            // Actual number of rows computed for VT (n x n or k x n)
+            $rowsVT_computed = ($jobvt == ord('A')) ? $n : $k;
+
+            if($matrix_layout == self::LAPACK_ROW_MAJOR) {
+                // --- Input Transpose: RowMajor A -> ColMajor targetA_ptr ---
+                $sizeA = $m * $n;
+                $targetA_ptr = $pool->acquire($type, $sizeA);
+                $ldA_col = $m; // Target ColMajor LD is rows (m)
+                $this->transpose_row_to_col_gemm($m, $n, $dtype, $A->addr($offsetA), $ldA, $targetA_ptr, $ldA_col);
+                $ptrA = $targetA_ptr;
+                $ldA0 = $ldA_col; // LD for gesvd_ is m
+
+                // --- Allocate temporary ColMajor buffers for U and VT ---
+                $sizeU = $m * $colsU_computed;
+                $targetU_ptr = $pool->acquire($type, $sizeU);
+                $ldU0 = $m; // gesvd_ needs ColMajor LD (rows)
+                $ptrU = $targetU_ptr;
+
+                // VT is rowsVT_computed x n (ColMajor layout), ld = rowsVT_computed
+                $ldVT0 = $rowsVT_computed;
+                $sizeVT = $ldVT0 * $n;
+                $targetVT_ptr = $pool->acquire($type, $sizeVT);
+                $ptrVT = $targetVT_ptr;
+
+            } elseif($matrix_layout == self::LAPACK_COL_MAJOR) {
+                // Data is already in COL_MAJOR, use buffers directly
+                $ptrA = $A->addr($offsetA);
+                $ldA0 = $ldA; // Caller provided ColMajor ld (m)
+                $ptrU = $U->addr($offsetU);
+                $ldU0 = $ldU; // Caller provided ColMajor ld (m)
+                $ptrVT = $VT->addr($offsetVT);
+                $ldVT0 = $ldVT; // Caller provided ColMajor ld (rowsVT_computed)
+            } else {
+                throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+            }
+
+            // Prepare parameters for gesvd_
+            $jobu_p = $pool->cell('char', chr($jobu));
+            $jobvt_p = $pool->cell('char', chr($jobvt));
+            $m_p = $pool->cell('lapack_int', $m);
+            $n_p = $pool->cell('lapack_int', $n);
+            $ldA_p = $pool->cell('lapack_int', $ldA0);
+            $ldU_p = $pool->cell('lapack_int', $ldU0);
+            $ldVT_p = $pool->cell('lapack_int', $ldVT0); // Use ColMajor ldVT0
+            $info_p = $pool->cell('lapack_int', 0);
+            $lwork_p = $pool->cell('lapack_int', -1);
+            $wkopt_p = $pool->acquire($type); // For workspace query
+
+            // --- Workspace query ---
+            $ffi->{$gesvd_func}(
+                $jobu_p, $jobvt_p, $m_p, $n_p,
+                $ptrA, $ldA_p,
+                $S->addr($offsetS),
+                $ptrU, $ldU_p,
+                $ptrVT, $ldVT_p, // Pass correct ColMajor ldVT0
+                $wkopt_p, $lwork_p, $info_p
+            );
+            $info = $info_p[0];
+            if ($info != 0) {
+                throw new RuntimeException("gesvd_ workspace query failed. error=$info", $info);
+            }
+
+            $lwork = max(1,(int)$wkopt_p[0]);
+            $lwork_p[0] = $lwork;
+            $work_p = $pool->acquire($type, $lwork);
+            $info_p[0] = 0; // Reset info
+
+            // --- Actual gesvd_ call ---
+            $ffi->{$gesvd_func}(
+                $jobu_p, $jobvt_p, $m_p, $n_p,
+                $ptrA, $ldA_p,
+                $S->addr($offsetS),
+                $ptrU, $ldU_p,
+                $ptrVT, $ldVT_p, // Pass correct ColMajor ldVT0
+                $work_p, $lwork_p, $info_p
+            );
+            $info = $info_p[0];
+            // Check info for errors (negative values) or convergence issues (positive values)
+            if ($info < 0) {
+                throw new RuntimeException("gesvd_ parameter error. argument ".(-$info)." had an illegal value.", $info);
+            }
+            if ($info > 0) {
+                /* Handle convergence failure if needed, e.g., log a warning */
+                error_log("Warning: gesvd_ failed to converge. ".$info." superdiagonals did not converge.");
+            }
+
+            // --- SuperB copy (optional, usually internal detail) ---
+            // $superb_len = $k - 1;
+            // if ($superb_len > 0 && count($SuperB) >= $superb_len) { ... } // Be cautious if implementing
+
+            // --- Output Transpose (if input was RowMajor) ---
+            if($matrix_layout == self::LAPACK_ROW_MAJOR) {
+                // U: targetU_ptr (ColMajor, m x colsU_computed, ldU0=m) -> U buffer (RowMajor, m x colsU_computed, ldU=colsU_computed)
+                $this->transpose_col_to_row_gemm($m, $colsU_computed, $dtype, $ptrU, $ldU0, $U->addr($offsetU), $ldU);
+
+                // VT: targetVT_ptr (ColMajor, rowsVT_computed x n, ldVT0=rowsVT_computed) -> VT buffer (RowMajor, rowsVT_computed x n, ldVT=n)
+                $this->transpose_col_to_row_gemm($rowsVT_computed, $n, $dtype, $ptrVT, $ldVT0, $VT->addr($offsetVT), $ldVT);
+            }
+            // If layout was COL_MAJOR, results are already in the provided U, VT buffers.
+            // Temporaries ($targetA_ptr, $targetU_ptr, $targetVT_ptr, $work_p, etc.) go back to the pool.
+        } finally {
+            $pool->releaseTo($mark);
+        }
+    }
+
+    protected function gesvdColMajorBatch(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $gesvd_func = 'sgesvd_';
+        } else {
+            $type = 'double';
+            $gesvd_func = 'dgesvd_';
+        }
+
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            // Parameters are shared by the whole batch
+            $jobu_p = $pool->cell('char', $jobu);
+            $jobvt_p = $pool->cell('char', $jobvt);
+            $m_p = $pool->cell('lapack_int', $m);
+            $n_p = $pool->cell('lapack_int', $n);
+            $ldA_p = $pool->cell('lapack_int', $ldA);
+            $ldU_p = $pool->cell('lapack_int', $ldU);
+            $ldVT_p = $pool->cell('lapack_int', $ldVT);
+            $info_p = $pool->cell('lapack_int', 0);
+            if($work!==null) {
+                $lwork_p = $pool->cell('lapack_int', $lwork);
+                $work_p = $work->addr($offsetWork);
+            } else {
+                $lwork_p = $pool->cell('lapack_int', -1);
+                $wkopt_p = $pool->acquire($type);
+
+                // --- Workspace query ---
+                $ffi->{$gesvd_func}(
+                    $jobu_p, $jobvt_p, $m_p, $n_p,
+                    $A->addr($offsetA), $ldA_p,
+                    $S->addr($offsetS),
+                    $U->addr($offsetU), $ldU_p,
+                    $VT->addr($offsetVT), $ldVT_p,
+                    $wkopt_p, $lwork_p, $info_p
+                );
+                $info = $info_p[0];
+                if ($info != 0) {
+                    throw new RuntimeException("gesvd_ workspace query failed. error=$info", $info);
+                }
+                $lwork = max(1,(int)$wkopt_p[0]);
+                $lwork_p[0] = $lwork;
+                $work_p = $pool->acquire($type, $lwork);
+            }
+
+            for($i=0; $i<$batchCount; $i++) {
+                $info_p[0] = 0;
+                $ffi->{$gesvd_func}(
+                    $jobu_p, $jobvt_p, $m_p, $n_p,
+                    $A->addr($offsetA+$i*$strideA), $ldA_p,
+                    $S->addr($offsetS+$i*$strideS),
+                    $U->addr($offsetU+$i*$strideU), $ldU_p,
+                    $VT->addr($offsetVT+$i*$strideVT), $ldVT_p,
+                    $work_p, $lwork_p, $info_p
+                );
+                $info = $info_p[0];
+                if ($info < 0) {
+                    throw new RuntimeException("gesvd_ parameter error. argument ".(-$info)." had an illegal value.", $info);
+                }
+                if ($info > 0) {
+                    error_log("Warning: gesvd_ failed to converge in batch $i. ".$info." superdiagonals did not converge.");
+                }
+            }
+        } finally {
+            $pool->releaseTo($mark);
+        }
+    }
+
+    protected function gesvdColMajorWorkspaceSize(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+    ) : int
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $gesvd_func = 'sgesvd_';
         } else {
-            throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+            $type = 'double';
+            $gesvd_func = 'dgesvd_';
         }
 
-        // Prepare parameters for gesvd_
-        $jobu_p = $ffi->new('char[1]'); $jobu_p[0] = chr($jobu);
-        $jobvt_p = $ffi->new('char[1]'); $jobvt_p[0] = chr($jobvt);
-        $m_p = $ffi->new('lapack_int[1]'); $m_p[0] = $m;
-        $n_p = $ffi->new('lapack_int[1]'); $n_p[0] = $n;
-        $ldA_p = $ffi->new('lapack_int[1]'); $ldA_p[0] = $ldA0;
-        $ldU_p = $ffi->new('lapack_int[1]'); $ldU_p[0] = $ldU0;
-        $ldVT_p = $ffi->new('lapack_int[1]'); $ldVT_p[0] = $ldVT0; // Use ColMajor ldVT0
-        $info_p = $ffi->new("lapack_int[1]"); $info_p[0] = 0;
-        $lwork_p = $ffi->new("lapack_int[1]"); $lwork_p[0] = -1;
-        $wkopt_p = $ffi->new("{$type}[1]"); // For workspace query
-
-        // --- Workspace query ---
-        $ffi->{$gesvd_func}(
-            $jobu_p, $jobvt_p, $m_p, $n_p,
-            $ptrA, $ldA_p,
-            $S->addr($offsetS),
-            $ptrU, $ldU_p,
-            $ptrVT, $ldVT_p, // Pass correct ColMajor ldVT0
-            $wkopt_p, $lwork_p, $info_p
-        );
-        $info = $info_p[0];
-        if ($info != 0) {
-            throw new RuntimeException("gesvd_ workspace query failed. error=$info", $info);
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            // The query reads no matrix, only the leading dimensions have to be valid.
+            $jobu_p = $pool->cell('char', $jobu);
+            $jobvt_p = $pool->cell('char', $jobvt);
+            $m_p = $pool->cell('lapack_int', $m);
+            $n_p = $pool->cell('lapack_int', $n);
+            $ldA_p = $pool->cell('lapack_int', max(1,$m));
+            $ldVT_p = $pool->cell('lapack_int', max(1,$n));
+            $info_p = $pool->cell('lapack_int', 0);
+            $lwork_p = $pool->cell('lapack_int', -1);
+            $wkopt_p = $pool->acquire($type);
+            $ffi->{$gesvd_func}(
+                $jobu_p, $jobvt_p, $m_p, $n_p,
+                null, $ldA_p,
+                null,
+                null, $ldA_p,
+                null, $ldVT_p,
+                $wkopt_p, $lwork_p, $info_p
+            );
+            $info = $info_p[0];
+            if ($info != 0) {
+                throw new RuntimeException("gesvd_ workspace query failed. error=$info", $info);
+            }
+            return max(1,(int)$wkopt_p[0]);
+        } finally {
+            $pool->releaseTo($mark);
         }
+    }
 
-        $lwork = (int)$wkopt_p[0];
-        $lwork_p[0] = $lwork;
-        $work = $ffi->new("{$type}[{$lwork}]");
-        $info_p[0] = 0; // Reset info
-
-        // --- Actual gesvd_ call ---
-        $ffi->{$gesvd_func}(
-            $jobu_p, $jobvt_p, $m_p, $n_p,
-            $ptrA, $ldA_p,
-            $S->addr($offsetS),
-            $ptrU, $ldU_p,
-            $ptrVT, $ldVT_p, // Pass correct ColMajor ldVT0
-            $work, $lwork_p, $info_p
-        );
-        $info = $info_p[0];
-        // Check info for errors (negative values) or convergence issues (positive values)
-        if ($info < 0) {
-            throw new RuntimeException("gesvd_ parameter error. argument ".(-$info)." had an illegal value.", $info);
+    protected function syevBatch(
+        int $dtype,
+        int $matrix_layout,
+        string $jobz,
+        string $uplo,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $W,  int $offsetW,  int $strideW,
+        int $batchCount
+    ) : void
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $syev_func = 'ssyev_';
+        } else {
+            $type = 'double';
+            $syev_func = 'dsyev_';
         }
-        if ($info > 0) {
-            /* Handle convergence failure if needed, e.g., log a warning */
-            error_log("Warning: gesvd_ failed to converge. ".$info." superdiagonals did not converge.");
+        $rowMajor = ($matrix_layout==self::LAPACK_ROW_MAJOR);
+        if($rowMajor) {
+            // The upper triangle of a RowMajor matrix is the lower triangle
+            // of the same symmetric matrix in ColMajor.
+            $uplo = ($uplo=='U') ? 'L' : 'U';
         }
 
-        // --- SuperB copy (optional, usually internal detail) ---
-        // $superb_len = $k - 1;
-        // if ($superb_len > 0 && count($SuperB) >= $superb_len) { ... } // Be cautious if implementing
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            // Parameters are shared by the whole batch
+            $jobz_p = $pool->cell('char', $jobz);
+            $uplo_p = $pool->cell('char', $uplo);
+            $n_p = $pool->cell('lapack_int', $n);
+            $ldA_p = $pool->cell('lapack_int', $ldA);
+            $info_p = $pool->cell('lapack_int', 0);
+            $lwork_p = $pool->cell('lapack_int', -1);
+            $wkopt_p = $pool->acquire($type);
+
+            // --- Workspace query ---
+            $ffi->{$syev_func}(
+                $jobz_p, $uplo_p, $n_p,
+                $A->addr($offsetA), $ldA_p,
+                $W->addr($offsetW),
+                $wkopt_p, $lwork_p, $info_p
+            );
+            $info = $info_p[0];
+            if ($info != 0) {
+                throw new RuntimeException("syev_ workspace query failed. error=$info", $info);
+            }
+            $lwork = max(1,(int)$wkopt_p[0]);
+            $lwork_p[0] = $lwork;
+            $work = $pool->acquire($type, $lwork);
 
-        // --- Output Transpose (if input was RowMajor) ---
-        if($matrix_layout == self::LAPACK_ROW_MAJOR) {
-            // U: targetU_ptr (ColMajor, m x colsU_computed, ldU0=m) -> U buffer (RowMajor, m x colsU_computed, ldU=colsU_computed)
-            $this->transpose_col_to_row_gemm($m, $colsU_computed, $dtype, $ptrU, $ldU0, $U->addr($offsetU), $ldU);
+            $transposed = null;
+            if($rowMajor && $jobz=='V') {
+                $transposed = $pool->acquire($type, $n * $n);
+            }
+            $rowBytes = $n*$A->value_size();
 
-            // VT: targetVT_ptr (ColMajor, rowsVT_computed x n, ldVT0=rowsVT_computed) -> VT buffer (RowMajor, rowsVT_computed x n, ldVT=n)
-            $this->transpose_col_to_row_gemm($rowsVT_computed, $n, $dtype, $ptrVT, $ldVT0, $VT->addr($offsetVT), $ldVT);
+            for($i=0; $i<$batchCount; $i++) {
+                $info_p[0] = 0;
+                $ptrA = $A->addr($offsetA+$i*$strideA);
+                $ffi->{$syev_func}(
+                    $jobz_p, $uplo_p, $n_p,
+                    $ptrA, $ldA_p,
+                    $W->addr($offsetW+$i*$strideW),
+                    $work, $lwork_p, $info_p
+                );
+                $info = $info_p[0];
+                if ($info < 0) {
+                    throw new RuntimeException("syev_ parameter error. argument ".(-$info)." had an illegal value.", $info);
+                }
+                if ($info > 0) {
+                    error_log("Warning: syev_ failed to converge in batch $i. ".$info." off-diagonal elements did not converge.");
+                }
+                if($transposed!==null) {
+                    // The eigenvectors are the ColMajor columns; store them as RowMajor columns.
+                    $this->transpose_col_to_row_gemm($n, $n, $dtype, $ptrA, $ldA, $transposed, $n);
+                    for($j=0; $j<$n; $j++) {
+                        FFI::memcpy($A->addr($offsetA+$i*$strideA+$j*$ldA), FFI::addr($transposed[$j*$n]), $rowBytes);
+                    }
+                }
+            }
+        } finally {
+            $pool->releaseTo($mark);
         }
-        // If layout was COL_MAJOR, results are already in the provided U, VT buffers.
-        // Temporary FFI CData ($targetA_ptr, $targetU_ptr, $targetVT_ptr, $work, etc.) will be garbage collected.
     }
 }
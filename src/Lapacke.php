@@ -16,13 +16,16 @@ class ffi_char_t
 class Lapacke implements Lapack
 {
     use Utils;
+    use LapackBatch;
 
     const LAPACK_WORK_MEMORY_ERROR      = -1010;
     const LAPACK_TRANSPOSE_MEMORY_ERROR = -1010;
+    const LAPACK_ROW_MAJOR = 101;
+    const LAPACK_COL_MAJOR = 102;
 
-    protected FFI $ffi;
+    protected FFI|SuffixedFFI $ffi;
 
-    public function __construct(FFI $ffi)
+    public function __construct(FFI|SuffixedFFI $ffi)
     {
         $this->ffi = $ffi;
     }
@@ -42,7 +45,8 @@ class Lapacke implements Lapack
         BufferInterface $S,  int $offsetS,
         BufferInterface $U,  int $offsetU,  int $ldU,
         BufferInterface $VT, int $offsetVT, int $ldVT,
-        BufferInterface $SuperB,  int $offsetSuperB
+        BufferInterface $SuperB,  int $offsetSuperB,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
     ) : void
     {
         $ffi = $this->ffi;
@@ -99,6 +103,19 @@ class Lapacke implements Lapack
         ) {
             throw new InvalidArgumentException("Unmatch data type", 0);
         }
+        if($work!==null) {
+            // the workspace of the caller, without a query or a transposed copy
+            $this->gesvdWithWork(
+                $matrix_layout, $jobu, $jobvt, $m, $n,
+                $A,  $offsetA,  $ldA,
+                $S,  $offsetS,
+                $U,  $offsetU,  $ldU,
+                $VT, $offsetVT, $ldVT,
+                $SuperB, $offsetSuperB,
+                $work, $offsetWork, $lwork,
+            );
+            return;
+        }
         /** @var ffi_char_t $jobu_p */
         $jobu_p = $ffi->new('char');
         $jobu_p->cdata = chr($jobu);
@@ -143,4 +160,171 @@ class Lapacke implements Lapack
             throw new RuntimeException( "Wrong parameter. error=$info", $info);
         }
     }
+
+    protected function gesvdColMajorBatch(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $S,  int $offsetS,  int $strideS,
+        BufferInterface $U,  int $offsetU,  int $ldU,  int $strideU,
+        BufferInterface $VT, int $offsetVT, int $ldVT, int $strideVT,
+        int $batchCount,
+        ?BufferInterface $work=null, int $offsetWork=0, int $lwork=0,
+    ) : void
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $gesvd_func = 'LAPACKE_sgesvd_work';
+        } else {
+            $type = 'double';
+            $gesvd_func = 'LAPACKE_dgesvd_work';
+        }
+        /** @var ffi_char_t $jobu_p */
+        $jobu_p = $ffi->new('char');
+        $jobu_p->cdata = $jobu;
+        /** @var ffi_char_t $jobvt_p */
+        $jobvt_p = $ffi->new('char');
+        $jobvt_p->cdata = $jobvt;
+
+        if($work!==null) {
+            $work_p = $work->addr($offsetWork);
+        } else {
+            // --- Workspace query (shared by the whole batch) ---
+            $wkopt = $ffi->new("{$type}[1]");
+            $info = $ffi->{$gesvd_func}(
+                self::LAPACK_COL_MAJOR,
+                $jobu_p, $jobvt_p,
+                $m, $n,
+                $A->addr($offsetA), $ldA,
+                $S->addr($offsetS),
+                $U->addr($offsetU), $ldU,
+                $VT->addr($offsetVT), $ldVT,
+                $wkopt, -1
+            );
+            if( $info < 0 ) {
+                throw new RuntimeException( "Wrong parameter. error=$info", $info);
+            }
+            $lwork = max(1,(int)$wkopt[0]);
+            $work_p = $ffi->new("{$type}[{$lwork}]");
+        }
+
+        for($i=0; $i<$batchCount; $i++) {
+            $info = $ffi->{$gesvd_func}(
+                self::LAPACK_COL_MAJOR,
+                $jobu_p, $jobvt_p,
+                $m, $n,
+                $A->addr($offsetA+$i*$strideA), $ldA,
+                $S->addr($offsetS+$i*$strideS),
+                $U->addr($offsetU+$i*$strideU), $ldU,
+                $VT->addr($offsetVT+$i*$strideVT), $ldVT,
+                $work_p, $lwork
+            );
+            if( $info < 0 ) {
+                throw new RuntimeException( "Wrong parameter. error=$info", $info);
+            }
+        }
+    }
+
+    protected function gesvdColMajorWorkspaceSize(
+        int $dtype,
+        string $jobu,
+        string $jobvt,
+        int $m,
+        int $n,
+    ) : int
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $gesvd_func = 'LAPACKE_sgesvd_work';
+        } else {
+            $type = 'double';
+            $gesvd_func = 'LAPACKE_dgesvd_work';
+        }
+        /** @var ffi_char_t $jobu_p */
+        $jobu_p = $ffi->new('char');
+        $jobu_p->cdata = $jobu;
+        /** @var ffi_char_t $jobvt_p */
+        $jobvt_p = $ffi->new('char');
+        $jobvt_p->cdata = $jobvt;
+        // The query reads no matrix, only the leading dimensions have to be valid.
+        $wkopt = $ffi->new("{$type}[1]");
+        $info = $ffi->{$gesvd_func}(
+            self::LAPACK_COL_MAJOR,
+            $jobu_p, $jobvt_p,
+            $m, $n,
+            null, max(1,$m),
+            null,
+            null, max(1,$m),
+            null, max(1,$n),
+            $wkopt, -1
+        );
+        if( $info < 0 ) {
+            throw new RuntimeException( "Wrong parameter. error=$info", $info);
+        }
+        return max(1,(int)$wkopt[0]);
+    }
+
+    protected function syevBatch(
+        int $dtype,
+        int $matrix_layout,
+        string $jobz,
+        string $uplo,
+        int $n,
+        BufferInterface $A,  int $offsetA,  int $ldA,  int $strideA,
+        BufferInterface $W,  int $offsetW,  int $strideW,
+        int $batchCount
+    ) : void
+    {
+        $ffi = $this->ffi;
+        if($dtype==NDArray::float32) {
+            $type = 'float';
+            $syev_func = 'LAPACKE_ssyev_work';
+        } else {
+            $type = 'double';
+            $syev_func = 'LAPACKE_dsyev_work';
+        }
+        /** @var ffi_char_t $jobz_p */
+        $jobz_p = $ffi->new('char');
+        $jobz_p->cdata = $jobz;
+        /** @var ffi_char_t $uplo_p */
+        $uplo_p = $ffi->new('char');
+        $uplo_p->cdata = $uplo;
+
+        // --- Workspace query (shared by the whole batch) ---
+        $wkopt = $ffi->new("{$type}[1]");
+        $info = $ffi->{$syev_func}(
+            $matrix_layout,
+            $jobz_p, $uplo_p,
+            $n,
+            $A->addr($offsetA), $ldA,
+            $W->addr($offsetW),
+            $wkopt, -1
+        );
+        if( $info < 0 ) {
+            throw new RuntimeException( "Wrong parameter. error=$info", $info);
+        }
+        $lwork = max(1,(int)$wkopt[0]);
+        $work = $ffi->new("{$type}[{$lwork}]");
+
+        for($i=0; $i<$batchCount; $i++) {
+            $info = $ffi->{$syev_func}(
+                $matrix_layout,
+                $jobz_p, $uplo_p,
+                $n,
+                $A->addr($offsetA+$i*$strideA), $ldA,
+                $W->addr($offsetW+$i*$strideW),
+                $work, $lwork
+            );
+            if( $info == self::LAPACK_TRANSPOSE_MEMORY_ERROR ) {
+                throw new RuntimeException( "Not enough memory to transpose matrix.", $info);
+            } else if( $info < 0 ) {
+                throw new RuntimeException( "Wrong parameter. error=$info", $info);
+            }
+        }
+    }
 }
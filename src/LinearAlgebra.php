@@ -0,0 +1,361 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+use InvalidArgumentException;
+use RuntimeException;
+use FFI;
+
+/**
+ * Inverse, determinant and condition number of square matrices by LU and
+ * Cholesky factorization, for float32, float64, complex64 and complex128.
+ *
+ * Every function takes a strided batch: matrix i starts at offsetA + i*strideA
+ * and its result is element i of the output. The results do not depend on the
+ * layout except for cond(), because transposing a matrix transposes its
+ * inverse and keeps its determinant.
+ */
+class LinearAlgebra
+{
+    use Utils;
+
+    const LAPACK_ROW_MAJOR = 101;
+    const LAPACK_COL_MAJOR = 102;
+
+    /**
+     * routine prefix, real C type and complex flag of each data type
+     */
+    protected const TYPES = [
+        NDArray::float32    => ['s', 'float', false],
+        NDArray::float64    => ['d', 'double', false],
+        NDArray::complex64  => ['c', 'float', true],
+        NDArray::complex128 => ['z', 'double', true],
+    ];
+
+    protected FFI|SuffixedFFI $ffi;
+    protected ScratchPool $pool;
+
+    public function __construct(FFI|SuffixedFFI $ffi, ?ScratchPool $pool=null)
+    {
+        $this->ffi = $ffi;
+        $this->pool = $pool ?? new ScratchPool($ffi);
+    }
+
+    /**
+     * Overwrite each matrix with its inverse.
+     */
+    public function inv(
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        int $strideA=0,
+        int $batchCount=1,
+    ) : void
+    {
+        [$prefix, $type, $complex] = $this->assert_batch_spec($n, $A, $offsetA, $ldA, $strideA, $batchCount);
+        $ffi = $this->ffi;
+        $width = $complex ? 2 : 1;
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            $n_p = $pool->cell('lapack_int', $n);
+            $ldA_p = $pool->cell('lapack_int', $ldA);
+            $info_p = $pool->cell('lapack_int', 0);
+            $ipiv = $pool->acquire('lapack_int', $n);
+
+            // --- Workspace query (shared by the whole batch) ---
+            $lwork_p = $pool->cell('lapack_int', -1);
+            $wkopt = $pool->acquire($type, $width);
+            $ffi->{$prefix.'getri_'}($n_p, $A->addr($offsetA), $ldA_p, $ipiv, $wkopt, $lwork_p, $info_p);
+            $lwork = max($n, (int)$wkopt[0]);
+            $lwork_p[0] = $lwork;
+            $work = $pool->acquire($type, $lwork*$width);
+
+            for($i=0; $i<$batchCount; $i++) {
+                $a = $A->addr($offsetA+$i*$strideA);
+                $info_p[0] = 0;
+                $ffi->{$prefix.'getrf_'}($n_p, $n_p, $a, $ldA_p, $ipiv, $info_p);
+                if($info_p[0]==0) {
+                    $ffi->{$prefix.'getri_'}($n_p, $a, $ldA_p, $ipiv, $work, $lwork_p, $info_p);
+                }
+                $info = $info_p[0];
+                if($info<0) {
+                    throw new RuntimeException("getri parameter error. argument ".(-$info)." had an illegal value.", $info);
+                }
+                if($info>0) {
+                    throw new RuntimeException("Matrix {$i} is singular.", $info);
+                }
+            }
+        } finally {
+            $pool->releaseTo($mark);
+        }
+    }
+
+    /**
+     * Determinant of each matrix into element i of det (same dtype as A).
+     * A is not modified.
+     */
+    public function det(
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $det, int $offsetDet,
+        int $strideA=0,
+        int $batchCount=1,
+    ) : void
+    {
+        [, , $complex] = $this->assert_batch_spec($n, $A, $offsetA, $ldA, $strideA, $batchCount);
+        $this->assert_output_spec('Det', $det, $offsetDet, $batchCount, $A->dtype());
+        $this->luDiagonals($n, $A, $offsetA, $ldA, $strideA, $batchCount,
+            function(int $i, array $diagonal, bool $negate) use ($det, $offsetDet, $complex) {
+                $re = $negate ? -1.0 : 1.0;
+                $im = 0.0;
+                foreach($diagonal as [$dre, $dim]) {
+                    [$re, $im] = [$re*$dre - $im*$dim, $re*$dim + $im*$dre];
+                }
+                $this->writeValues($det, $offsetDet+$i, $complex ? [$re, $im] : [$re]);
+            });
+    }
+
+    /**
+     * Sign and natural logarithm of the absolute value of each determinant.
+     * sign has the dtype of A and is a unit complex number for complex dtypes;
+     * a singular matrix has sign 0 and logAbsDet -INF. logAbsDet is real.
+     * A is not modified.
+     */
+    public function slogdet(
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $sign, int $offsetSign,
+        BufferInterface $logAbsDet, int $offsetLogAbsDet,
+        int $strideA=0,
+        int $batchCount=1,
+    ) : void
+    {
+        [, , $complex] = $this->assert_batch_spec($n, $A, $offsetA, $ldA, $strideA, $batchCount);
+        $this->assert_output_spec('Sign', $sign, $offsetSign, $batchCount, $A->dtype());
+        $this->assert_output_spec('LogAbsDet', $logAbsDet, $offsetLogAbsDet, $batchCount, $this->realDtype($A->dtype()));
+        $this->luDiagonals($n, $A, $offsetA, $ldA, $strideA, $batchCount,
+            function(int $i, array $diagonal, bool $negate)
+                use ($sign, $offsetSign, $logAbsDet, $offsetLogAbsDet, $complex) {
+                $re = $negate ? -1.0 : 1.0;
+                $im = 0.0;
+                $log = 0.0;
+                foreach($diagonal as [$dre, $dim]) {
+                    $abs = hypot($dre, $dim);
+                    if($abs==0.0) {
+                        [$re, $im, $log] = [0.0, 0.0, -INF];
+                        break;
+                    }
+                    $log += log($abs);
+                    [$re, $im] = [($re*$dre - $im*$dim)/$abs, ($re*$dim + $im*$dre)/$abs];
+                }
+                $this->writeValues($sign, $offsetSign+$i, $complex ? [$re, $im] : [$re]);
+                $this->writeValues($logAbsDet, $offsetLogAbsDet+$i, [$log]);
+            });
+    }
+
+    /**
+     * Estimated condition number of each matrix in the 1-norm (norm ord('1')
+     * or ord('O')) or the infinity-norm (ord('I')), into element i of cond (real).
+     *
+     * The general matrix is factorized by getrf and estimated by gecon. With
+     * positiveDefinite, the Hermitian positive definite matrix, stored in the
+     * uplo triangle (ord('U') when 0), is factorized by potrf and estimated by pocon.
+     * Singular matrices give INF. A is not modified.
+     */
+    public function cond(
+        int $matrix_layout,
+        int $norm,
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $cond, int $offsetCond,
+        int $strideA=0,
+        int $batchCount=1,
+        bool $positiveDefinite=false,
+        int $uplo=0,
+    ) : void
+    {
+        [$prefix, $type, $complex] = $this->assert_batch_spec($n, $A, $offsetA, $ldA, $strideA, $batchCount);
+        $this->assert_output_spec('Cond', $cond, $offsetCond, $batchCount, $this->realDtype($A->dtype()));
+        $norm = match(chr($norm)) {
+            '1', 'O' => 'O', 'I' => 'I',
+            default => throw new InvalidArgumentException("norm must be '1', 'O' or 'I'"),
+        };
+        $uplo = ($uplo==0) ? 'U' : chr($uplo);
+        if($uplo!='U' && $uplo!='L') {
+            throw new InvalidArgumentException("uplo must be 'U' or 'L'");
+        }
+        switch($matrix_layout) {
+            case self::LAPACK_COL_MAJOR: {
+                break;
+            }
+            case self::LAPACK_ROW_MAJOR: {
+                // LAPACK sees the transpose: the norms and the triangles swap.
+                $norm = ($norm=='O') ? 'I' : 'O';
+                $uplo = ($uplo=='U') ? 'L' : 'U';
+                break;
+            }
+            default: {
+                throw new InvalidArgumentException("Invalid matrix_layout: $matrix_layout");
+            }
+        }
+        if($positiveDefinite) {
+            // the 1-norm and the infinity-norm of a Hermitian matrix are equal
+            $norm = 'O';
+        }
+
+        $ffi = $this->ffi;
+        $width = $complex ? 2 : 1;
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            $norm_p = $pool->cell('char', $norm);
+            $uplo_p = $pool->cell('char', $uplo);
+            $n_p = $pool->cell('lapack_int', $n);
+            $ld_p = $pool->cell('lapack_int', $n);
+            $info_p = $pool->cell('lapack_int', 0);
+            $anorm_p = $pool->acquire($type);
+            $rcond_p = $pool->acquire($type);
+            $lu = $pool->acquire($type, $n*$n*$width);
+            $ipiv = $pool->acquire('lapack_int', $n);
+            $work = $pool->acquire($type, 4*$n);
+            // iwork for real types, rwork for complex types
+            $aux = $complex ? $pool->acquire($type, 2*$n) : $pool->acquire('lapack_int', $n);
+
+            for($i=0; $i<$batchCount; $i++) {
+                $this->copyMatrix($n, $A, $offsetA+$i*$strideA, $ldA, $lu, $width);
+                $info_p[0] = 0;
+                if($positiveDefinite) {
+                    $anorm_p[0] = $ffi->{$prefix.($complex ? 'lanhe_' : 'lansy_')}($norm_p, $uplo_p, $n_p, $lu, $ld_p, $work);
+                    $ffi->{$prefix.'potrf_'}($uplo_p, $n_p, $lu, $ld_p, $info_p);
+                    if($info_p[0]>0) {
+                        throw new RuntimeException("Matrix {$i} is not positive definite.", $info_p[0]);
+                    }
+                    $ffi->{$prefix.'pocon_'}($uplo_p, $n_p, $lu, $ld_p, $anorm_p, $rcond_p, $work, $aux, $info_p);
+                } else {
+                    $anorm_p[0] = $ffi->{$prefix.'lange_'}($norm_p, $n_p, $n_p, $lu, $ld_p, $work);
+                    $ffi->{$prefix.'getrf_'}($n_p, $n_p, $lu, $ld_p, $ipiv, $info_p);
+                    if($info_p[0]>0) {
+                        $this->writeValues($cond, $offsetCond+$i, [INF]);
+                        continue;
+                    }
+                    $ffi->{$prefix.'gecon_'}($norm_p, $n_p, $lu, $ld_p, $anorm_p, $rcond_p, $work, $aux, $info_p);
+                }
+                $info = $info_p[0];
+                if($info<0) {
+                    throw new RuntimeException("cond parameter error. argument ".(-$info)." had an illegal value.", $info);
+                }
+                $rcond = (float)$rcond_p[0];
+                $this->writeValues($cond, $offsetCond+$i, [($rcond==0.0) ? INF : 1.0/$rcond]);
+            }
+        } finally {
+            $pool->releaseTo($mark);
+        }
+    }
+
+    /**
+     * @return array{string,string,bool} routine prefix, real C type and complex flag
+     */
+    protected function assert_batch_spec(
+        int $n, BufferInterface $A, int $offsetA, int $ldA, int $strideA, int $batchCount) : array
+    {
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("batchCount", $batchCount);
+        if($ldA<$n) {
+            throw new InvalidArgumentException("Argument ldA must be greater than or equal n.");
+        }
+        if($strideA<0) {
+            throw new InvalidArgumentException("Argument strideA must be greater than equals 0.");
+        }
+        $this->assert_matrix_buffer_spec("A", $A, $n, $n, $offsetA, $ldA);
+        $this->assert_matrix_buffer_spec("A", $A, $n, $n, $offsetA+($batchCount-1)*$strideA, $ldA);
+        $dtype = $A->dtype();
+        if(!isset(self::TYPES[$dtype])) {
+            throw new InvalidArgumentException("Unsupported data type", 0);
+        }
+        return self::TYPES[$dtype];
+    }
+
+    protected function assert_output_spec(
+        string $name, BufferInterface $X, int $offset, int $batchCount, int $dtype) : void
+    {
+        $this->assert_buffer_size($X, $offset, $batchCount, "Buffer{$name} size is too small");
+        if($X->dtype()!=$dtype) {
+            throw new InvalidArgumentException("Unmatch data type of Buffer{$name}", 0);
+        }
+    }
+
+    protected function realDtype(int $dtype) : int
+    {
+        return match($dtype) {
+            NDArray::complex64 => NDArray::float32,
+            NDArray::complex128 => NDArray::float64,
+            default => $dtype,
+        };
+    }
+
+    /**
+     * Factorize a copy of each matrix by getrf and pass the diagonal of U as
+     * [real, imag] pairs and the parity of the row interchanges to $result.
+     * A singular matrix has a zero on the diagonal.
+     */
+    protected function luDiagonals(
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        int $strideA, int $batchCount,
+        callable $result,
+    ) : void
+    {
+        [$prefix, $type, $complex] = self::TYPES[$A->dtype()];
+        $ffi = $this->ffi;
+        $width = $complex ? 2 : 1;
+        $pool = $this->pool;
+        $mark = $pool->mark();
+        try {
+            $n_p = $pool->cell('lapack_int', $n);
+            $info_p = $pool->cell('lapack_int', 0);
+            $lu = $pool->acquire($type, $n*$n*$width);
+            $ipiv = $pool->acquire('lapack_int', $n);
+            for($i=0; $i<$batchCount; $i++) {
+                $this->copyMatrix($n, $A, $offsetA+$i*$strideA, $ldA, $lu, $width);
+                $info_p[0] = 0;
+                $ffi->{$prefix.'getrf_'}($n_p, $n_p, $lu, $n_p, $ipiv, $info_p);
+                if($info_p[0]<0) {
+                    throw new RuntimeException("getrf parameter error. argument ".(-$info_p[0])." had an illegal value.", $info_p[0]);
+                }
+                // info>0 leaves an exact zero on the diagonal
+                $negate = false;
+                $diagonal = [];
+                for($j=0; $j<$n; $j++) {
+                    if($ipiv[$j]!=$j+1) {
+                        $negate = !$negate;
+                    }
+                    $k = ($j*$n+$j)*$width;
+                    $diagonal[] = [(float)$lu[$k], $complex ? (float)$lu[$k+1] : 0.0];
+                }
+                $result($i, $diagonal, $negate);
+            }
+        } finally {
+            $pool->releaseTo($mark);
+        }
+    }
+
+    /**
+     * Copy a matrix into dense n x n scratch memory of width reals per element.
+     */
+    protected function copyMatrix(
+        int $n, BufferInterface $A, int $offsetA, int $ldA, FFI\CData $to, int $width) : void
+    {
+        $valueSize = $A->value_size();
+        if($ldA==$n) {
+            $from = $A->addr($offsetA);
+            FFI::memcpy($to, $from, $n*$n*$valueSize);
+            return;
+        }
+        for($j=0; $j<$n; $j++) {
+            $dest = $to+$j*$n*$width;
+            $from = $A->addr($offsetA+$j*$ldA);
+            FFI::memcpy($dest, $from, $n*$valueSize);
+        }
+    }
+}
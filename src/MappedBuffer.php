@@ -0,0 +1,111 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use InvalidArgumentException;
+use RuntimeException;
+
+/**
+ * A LinearBuffer backed by a memory-mapped file.
+ *
+ * addr() points into the mapping, so Blas reads the file pages directly
+ * and the kernel pages them in on first access. READONLY mappings must
+ * only be used as inputs: writing to them through addr() faults.
+ * COPY_ON_WRITE keeps the changes private to the process and SHARED
+ * writes them back to the file.
+ */
+class MappedBuffer extends NativeBuffer
+{
+    const READONLY = 0;
+    const COPY_ON_WRITE = 1;
+    const SHARED = 2;
+
+    // open(2)
+    protected const O_RDONLY = 0;
+    protected const O_RDWR = 2;
+
+    protected string $filename;
+    protected int $mode;
+
+    /**
+     * Map size elements of dtype starting at the byte offset of the file.
+     * size defaults to the rest of the file. A SHARED mapping extends the
+     * file when it is too small, the other modes throw.
+     */
+    public function __construct(
+        string $filename,
+        int $dtype,
+        ?int $size=null,
+        int $offset=0,
+        int $mode=self::READONLY,
+        ?int $advice=null,
+        )
+    {
+        $valueSize = static::valueSizeOf($dtype);
+        if($mode!=self::READONLY && $mode!=self::COPY_ON_WRITE && $mode!=self::SHARED) {
+            throw new InvalidArgumentException("unknown mode: {$mode}");
+        }
+        if($offset<0) {
+            throw new InvalidArgumentException('Argument offset must be greater than or equal 0.');
+        }
+        $libc = static::libc();
+        clearstatcache(true, $filename);
+        $fileSize = @filesize($filename);
+        if($fileSize===false) {
+            throw new RuntimeException("Cannot open file: {$filename}");
+        }
+        $size ??= intdiv(max($fileSize-$offset, 0), $valueSize);
+        if($size<=0) {
+            throw new InvalidArgumentException('Argument size must be greater than 0.');
+        }
+        $bytes = $size*$valueSize;
+        if($offset+$bytes>$fileSize) {
+            if($mode!=self::SHARED) {
+                throw new InvalidArgumentException("File is too small: {$filename}");
+            }
+            $this->extend($filename, $offset+$bytes);
+        }
+
+        // mmap needs an offset on a page boundary
+        $pageOffset = $offset % $libc->getpagesize();
+        $fd = $libc->open($filename, ($mode==self::SHARED) ? self::O_RDWR : self::O_RDONLY);
+        if($fd<0) {
+            throw new RuntimeException("Cannot open file: {$filename}");
+        }
+        $prot = ($mode==self::READONLY) ? self::PROT_READ : (self::PROT_READ|self::PROT_WRITE);
+        $flags = ($mode==self::SHARED) ? self::MAP_SHARED : self::MAP_PRIVATE;
+        $mapping = $libc->mmap(null, $pageOffset+$bytes, $prot, $flags, $fd, $offset-$pageOffset);
+        $libc->close($fd);
+        if(static::isMapFailed($mapping)) {
+            throw new RuntimeException("Cannot map file: {$filename}");
+        }
+        $this->attach($mapping, $pageOffset+$bytes, $pageOffset, $dtype, $size, $mode!=self::READONLY, $mode==self::SHARED);
+        $this->filename = $filename;
+        $this->mode = $mode;
+        if($advice!==null) {
+            $this->advise($advice);
+        }
+    }
+
+    protected function extend(string $filename, int $bytes) : void
+    {
+        $fp = @fopen($filename, 'r+b');
+        if($fp===false) {
+            throw new RuntimeException("Cannot open file: {$filename}");
+        }
+        $extended = ftruncate($fp, $bytes);
+        fclose($fp);
+        if(!$extended) {
+            throw new RuntimeException("Cannot extend file: {$filename}");
+        }
+    }
+
+    public function mode() : int
+    {
+        return $this->mode;
+    }
+
+    public function filename() : string
+    {
+        return $this->filename;
+    }
+}
@@ -0,0 +1,541 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use InvalidArgumentException;
+use RuntimeException;
+use FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+
+/**
+ * Elementwise functions and reductions for float32 and float64 buffers.
+ *
+ * Operations that BLAS can express run in OpenBLAS: the elementwise product
+ * is a triangular band matrix with a zero bandwidth, sums are products with
+ * a cached vector of ones, and broadcasts are rank-1 updates. multiply, sum,
+ * imax, reduceSum, reduceMean, broadcastAdd and the gemm of gemmEpilogue are
+ * vectorised this way.
+ *
+ * exp, log, tanh, sigmoid, relu, softmax and the bias and activation of
+ * gemmEpilogue are not. OpenBLAS has no such kernels, so they call a PHP
+ * function for each element and run at PHP speed, roughly one to two orders
+ * of magnitude slower than a vectorised loop. Chunks converted with
+ * pack/unpack only keep the number of FFI accesses per chunk constant
+ * instead of one per element.
+ */
+class Math
+{
+    use Utils;
+
+    // Number of elements converted at once by the PHP kernels
+    const CHUNK_SIZE = 8192;
+    // Number of elements of C computed by one gemm in gemmEpilogue()
+    const TILE_SIZE = 65536;
+
+    protected object $ffi;
+    protected OnesCache $onesCache;
+
+    public function __construct(FFI|SuffixedFFI $ffi, ?OnesCache $onesCache=null)
+    {
+        $this->ffi = $ffi;
+        $this->onesCache = $onesCache ?? new OnesCache($ffi);
+    }
+
+    /**
+     *  Y[i] := X[i] * Y[i]
+     */
+    public function multiply(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $ffi = $this->ffi;
+        $dtype = $this->assert_pair_spec($n, $X, $offsetX, $incX, $Y, $offsetY, $incY);
+        // Y := diag(X) * Y
+        $tbmv = ($dtype==NDArray::float32) ? 'cblas_stbmv' : 'cblas_dtbmv';
+        $ffi->{$tbmv}(
+            BLASIF::RowMajor, BLASIF::Upper, BLASIF::NoTrans, BLASIF::NonUnit,
+            $n, 0,
+            $X->addr($offsetX), $incX,
+            $Y->addr($offsetY), $incY);
+    }
+
+    /**
+     *  sum_i X[i]
+     */
+    public function sum(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : float
+    {
+        $ffi = $this->ffi;
+        $dtype = $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $dot = ($dtype==NDArray::float32) ? 'cblas_sdot' : 'cblas_ddot';
+        return $ffi->{$dot}($n, $X->addr($offsetX), $incX, $this->ones($n, $dtype), 1);
+    }
+
+    /**
+     *  The index of the first maximum of X
+     */
+    public function imax(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : int
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $index = 0;
+        $max = -INF;
+        if($incX!=1) {
+            for($i=0; $i<$n; $i++) {
+                $value = $X[$offsetX+$i*$incX];
+                if($value>$max) {
+                    $max = $value;
+                    $index = $i;
+                }
+            }
+            return $index;
+        }
+        for($i=0; $i<$n; $i+=self::CHUNK_SIZE) {
+            $values = $this->readValues($X, $offsetX+$i, min(self::CHUNK_SIZE, $n-$i));
+            $chunkMax = max($values);
+            if($chunkMax>$max) {
+                $max = $chunkMax;
+                $index = $i + (int)array_search($chunkMax, $values, true);
+            }
+        }
+        return $index;
+    }
+
+    /**
+     *  X[i] := exp(X[i])
+     */
+    public function exp(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $this->map($n, $X, $offsetX, $incX, 'exp');
+    }
+
+    /**
+     *  X[i] := log(X[i])
+     */
+    public function log(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $this->map($n, $X, $offsetX, $incX, 'log');
+    }
+
+    /**
+     *  X[i] := tanh(X[i])
+     */
+    public function tanh(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $this->map($n, $X, $offsetX, $incX, 'tanh');
+    }
+
+    /**
+     *  X[i] := 1 / (1 + exp(-X[i]))
+     */
+    public function sigmoid(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $this->map($n, $X, $offsetX, $incX, $this->activation('sigmoid'));
+    }
+
+    /**
+     *  X[i] := max(0, X[i])
+     */
+    public function relu(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $this->assert_single_spec($n, $X, $offsetX, $incX);
+        $this->map($n, $X, $offsetX, $incX, $this->activation('relu'));
+    }
+
+    /**
+     *  A[i][j] := exp(A[i][j]) / sum_k exp(A[i][k])
+     */
+    public function softmax(
+        int $m,
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA ) : void
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_matrix_buffer_spec("A", $A, $m, $n, $offsetA, $ldA);
+        $this->assert_dtype($A->dtype());
+
+        // Packed rows are converted together.
+        $rowsPerChunk = ($ldA==$n) ? max(1, intdiv(self::CHUNK_SIZE, $n)) : 1;
+        for($i=0; $i<$m; $i+=$rowsPerChunk) {
+            $rows = min($rowsPerChunk, $m-$i);
+            $values = $this->readValues($A, $offsetA+$i*$ldA, ($rows-1)*$ldA+$n);
+            $result = [];
+            foreach(array_chunk($values, $n) as $row) {
+                $max = max($row);
+                $row = array_map(function($x) use ($max) { return exp($x-$max); }, $row);
+                $sum = array_sum($row);
+                foreach($row as $x) {
+                    $result[] = $x / $sum;
+                }
+            }
+            $this->writeValues($A, $offsetA+$i*$ldA, $result);
+        }
+    }
+
+    /**
+     *  axis=0:  X[j] := alpha * sum_i A[i][j] + beta * X[j]   (X has n elements)
+     *  axis=1:  X[i] := alpha * sum_j A[i][j] + beta * X[i]   (X has m elements)
+     *
+     *  A gemv with a cached vector of ones.
+     */
+    public function reduceSum(
+        int $axis,
+        int $m,
+        int $n,
+        float $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        float $beta,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $ffi = $this->ffi;
+        $dtype = $this->assert_axis_spec($axis, $m, $n, $A, $offsetA, $ldA, $X, $offsetX, $incX);
+        $gemv = ($dtype==NDArray::float32) ? 'cblas_sgemv' : 'cblas_dgemv';
+        if($axis==0) {
+            $ffi->{$gemv}(BLASIF::RowMajor, BLASIF::Trans, $m, $n, $alpha,
+                $A->addr($offsetA), $ldA, $this->ones($m, $dtype), 1,
+                $beta, $X->addr($offsetX), $incX);
+        } else {
+            $ffi->{$gemv}(BLASIF::RowMajor, BLASIF::NoTrans, $m, $n, $alpha,
+                $A->addr($offsetA), $ldA, $this->ones($n, $dtype), 1,
+                $beta, $X->addr($offsetX), $incX);
+        }
+    }
+
+    /**
+     *  axis=0:  X[j] := mean_i A[i][j]
+     *  axis=1:  X[i] := mean_j A[i][j]
+     */
+    public function reduceMean(
+        int $axis,
+        int $m,
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $X, int $offsetX, int $incX ) : void
+    {
+        $count = ($axis==0) ? $m : $n;
+        $this->reduceSum($axis, $m, $n, 1.0/max(1, $count), $A, $offsetA, $ldA, 0.0, $X, $offsetX, $incX);
+    }
+
+    /**
+     *  axis=0:  A[i][j] := alpha * X[j] + A[i][j]   (X has n elements)
+     *  axis=1:  A[i][j] := alpha * X[i] + A[i][j]   (X has m elements)
+     *
+     *  A rank-1 update (ger) with a cached vector of ones.
+     */
+    public function broadcastAdd(
+        int $axis,
+        int $m,
+        int $n,
+        float $alpha,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $A, int $offsetA, int $ldA ) : void
+    {
+        $ffi = $this->ffi;
+        $dtype = $this->assert_axis_spec($axis, $m, $n, $A, $offsetA, $ldA, $X, $offsetX, $incX);
+        $ger = ($dtype==NDArray::float32) ? 'cblas_sger' : 'cblas_dger';
+        if($axis==0) {
+            $ffi->{$ger}(BLASIF::RowMajor, $m, $n, $alpha,
+                $this->ones($m, $dtype), 1, $X->addr($offsetX), $incX,
+                $A->addr($offsetA), $ldA);
+        } else {
+            $ffi->{$ger}(BLASIF::RowMajor, $m, $n, $alpha,
+                $X->addr($offsetX), $incX, $this->ones($n, $dtype), 1,
+                $A->addr($offsetA), $ldA);
+        }
+    }
+
+    /**
+     *  C := activation(alpha*op(A)*op(B) + beta*C + bias)
+     *
+     *  The bias has n elements added to every row, or m elements added to
+     *  every column with rowBias. activation is null, "relu", "gelu", "tanh"
+     *  or "sigmoid"; gelu uses the tanh approximation.
+     *
+     *  C is computed in tiles of rows. The bias and the activation are applied
+     *  to a tile right after its gemm, while it is still in the cache; they
+     *  run in PHP, one function call per element.
+     */
+    public function gemmEpilogue(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float $alpha,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float $beta,
+        BufferInterface $C, int $offsetC, int $ldC,
+        ?BufferInterface $bias=null, int $offsetBias=0, int $incBias=1,
+        bool $rowBias=false,
+        ?string $activation=null,
+        ) : void
+    {
+        $ffi = $this->ffi;
+        if($order==BLASIF::ColMajor) {
+            // C^T := op(B)^T * op(A)^T in RowMajor
+            [$transA, $transB] = [$transB, $transA];
+            [$m, $n] = [$n, $m];
+            [$A, $offsetA, $ldA, $B, $offsetB, $ldB] = [$B, $offsetB, $ldB, $A, $offsetA, $ldA];
+            $rowBias = !$rowBias;
+        } elseif($order!=BLASIF::RowMajor) {
+            throw new InvalidArgumentException("unknown order: {$order}");
+        }
+        $dtype = $this->assert_epilogue_spec(
+            $transA, $transB, $m, $n, $k,
+            $A, $offsetA, $ldA,
+            $B, $offsetB, $ldB,
+            $C, $offsetC, $ldC,
+        );
+        if($bias!==null) {
+            $this->assert_vector_buffer_spec("Bias", $bias, $rowBias ? $m : $n, $offsetBias, $incBias);
+            if($bias->dtype()!=$dtype) {
+                throw new InvalidArgumentException("Unmatch data type for C and Bias");
+            }
+        }
+        $func = ($activation!==null) ? $this->activation($activation) : null;
+
+        $gemm = ($dtype==NDArray::float32) ? 'cblas_sgemm' : 'cblas_dgemm';
+        $ger = ($dtype==NDArray::float32) ? 'cblas_sger' : 'cblas_dger';
+        $tile = min($m, max(1, intdiv(self::TILE_SIZE, $n)));
+        $columnBias = null;
+        if($func!==null && $bias!==null && !$rowBias) {
+            $columnBias = [];
+            for($j=0; $j<$n; $j++) {
+                $columnBias[] = $bias[$offsetBias+$j*$incBias];
+            }
+        }
+        for($i=0; $i<$m; $i+=$tile) {
+            $rows = min($tile, $m-$i);
+            $offsetTileA = ($transA==BLASIF::NoTrans) ? $offsetA+$i*$ldA : $offsetA+$i;
+            $ffi->{$gemm}(
+                BLASIF::RowMajor, $transA, $transB,
+                $rows, $n, $k,
+                $alpha,
+                $A->addr($offsetTileA), $ldA,
+                $B->addr($offsetB), $ldB,
+                $beta,
+                $C->addr($offsetC+$i*$ldC), $ldC);
+            if($func===null) {
+                if($bias===null) {
+                    continue;
+                }
+                // C := bias * ones^T + C  or  ones * bias^T + C
+                if($rowBias) {
+                    $ffi->{$ger}(BLASIF::RowMajor, $rows, $n, 1.0,
+                        $bias->addr($offsetBias+$i*$incBias), $incBias, $this->ones($n, $dtype), 1,
+                        $C->addr($offsetC+$i*$ldC), $ldC);
+                } else {
+                    $ffi->{$ger}(BLASIF::RowMajor, $rows, $n, 1.0,
+                        $this->ones($rows, $dtype), 1, $bias->addr($offsetBias), $incBias,
+                        $C->addr($offsetC+$i*$ldC), $ldC);
+                }
+                continue;
+            }
+            // Packed rows are converted together.
+            $rowsPerChunk = ($ldC==$n) ? max(1, intdiv(self::CHUNK_SIZE, $n)) : 1;
+            for($r=0; $r<$rows; $r+=$rowsPerChunk) {
+                $count = min($rowsPerChunk, $rows-$r);
+                $offset = $offsetC+($i+$r)*$ldC;
+                $values = $this->readValues($C, $offset, ($count-1)*$ldC+$n);
+                $result = [];
+                foreach(array_chunk($values, $n) as $j => $row) {
+                    if($columnBias!==null) {
+                        $row = array_map(function($x, $b) use ($func) { return $func($x+$b); }, $row, $columnBias);
+                    } elseif($bias!==null) {
+                        $b = $bias[$offsetBias+($i+$r+$j)*$incBias];
+                        $row = array_map(function($x) use ($func, $b) { return $func($x+$b); }, $row);
+                    } else {
+                        $row = array_map($func, $row);
+                    }
+                    array_push($result, ...$row);
+                }
+                $this->writeValues($C, $offset, $result);
+            }
+        }
+    }
+
+    /**
+     * Elementwise function of an activation name.
+     */
+    protected function activation(string $name) : callable
+    {
+        switch($name) {
+            case 'relu': {
+                return function(float $x) : float {
+                    return ($x>0.0) ? $x : 0.0;
+                };
+            }
+            case 'gelu': {
+                return function(float $x) : float {
+                    // 0.5*x*(1+tanh(sqrt(2/pi)*(x+0.044715*x^3)))
+                    return 0.5*$x*(1.0+tanh(0.7978845608028654*($x+0.044715*$x*$x*$x)));
+                };
+            }
+            case 'tanh': {
+                return 'tanh';
+            }
+            case 'sigmoid': {
+                return function(float $x) : float {
+                    // Never compute exp of a large positive value
+                    if($x>=0) {
+                        return 1.0 / (1.0 + exp(-$x));
+                    }
+                    $e = exp($x);
+                    return $e / (1.0 + $e);
+                };
+            }
+            default: {
+                throw new InvalidArgumentException("Unknown activation: {$name}");
+            }
+        }
+    }
+
+    protected function assert_epilogue_spec(
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $B, int $offsetB, int $ldB,
+        BufferInterface $C, int $offsetC, int $ldC ) : int
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("k", $k);
+        foreach(['A'=>$transA, 'B'=>$transB] as $name => $trans) {
+            if($trans!=BLASIF::NoTrans && $trans!=BLASIF::Trans) {
+                throw new InvalidArgumentException("unknown transpose mode for buffer{$name}.");
+            }
+        }
+        // Check Buffer A and B and C
+        if($transA==BLASIF::NoTrans) {
+            $this->assert_matrix_buffer_spec("A", $A, $m, $k, $offsetA, $ldA);
+        } else {
+            $this->assert_matrix_buffer_spec("A", $A, $k, $m, $offsetA, $ldA);
+        }
+        if($transB==BLASIF::NoTrans) {
+            $this->assert_matrix_buffer_spec("B", $B, $k, $n, $offsetB, $ldB);
+        } else {
+            $this->assert_matrix_buffer_spec("B", $B, $n, $k, $offsetB, $ldB);
+        }
+        $this->assert_matrix_buffer_spec("C", $C, $m, $n, $offsetC, $ldC);
+        $dtype = $C->dtype();
+        if($dtype!=$A->dtype() || $dtype!=$B->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for A and B and C");
+        }
+        $this->assert_dtype($dtype);
+        return $dtype;
+    }
+
+    protected function assert_axis_spec(
+        int $axis,
+        int $m,
+        int $n,
+        BufferInterface $A, int $offsetA, int $ldA,
+        BufferInterface $X, int $offsetX, int $incX ) : int
+    {
+        if($axis!=0 && $axis!=1) {
+            throw new InvalidArgumentException("Argument axis must be 0 or 1.");
+        }
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        // Check Buffer A
+        $this->assert_matrix_buffer_spec("A", $A, $m, $n, $offsetA, $ldA);
+        // Check Buffer X
+        $this->assert_vector_buffer_spec("X", $X, ($axis==0) ? $n : $m, $offsetX, $incX);
+        $dtype = $A->dtype();
+        if($dtype!=$X->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for A and X");
+        }
+        $this->assert_dtype($dtype);
+        return $dtype;
+    }
+
+    protected function assert_dtype(int $dtype) : void
+    {
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+    }
+
+    protected function assert_single_spec(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX ) : int
+    {
+        $this->assert_shape_parameter("n", $n);
+        // Check Buffer X
+        $this->assert_vector_buffer_spec("X", $X, $n, $offsetX, $incX);
+        $dtype = $X->dtype();
+        $this->assert_dtype($dtype);
+        return $dtype;
+    }
+
+    protected function assert_pair_spec(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX,
+        BufferInterface $Y, int $offsetY, int $incY ) : int
+    {
+        $dtype = $this->assert_single_spec($n, $X, $offsetX, $incX);
+        // Check Buffer Y
+        $this->assert_vector_buffer_spec("Y", $Y, $n, $offsetY, $incY);
+
+        // Check Buffer X and Y
+        if($dtype!=$Y->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for X and Y");
+        }
+        return $dtype;
+    }
+
+    /**
+     * Pointer to at least n ones.
+     */
+    protected function ones(int $n, int $dtype) : FFI\CData
+    {
+        return $this->onesCache->get($n, $dtype);
+    }
+
+    /**
+     *  X[i] := func(X[i])
+     */
+    protected function map(
+        int $n,
+        BufferInterface $X, int $offsetX, int $incX,
+        callable $func ) : void
+    {
+        if($incX!=1) {
+            for($i=0; $i<$n; $i++) {
+                $idx = $offsetX+$i*$incX;
+                $X[$idx] = $func($X[$idx]);
+            }
+            return;
+        }
+        for($i=0; $i<$n; $i+=self::CHUNK_SIZE) {
+            $count = min(self::CHUNK_SIZE, $n-$i);
+            $values = $this->readValues($X, $offsetX+$i, $count);
+            $this->writeValues($X, $offsetX+$i, array_map($func, $values));
+        }
+    }
+}
@@ -0,0 +1,170 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use InvalidArgumentException;
+use RuntimeException;
+use FFI;
+use FFI\Exception as FFIException;
+
+/**
+ * Allocates buffers for Blas with huge pages and a NUMA placement.
+ *
+ * A page lands on a NUMA node when it is first written. NUMA_INTERLEAVE
+ * spreads the pages over the nodes round-robin and NUMA_LOCAL keeps them
+ * on the node of the thread that touches them first. With firstTouch the
+ * buffer is zeroed by an OpenBLAS scal, so each OpenBLAS thread touches
+ * the part it will also work on in later level-1 and level-2 calls.
+ * NUMA policies are ignored where libnuma or NUMA support is missing.
+ */
+class MemoryAllocator
+{
+    const NUMA_DEFAULT = 0;
+    const NUMA_LOCAL = 1;
+    const NUMA_INTERLEAVE = 2;
+
+    // mbind(2)
+    protected const MPOL_INTERLEAVE = 3;
+    protected const MPOL_LOCAL = 4;
+
+    protected const LIBNUMA = 'libnuma.so.1';
+    protected const LIBNUMA_HEADER = <<<'EOT'
+int numa_available(void);
+int numa_max_node(void);
+long mbind(void *addr, unsigned long len, int mode, const unsigned long *nodemask, unsigned long maxnode, unsigned flags);
+EOT;
+
+    // false when libnuma is not available
+    protected static FFI|false|null $numa = null;
+
+    // the largest count of an LP64 blasint
+    protected const INT32_MAX = 2147483647;
+
+    protected FFI|SuffixedFFI $blas;
+    protected bool $ilp64;
+
+    /**
+     * ilp64 tells whether blasint is a 64-bit integer.
+     */
+    public function __construct(FFI|SuffixedFFI $blas, bool $ilp64=false)
+    {
+        $this->blas = $blas;
+        $this->ilp64 = $ilp64;
+    }
+
+    /**
+     * A zero-filled buffer of size elements of dtype.
+     *
+     * shared maps the memory with MAP_SHARED for ExecutionQueue.
+     *
+     * @param array<int>|null $nodes nodes to interleave over, all nodes when null
+     */
+    public function allocate(
+        int $size,
+        int $dtype=NDArray::float32,
+        int $hugePages=AnonymousBuffer::HUGEPAGES_NONE,
+        int $numaPolicy=self::NUMA_DEFAULT,
+        bool $firstTouch=false,
+        ?array $nodes=null,
+        bool $shared=false,
+        ) : AnonymousBuffer
+    {
+        if($numaPolicy!=self::NUMA_DEFAULT && $numaPolicy!=self::NUMA_LOCAL && $numaPolicy!=self::NUMA_INTERLEAVE) {
+            throw new InvalidArgumentException("unknown NUMA policy: {$numaPolicy}");
+        }
+        $buffer = new AnonymousBuffer($size, $dtype, $hugePages, $shared);
+        if($numaPolicy!=self::NUMA_DEFAULT) {
+            $this->bind($buffer, $numaPolicy, $nodes);
+        }
+        if($firstTouch) {
+            $this->touch($buffer);
+        }
+        return $buffer;
+    }
+
+    /**
+     * The number of NUMA nodes, 1 without NUMA support.
+     */
+    public function numaNodes() : int
+    {
+        $numa = static::numa();
+        if($numa===null) {
+            return 1;
+        }
+        return $numa->numa_max_node()+1;
+    }
+
+    protected static function numa() : ?FFI
+    {
+        if(self::$numa===null) {
+            self::$numa = false;
+            if(PHP_OS==='Linux') {
+                try {
+                    $numa = FFI::cdef(static::LIBNUMA_HEADER, static::LIBNUMA);
+                    if($numa->numa_available()>=0) {
+                        self::$numa = $numa;
+                    }
+                } catch(FFIException $e) {
+                    // libnuma is not installed
+                }
+            }
+        }
+        return self::$numa ?: null;
+    }
+
+    /**
+     * @param array<int>|null $nodes
+     */
+    protected function bind(AnonymousBuffer $buffer, int $policy, ?array $nodes) : void
+    {
+        $numa = static::numa();
+        if($numa===null) {
+            return;
+        }
+        $addr = $buffer->addr(0);
+        if($policy==self::NUMA_LOCAL) {
+            $result = $numa->mbind($addr, $buffer->mappedBytes(), self::MPOL_LOCAL, null, 0, 0);
+        } else {
+            $maxNode = $numa->numa_max_node();
+            $nodes ??= range(0, $maxNode);
+            $bits = PHP_INT_SIZE*8;
+            $words = intdiv($maxNode, $bits)+1;
+            $mask = $numa->new("unsigned long[{$words}]");
+            foreach($nodes as $node) {
+                if($node<0 || $node>$maxNode) {
+                    throw new InvalidArgumentException("NUMA node {$node} does not exist.");
+                }
+                $word = intdiv($node, $bits);
+                $mask[$word] = $mask[$word] | (1 << ($node % $bits));
+            }
+            // the kernel reads maxnode-1 bits
+            $result = $numa->mbind($addr, $buffer->mappedBytes(), self::MPOL_INTERLEAVE, $mask, $words*$bits+1, 0);
+        }
+        if($result!=0) {
+            throw new RuntimeException('mbind failed.');
+        }
+    }
+
+    /**
+     * Zero the whole mapping with OpenBLAS threads, in calls whose count
+     * fits in blasint.
+     */
+    protected function touch(AnonymousBuffer $buffer) : void
+    {
+        $addr = $buffer->addr(0);
+        $floats = $this->blas->cast('float*', $addr);
+        $count = intdiv($buffer->mappedBytes(), 4);
+        $chunk = $this->maxCount();
+        for($i=0; $i<$count; $i+=$chunk) {
+            $this->blas->cblas_sscal(min($chunk, $count-$i), 0.0, $floats+$i, 1);
+        }
+    }
+
+    /**
+     * The largest element count of one BLAS call.
+     */
+    protected function maxCount() : int
+    {
+        return $this->ilp64 ? PHP_INT_MAX : self::INT32_MAX;
+    }
+}
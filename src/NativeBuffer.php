@@ -0,0 +1,291 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+use InvalidArgumentException;
+use OutOfRangeException;
+use LogicException;
+use RuntimeException;
+use Traversable;
+use FFI;
+
+/**
+ * A LinearBuffer on memory mapped with mmap(2).
+ *
+ * addr() points into the mapping, which is unmapped by close() or when
+ * the buffer is destroyed.
+ */
+abstract class NativeBuffer implements BufferInterface
+{
+    // madvise(2)
+    const ADVICE_NORMAL = 0;
+    const ADVICE_RANDOM = 1;
+    const ADVICE_SEQUENTIAL = 2;
+    const ADVICE_WILLNEED = 3;
+    const ADVICE_DONTNEED = 4;
+
+    // mmap(2)
+    protected const PROT_READ = 1;
+    protected const PROT_WRITE = 2;
+    protected const MAP_SHARED = 1;
+    protected const MAP_PRIVATE = 2;
+
+    /**
+     * C type and size in bytes of each data type.
+     */
+    const TYPES = [
+        NDArray::bool       => ['uint8_t', 1],
+        NDArray::int8       => ['int8_t', 1],
+        NDArray::uint8      => ['uint8_t', 1],
+        NDArray::int16      => ['int16_t', 2],
+        NDArray::uint16     => ['uint16_t', 2],
+        NDArray::int32      => ['int32_t', 4],
+        NDArray::uint32     => ['uint32_t', 4],
+        NDArray::int64      => ['int64_t', 8],
+        NDArray::uint64     => ['uint64_t', 8],
+        NDArray::float32    => ['float', 4],
+        NDArray::float64    => ['double', 8],
+        NDArray::complex64  => ['mapped_complex_float', 8],
+        NDArray::complex128 => ['mapped_complex_double', 16],
+    ];
+
+    protected const LIBC = [
+        'Linux' => 'libc.so.6',
+        'Darwin' => 'libSystem.B.dylib',
+    ];
+
+    protected const LIBC_HEADER = <<<'EOT'
+typedef struct { float real; float imag; } mapped_complex_float;
+typedef struct { double real; double imag; } mapped_complex_double;
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, int64_t offset);
+int munmap(void *addr, size_t length);
+int madvise(void *addr, size_t length, int advice);
+int open(const char *pathname, int flags, ...);
+int close(int fd);
+int getpagesize(void);
+EOT;
+
+    protected static ?FFI $libc = null;
+
+    protected int $dtype;
+    protected int $size;
+    protected int $valueSize;
+    protected bool $writable;
+    protected bool $shared = false;
+    protected ?FFI\CData $mapping = null;
+    protected int $mappingSize;
+    // bytes from the start of the mapping to the first element
+    protected int $dataOffset;
+    protected FFI\CData $data;
+
+    public function __destruct()
+    {
+        $this->close();
+    }
+
+    protected static function libc() : FFI
+    {
+        if(self::$libc===null) {
+            $lib = static::LIBC[PHP_OS] ?? null;
+            if($lib===null) {
+                throw new RuntimeException('Memory mapping is not supported on '.PHP_OS.'.');
+            }
+            self::$libc = FFI::cdef(static::LIBC_HEADER, $lib);
+        }
+        return self::$libc;
+    }
+
+    /**
+     * The value size of dtype, or an exception for an unsupported dtype.
+     */
+    protected static function valueSizeOf(int $dtype) : int
+    {
+        if(!isset(self::TYPES[$dtype])) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        return self::TYPES[$dtype][1];
+    }
+
+    /**
+     * Use size elements of dtype at dataOffset bytes into a mapping.
+     */
+    protected function attach(
+        FFI\CData $mapping, int $mappingSize, int $dataOffset,
+        int $dtype, int $size, bool $writable, bool $shared=false) : void
+    {
+        $libc = static::libc();
+        $this->mapping = $mapping;
+        $this->mappingSize = $mappingSize;
+        $this->dataOffset = $dataOffset;
+        $this->data = $libc->cast(self::TYPES[$dtype][0].'*', $libc->cast('char*', $mapping)+$dataOffset);
+        $this->dtype = $dtype;
+        $this->size = $size;
+        $this->valueSize = self::TYPES[$dtype][1];
+        $this->writable = $writable;
+        $this->shared = $shared;
+    }
+
+    protected static function isMapFailed(FFI\CData $mapping) : bool
+    {
+        return static::libc()->cast('intptr_t', $mapping)->cdata==-1;
+    }
+
+    /**
+     * Unmap the memory. The buffer cannot be used any more.
+     */
+    public function close() : void
+    {
+        if($this->mapping===null) {
+            return;
+        }
+        static::libc()->munmap($this->mapping, $this->mappingSize);
+        $this->mapping = null;
+    }
+
+    /**
+     * Give the kernel an ADVICE_* hint for count elements from offset,
+     * e.g. ADVICE_WILLNEED for the data used next.
+     */
+    public function advise(int $advice, int $offset=0, ?int $count=null) : void
+    {
+        $this->assertMapped();
+        $count ??= $this->size-$offset;
+        if($offset<0 || $count<0 || $offset+$count>$this->size) {
+            throw new OutOfRangeException('Range is out of the buffer.');
+        }
+        if($count==0) {
+            return;
+        }
+        $start = $this->dataOffset + $offset*$this->valueSize;
+        $this->adviseBytes($advice, $start, $count*$this->valueSize);
+    }
+
+    /**
+     * madvise a byte range of the mapping, widened to whole pages.
+     */
+    protected function adviseBytes(int $advice, int $start, int $bytes) : void
+    {
+        $libc = static::libc();
+        $alignedStart = $start - $start % $libc->getpagesize();
+        $base = $libc->cast('char*', $this->mapping);
+        if($libc->madvise($base+$alignedStart, $start+$bytes-$alignedStart, $advice)!=0) {
+            throw new RuntimeException("madvise failed for advice {$advice}.");
+        }
+    }
+
+    protected function assertMapped() : void
+    {
+        if($this->mapping===null) {
+            throw new LogicException('The buffer is closed.');
+        }
+    }
+
+    protected function assertWritable() : void
+    {
+        $this->assertMapped();
+        if(!$this->writable) {
+            throw new LogicException('The buffer is read-only.');
+        }
+    }
+
+    protected function assertOffset(mixed $offset) : void
+    {
+        if(!is_int($offset) || $offset<0 || $offset>=$this->size) {
+            throw new OutOfRangeException('Index is out of range');
+        }
+    }
+
+    public function offsetExists(mixed $offset) : bool
+    {
+        return is_int($offset) && $offset>=0 && $offset<$this->size;
+    }
+
+    public function offsetGet(mixed $offset) : mixed
+    {
+        $this->assertMapped();
+        $this->assertOffset($offset);
+        $value = $this->data[$offset];
+        if($this->dtype==NDArray::bool) {
+            return (bool)$value;
+        }
+        return $value;
+    }
+
+    public function offsetSet(mixed $offset, mixed $value) : void
+    {
+        $this->assertWritable();
+        $this->assertOffset($offset);
+        if($this->dtype==NDArray::complex64 || $this->dtype==NDArray::complex128) {
+            $this->data[$offset]->real = $value->real;
+            $this->data[$offset]->imag = $value->imag;
+            return;
+        }
+        $this->data[$offset] = $value;
+    }
+
+    public function offsetUnset(mixed $offset) : void
+    {
+        throw new LogicException('Illegal Operation');
+    }
+
+    public function count() : int
+    {
+        return $this->size;
+    }
+
+    public function getIterator() : Traversable
+    {
+        for($i=0; $i<$this->size; $i++) {
+            yield $i => $this->offsetGet($i);
+        }
+    }
+
+    public function isWritable() : bool
+    {
+        return $this->writable;
+    }
+
+    /**
+     * Whether the mapping is MAP_SHARED, so that writes made by a forked
+     * process such as the worker of ExecutionQueue are seen here.
+     */
+    public function isShared() : bool
+    {
+        return $this->shared;
+    }
+
+    public function dtype() : int
+    {
+        return $this->dtype;
+    }
+
+    public function value_size() : int
+    {
+        return $this->valueSize;
+    }
+
+    public function addr(int $offset) : FFI\CData
+    {
+        $this->assertMapped();
+        return $this->data+$offset;
+    }
+
+    public function dump() : string
+    {
+        $this->assertMapped();
+        return FFI::string($this->data, $this->size*$this->valueSize);
+    }
+
+    public function load(string $string) : void
+    {
+        $this->assertWritable();
+        $bytes = strlen($string);
+        if($bytes!=$this->size*$this->valueSize) {
+            throw new InvalidArgumentException('Unmatch data size. buffer size is '.
+                ($this->size*$this->valueSize).'. '.$bytes.' byte given.');
+        }
+        $data = $this->data;
+        FFI::memcpy($data, $string, $bytes);
+    }
+}
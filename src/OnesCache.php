@@ -0,0 +1,67 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use InvalidArgumentException;
+use FFI;
+
+/**
+ * Cache-line aligned vectors of ones for sums and broadcasts as BLAS products.
+ *
+ * One vector is kept for each of float32 and float64 and grows by doubling,
+ * so a long-running process holds at most twice the longest vector it used.
+ * The factory shares one cache between Blas and Math.
+ */
+class OnesCache
+{
+    const ALIGNMENT = 64;
+
+    protected FFI|SuffixedFFI $ffi;
+    /** @var array<int,FFI\CData> $ones aligned pointer per dtype */
+    protected array $ones = [];
+    /** @var array<int,FFI\CData> $storage */
+    protected array $storage = [];
+    /** @var array<int,int> $size */
+    protected array $size = [];
+
+    public function __construct(FFI|SuffixedFFI $ffi)
+    {
+        $this->ffi = $ffi;
+    }
+
+    /**
+     * Pointer to at least n ones of dtype aligned to ALIGNMENT bytes.
+     * It is valid until the next get() of the same dtype with a larger n.
+     */
+    public function get(int $n, int $dtype) : FFI\CData
+    {
+        if(($this->size[$dtype] ?? 0) >= $n) {
+            return $this->ones[$dtype];
+        }
+        [$type, $format, $elementSize] = match($dtype) {
+            NDArray::float32 => ['float', 'f', 4],
+            NDArray::float64 => ['double', 'd', 8],
+            default => throw new InvalidArgumentException('Unsuppored data type'),
+        };
+        $size = max($n, 2*($this->size[$dtype] ?? 0));
+        $padding = intdiv(self::ALIGNMENT, $elementSize);
+        $storage = $this->ffi->new("{$type}[".($size+$padding)."]");
+        $address = $this->ffi->cast('uintptr_t', FFI::addr($storage[0]))->cdata;
+        $skip = intdiv((self::ALIGNMENT - $address % self::ALIGNMENT) % self::ALIGNMENT, $elementSize);
+        $ones = FFI::addr($storage[$skip]);
+        $data = str_repeat(pack($format, 1.0), $size);
+        FFI::memcpy($ones, $data, strlen($data));
+        $this->storage[$dtype] = $storage;
+        $this->ones[$dtype] = $ones;
+        $this->size[$dtype] = $size;
+        return $ones;
+    }
+
+    /**
+     * Number of ones cached for dtype.
+     */
+    public function size(int $dtype) : int
+    {
+        return $this->size[$dtype] ?? 0;
+    }
+}
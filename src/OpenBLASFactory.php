@@ -7,19 +7,76 @@ use FFI;
 //use FFI\Location\Locator as FFIEnvLocator;
 use FFI\Exception as FFIException;
 use RuntimeException;
+use InvalidArgumentException;
 
 class OpenBLASFactory
 {
-    private static ?FFI $ffi = null;
-    private static ?FFI $ffiLapacke = null;
-    private static ?FFI $ffiLapack = null;
+    /**
+     * Routines reported by capabilities(), keyed by capability name.
+     */
+    const CAPABILITY_SYMBOLS = [
+        'openblas'           => 'openblas_get_config',  // OpenBLAS extensions such as ConjNoTrans
+        'iamin'              => 'cblas_isamin',
+        'omatcopy'           => 'cblas_somatcopy',
+        'imatcopy'           => 'cblas_simatcopy',
+        'geadd'              => 'cblas_sgeadd',
+        'axpby'              => 'cblas_saxpby',
+        'cdotu'              => 'cblas_cdotu',          // complex dot products returned by value
+        'crotg'              => 'cblas_crotg',
+        'gemm3m'             => 'cblas_cgemm3m',
+        'gemmt'              => 'cblas_sgemmt',
+        'bf16'               => 'cblas_sbgemm',
+        'gemm_batch'         => 'cblas_sgemm_batch',
+        'gemm_batch_strided' => 'cblas_sgemm_batch_strided',
+    ];
+    // The name of the function in a declaration line.
+    // Continuation lines of a declaration never reach a "(" before its ";".
+    const DECLARATION_PATTERN = '/^(?!\s*(?:typedef|#|\/))([^;(]*?\b)([A-Za-z_]\w*)(\s*\()/m';
+    /**
+     * Threading variants of OpenBLAS selectable on Linux.
+     */
+    const THREADING_PROFILES = ['serial', 'pthread', 'openmp'];
+    /**
+     * Components loaded together on first use, keyed by the component that names the group.
+     */
+    const COMPONENT_GROUPS = [
+        'blas' => ['blas', 'blas_ext', 'gemm_batch', 'gemm_batch_strided'],
+        'lapacke' => ['lapacke'],
+        'lapack' => ['lapack'],
+    ];
+
+    private static FFI|SuffixedFFI|null $ffi = null;
+    private static FFI|SuffixedFFI|null $ffiLapacke = null;
+    private static FFI|SuffixedFFI|null $ffiLapack = null;
+    private static FFI|SuffixedFFI|null $ffiGemmBatch = null;
+    private static FFI|SuffixedFFI|null $ffiGemmBatchStrided = null;
+    private static bool $ilp64 = false;
+    /** @var array<string,bool> $capabilities */
+    private static array $capabilities = [];
+    /** @var array<string,array<string,mixed>>|null $config */
+    private static ?array $config = null;
+    private static bool $configResolved = false;
+    /** @var array<string,array{loaded:bool,seconds:float,errors:array<string>}> $loadStatus */
+    private static array $loadStatus = [];
+    private static ?string $profilePath = null;
+    private static ?PerformanceProfile $profile = null;
+    private static bool $profileRead = false;
+    private static ?ScratchPool $scratchPool = null;
+    private static ?OnesCache $onesCache = null;
     /** @var array<string,array<string,array<string,mixed>>> $configMatrix */
     protected array $configMatrix = [
         'WINNT' => [
             'blas' => [
                 'header' => __DIR__.'/openblas_win.h',
                 'libs' => ['libopenblas.dll'],
-            ],  
+                'probe' => true,
+            ],
+            'blas_ext' => [
+                'header' => __DIR__ . '/openblas_ext.h',
+                'libs' => ['libopenblas.dll'],
+                'optional' => true,
+                'probe' => true,
+            ],
             'lapacke' => [
                 'header' => __DIR__ . '/lapacke.h',
                 'libs' => ['libopenblas.dll'],
@@ -28,11 +85,28 @@ class OpenBLASFactory
                 'header' => __DIR__ . '/lapack.h',
                 'libs' => ['libopenblas.dll'],
             ],
+            'gemm_batch' => [
+                'header' => __DIR__ . '/openblas_gemm_batch.h',
+                'libs' => ['libopenblas.dll'],
+                'optional' => true,
+            ],
+            'gemm_batch_strided' => [
+                'header' => __DIR__ . '/openblas_gemm_batch_strided.h',
+                'libs' => ['libopenblas.dll'],
+                'optional' => true,
+            ],
         ],
         'Linux' => [
             'blas' => [
                 'header' => __DIR__.'/openblas.h',
                 'libs' => ['libopenblas.so.0'],
+                'probe' => true,
+            ],
+            'blas_ext' => [
+                'header' => __DIR__ . '/openblas_ext.h',
+                'libs' => ['libopenblas.so.0'],
+                'optional' => true,
+                'probe' => true,
             ],
             'lapacke' => [
                 'header' => __DIR__ . '/lapacke.h',
@@ -40,15 +114,30 @@ class OpenBLASFactory
             ],
             'lapack' => [
                 'header' => __DIR__ . '/lapack.h',
-                //'libs' => ['/usr/lib/x86_64-linux-gnu/openblas-pthread/liblapack.so.3'],
-                //'libs' => ['/usr/lib/x86_64-linux-gnu/openblas-openmp/liblapack.so.3'],
+                // See threadingProfileLibs() for the variant specific libraries.
                 'libs' => ['liblapack.so.3'],
             ],
+            'gemm_batch' => [
+                'header' => __DIR__ . '/openblas_gemm_batch.h',
+                'libs' => ['libopenblas.so.0'],
+                'optional' => true,
+            ],
+            'gemm_batch_strided' => [
+                'header' => __DIR__ . '/openblas_gemm_batch_strided.h',
+                'libs' => ['libopenblas.so.0'],
+                'optional' => true,
+            ],
         ],
         'Darwin' => [
             'blas' => [
                 'header' => __DIR__.'/cblas_new_vecLib.h',
                 'libs' => ['/System/Library/Frameworks/Accelerate.framework/Versions/Current/Frameworks/vecLib.framework/vecLib'],
+                'ilp64' => false,
+                'suffix' => '',
+            ],
+            'blas_ext' => [
+                'header' => null,
+                'libs' => null,
             ],
             'lapacke' => [
                 'header' => null,
@@ -58,12 +147,40 @@ class OpenBLASFactory
                 'header' => __DIR__ . '/clapack_vecLib.h',
                 'libs' => ['/System/Library/Frameworks/Accelerate.framework/Versions/Current/Frameworks/vecLib.framework/vecLib'],
             ],
+            'gemm_batch' => [
+                'header' => null,
+                'libs' => null,
+            ],
+            'gemm_batch_strided' => [
+                'header' => null,
+                'libs' => null,
+            ],
         ],
     ];
     /** @var array<string> $errors */
     private array $errors = [];
+    /** @var array<string,string> $loadedCodes */
+    private array $loadedCodes = [];
 
     /**
+     * ilp64 selects 64-bit integers for blasint and lapack_int, and
+     * symbolSuffix is the suffix of the exported symbols (e.g. "64_" for
+     * libopenblas64_.so). Both are detected from the blas library when null.
+     *
+     * Nothing is loaded here. Each library is loaded on the first call of
+     * Blas(), Lapack() or Lapackb() that needs it.
+     *
+     * threading selects one of THREADING_PROFILES on Linux without changing
+     * the system alternatives. It defaults to the RINDOW_OPENBLAS_THREADING
+     * environment variable, and explicitly given libraries take precedence.
+     * An unknown name in the variable is reported by errors() instead of thrown.
+     *
+     * profilePath is the file written by bin/rindow-openblas-autotune. When
+     * null, the RINDOW_OPENBLAS_PROFILE environment variable names it, and
+     * without either no profile is read. Pass PerformanceProfile::defaultPath()
+     * to use the autotuner's default file. The entry matching the loaded
+     * library is applied when blas is loaded.
+     *
      * @param array<string> $libFiles
      * @param array<string> $lapackeLibs
      */
@@ -72,27 +189,168 @@ class OpenBLASFactory
         ?array $libFiles=null,
         ?string $lapackeHeader=null,
         ?array $lapackeLibs=null,
+        ?bool $ilp64=null,
+        ?string $symbolSuffix=null,
+        ?string $threading=null,
+        ?string $profilePath=null,
         )
     {
-        if(self::$ffi!==null) {
+        if(self::$config!==null) {
             return;
         }
         if(!extension_loaded('ffi')) {
             return;
         }
 
-        $config = $this->generateConfig([
+        $profilePath ??= (getenv('RINDOW_OPENBLAS_PROFILE') ?: null);
+        self::$profilePath = ($profilePath!=='') ? $profilePath : null;
+        $lapackLibs = null;
+        if(PHP_OS==='Linux') {
+            $threading ??= $this->threadingFromEnvironment();
+        }
+        if($threading!==null && PHP_OS==='Linux') {
+            $profile = $this->threadingProfileLibs($threading, $ilp64, $symbolSuffix);
+            $libFiles ??= $profile['blas'];
+            $lapackeLibs ??= $profile['lapacke'];
+            $lapackLibs = $profile['lapack'];
+        }
+
+        self::$config = $this->generateConfig([
             'blas' => [
                 'header' => $headerFile,
                 'libs' => $libFiles,
+                'ilp64' => $ilp64,
+                'suffix' => $symbolSuffix,
             ],
             'lapacke' => [
                 'header' => $lapackeHeader,
                 'libs' => $lapackeLibs,
+                'explicit' => $lapackeLibs!==null,
+            ],
+            'lapack' => [
+                'libs' => $lapackLibs,
+            ],
+            // Optional extensions are looked up in the same library as blas.
+            'blas_ext' => [
+                'libs' => $libFiles,
+            ],
+            'gemm_batch' => [
+                'libs' => $libFiles,
+            ],
+            'gemm_batch_strided' => [
+                'libs' => $libFiles,
             ],
-            'lapack' => [],
         ]);
-        $drivers = $this->loadLibraries($config);
+    }
+
+    /**
+     * The threading profile named by RINDOW_OPENBLAS_THREADING.
+     * An unknown name is reported by errors() and ignored.
+     */
+    protected function threadingFromEnvironment() : ?string
+    {
+        $threading = getenv('RINDOW_OPENBLAS_THREADING');
+        if($threading===false || $threading==='') {
+            return null;
+        }
+        if(!in_array($threading, self::THREADING_PROFILES, true)) {
+            self::$loadStatus['threading'] = [
+                'loaded' => false,
+                'seconds' => 0.0,
+                'errors' => ['Unknown threading profile in RINDOW_OPENBLAS_THREADING: "'.$threading.'"'],
+            ];
+            return null;
+        }
+        return $threading;
+    }
+
+    /**
+     * Candidate libraries of a threading variant.
+     * Debian keeps each variant in its own directory, RHEL and Fedora in
+     * differently named libraries that also contain LAPACK.
+     *
+     * @return array{blas:array<string>,lapacke:array<string>,lapack:array<string>}
+     */
+    protected function threadingProfileLibs(
+        string $profile, ?bool $ilp64, ?string $suffix, ?string $arch=null) : array
+    {
+        if(!in_array($profile, self::THREADING_PROFILES, true)) {
+            throw new InvalidArgumentException('Unknown threading profile: "'.$profile.'"');
+        }
+        $arch ??= php_uname('m');
+        $multiarch = match($arch) {
+            'x86_64', 'amd64' => 'x86_64-linux-gnu',
+            'aarch64', 'arm64' => 'aarch64-linux-gnu',
+            'ppc64le' => 'powerpc64le-linux-gnu',
+            default => $arch.'-linux-gnu',
+        };
+        $rhel = match($profile) {
+            'serial' => 'libopenblas',
+            'pthread' => 'libopenblasp',
+            'openmp' => 'libopenblaso',
+        };
+        if($ilp64) {
+            $debian = "/usr/lib/{$multiarch}/openblas64-{$profile}";
+            $blas = [
+                "{$debian}/libopenblas64.so.0",
+                // Fedora names the suffixed build libopenblas64_.so and the other libopenblas64.so
+                "/usr/lib64/{$rhel}".(($suffix ?? '')!=='' ? $suffix : '64').".so.0",
+            ];
+            $lapack = ["{$debian}/liblapack64.so.3"];
+        } else {
+            $debian = "/usr/lib/{$multiarch}/openblas-{$profile}";
+            $blas = [
+                "{$debian}/libopenblas.so.0",
+                "/usr/lib64/{$rhel}.so.0",
+            ];
+            $lapack = ["{$debian}/liblapack.so.3"];
+        }
+        return [
+            'blas' => $blas,
+            'lapacke' => array_merge($blas, ['liblapacke.so.3']),
+            'lapack' => array_merge($lapack, $blas),
+        ];
+    }
+
+    /**
+     * The configuration with the integer model of the blas library filled in.
+     *
+     * @return array<string,array<string,mixed>>
+     */
+    protected function resolvedConfig() : array
+    {
+        if(self::$config===null) {
+            return [];
+        }
+        if(self::$configResolved) {
+            return self::$config;
+        }
+        $config = $this->resolveIntegerModel(self::$config);
+        if($config['blas']['ilp64'] && !($config['lapacke']['explicit'] ?? false)) {
+            // The default LAPACK libraries are LP64 builds.
+            // ILP64 builds of OpenBLAS bundle their own LAPACK and LAPACKE.
+            $config['lapacke']['libs'] = $config['blas']['libs'];
+            $config['lapack']['libs'] = $config['blas']['libs'];
+        }
+        self::$ilp64 = (bool)$config['blas']['ilp64'];
+        self::$config = $config;
+        self::$configResolved = true;
+        return $config;
+    }
+
+    /**
+     * Load a component group unless it was already tried.
+     */
+    protected function load(string $group) : void
+    {
+        if(self::$config===null || isset(self::$loadStatus[$group])) {
+            return;
+        }
+        $start = hrtime(true);
+        $config = $this->resolvedConfig();
+        $params = array_intersect_key($config, array_flip(self::COMPONENT_GROUPS[$group]));
+        $this->errors = [];
+        $drivers = $this->loadLibraries($params);
         if(isset($drivers['blas'])) {
             self::$ffi = $drivers['blas'];
         }
@@ -102,6 +360,124 @@ class OpenBLASFactory
         if(isset($drivers['lapack'])) {
             self::$ffiLapack = $drivers['lapack'];
         }
+        if(isset($drivers['gemm_batch'])) {
+            self::$ffiGemmBatch = $drivers['gemm_batch'];
+        }
+        if(isset($drivers['gemm_batch_strided'])) {
+            self::$ffiGemmBatchStrided = $drivers['gemm_batch_strided'];
+        }
+        if($group=='blas') {
+            self::$capabilities = $this->probeCapabilities($config['blas']['suffix'] ?? '');
+            if(self::$ffi!==null) {
+                $this->applyProfile(self::$ffi);
+            }
+        }
+        self::$loadStatus[$group] = [
+            'loaded' => isset($drivers[$group]),
+            'seconds' => (hrtime(true)-$start)/1e9,
+            'errors' => $this->errors,
+        ];
+    }
+
+    /**
+     * Apply the profile to the loaded OpenBLAS.
+     */
+    protected function applyProfile(FFI|SuffixedFFI $ffi) : void
+    {
+        $profile = $this->readProfile();
+        if($profile===null) {
+            return;
+        }
+        $numThreads = $profile->getInt('num_threads');
+        if($numThreads>0) {
+            $ffi->openblas_set_num_threads($numThreads);
+        }
+    }
+
+    /**
+     * Read the profile of the OpenBLAS build once. Its key is taken from the
+     * loaded blas library, or else from a handle with only the two
+     * identification routines, so that LAPACK can consult the profile
+     * without loading blas.
+     */
+    protected function readProfile() : ?PerformanceProfile
+    {
+        if(self::$profileRead) {
+            return self::$profile;
+        }
+        self::$profileRead = true;
+        if(self::$profilePath===null) {
+            return null;
+        }
+        $start = hrtime(true);
+        $errors = [];
+        $key = $this->profileKey();
+        if($key!==null) {
+            try {
+                self::$profile = PerformanceProfile::load(self::$profilePath, $key);
+            } catch(RuntimeException $e) {
+                $errors[] = $e->getMessage();
+            }
+        }
+        self::$loadStatus['profile'] = [
+            'loaded' => self::$profile!==null,
+            'seconds' => (hrtime(true)-$start)/1e9,
+            'errors' => $errors,
+        ];
+        return self::$profile;
+    }
+
+    /**
+     * PerformanceProfile::key() of the blas library, or null when it is not OpenBLAS.
+     */
+    protected function profileKey() : ?string
+    {
+        if(self::$ffi!==null) {
+            if(!(self::$capabilities['openblas'] ?? false)) {
+                return null;
+            }
+            return PerformanceProfile::key(
+                FFI::string(self::$ffi->openblas_get_corename()),
+                FFI::string(self::$ffi->openblas_get_config()),
+            );
+        }
+        $config = $this->resolvedConfig();
+        $suffix = $config['blas']['suffix'] ?? '';
+        foreach($config['blas']['libs'] ?? [] as $filename) {
+            try {
+                $ffi = FFI::cdef(
+                    "char* openblas_get_corename{$suffix}(void);\n".
+                    "char* openblas_get_config{$suffix}(void);",
+                    $filename);
+            } catch(FFIException $e) {
+                continue;
+            }
+            return PerformanceProfile::key(
+                FFI::string($ffi->{"openblas_get_corename{$suffix}"}()),
+                FFI::string($ffi->{"openblas_get_config{$suffix}"}()),
+            );
+        }
+        return null;
+    }
+
+    /**
+     * The profile of the OpenBLAS build, or the defaults when there is none.
+     * Reading it does not load blas.
+     */
+    public function profile() : PerformanceProfile
+    {
+        return $this->readProfile() ?? new PerformanceProfile();
+    }
+
+    /**
+     * The outcome of every component group tried so far: whether it loaded,
+     * how many seconds the loading took and the errors raised.
+     *
+     * @return array<string,array{loaded:bool,seconds:float,errors:array<string>}>
+     */
+    public function loadStatus() : array
+    {
+        return self::$loadStatus;
     }
 
     /**
@@ -109,7 +485,11 @@ class OpenBLASFactory
      */
     public function errors() : array
     {
-        return $this->errors;
+        $errors = [];
+        foreach(self::$loadStatus as $status) {
+            $errors = array_merge($errors, $status['errors']);
+        }
+        return $errors;
     }
 
     /**
@@ -131,6 +511,139 @@ class OpenBLASFactory
         return $params;
     }
 
+    /**
+     * Fill in the integer model of the blas library and apply it to all components.
+     *
+     * @param  array<string,array<string,mixed>> $params
+     * @return array<string,array<string,mixed>>
+     */
+    protected function resolveIntegerModel(array $params) : array
+    {
+        $ilp64 = $params['blas']['ilp64'] ?? null;
+        $suffix = $params['blas']['suffix'] ?? null;
+        if(($ilp64===null || $suffix===null) && isset($params['blas']['libs'])) {
+            [$detectedIlp64, $detectedSuffix] = $this->detectIntegerModel($params['blas']['libs']);
+            $ilp64 ??= $detectedIlp64;
+            $suffix ??= $detectedSuffix;
+        }
+        $ilp64 ??= false;
+        $suffix ??= '';
+        foreach($params as $key => $param) {
+            $params[$key]['ilp64'] = $ilp64;
+            $params[$key]['suffix'] = $suffix;
+        }
+        return $params;
+    }
+
+    /**
+     * Ask the first loadable OpenBLAS library how it was built.
+     *
+     * @param  array<string> $libs
+     * @return array{?bool,?string}
+     */
+    protected function detectIntegerModel(array $libs) : array
+    {
+        foreach($libs as $filename) {
+            foreach(['', '64_'] as $suffix) {
+                try {
+                    $ffi = FFI::cdef("char* openblas_get_config{$suffix}(void);", $filename);
+                } catch(FFIException $e) {
+                    continue;
+                }
+                $config = FFI::string($ffi->{"openblas_get_config{$suffix}"}());
+                return [str_contains($config, 'USE64BITINT'), $suffix];
+            }
+        }
+        return [null, null];
+    }
+
+    /**
+     * Rewrite a header for the integer model and symbol suffix of the library.
+     */
+    protected function adaptHeader(string $code, bool $ilp64, string $suffix) : string
+    {
+        if($ilp64) {
+            $code = preg_replace(
+                '/^typedef\s+int32_t(\s+)(blasint|lapack_int);/m',
+                'typedef int64_t$1$2;',
+                $code) ?? $code;
+        }
+        if($suffix!=='') {
+            // Rename the function in every declaration.
+            $code = preg_replace(
+                self::DECLARATION_PATTERN,
+                '${1}${2}'.$suffix.'${3}',
+                $code) ?? $code;
+        }
+        return $code;
+    }
+
+    /**
+     * @return array<string>
+     */
+    protected function declaredFunctions(string $code) : array
+    {
+        preg_match_all(self::DECLARATION_PATTERN, $code, $matches);
+        return $matches[2];
+    }
+
+    protected function hasSymbol(string $filename, string $name) : bool
+    {
+        try {
+            FFI::cdef("void {$name}(void);", $filename);
+        } catch(FFIException $e) {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Remove the functions that the library does not export from a header.
+     * Returns null when nothing is left to load.
+     */
+    protected function removeMissingFunctions(string $code, string $filename) : ?string
+    {
+        $missing = [];
+        foreach($this->declaredFunctions($code) as $name) {
+            if(!$this->hasSymbol($filename, $name)) {
+                $missing[] = $name;
+            }
+        }
+        if(count($missing)==0) {
+            // The failure has another cause.
+            return null;
+        }
+        foreach($missing as $name) {
+            $code = preg_replace(
+                '/^(?!\s*(?:typedef|#|\/))[^;(]*?\b'.preg_quote($name, '/').'\s*\([^;]*;/m',
+                '',
+                $code) ?? $code;
+        }
+        if(count($this->declaredFunctions($code))==0) {
+            return null;
+        }
+        return $code;
+    }
+
+    /**
+     * @return array<string,bool>
+     */
+    protected function probeCapabilities(string $suffix) : array
+    {
+        $declared = [];
+        foreach(['blas', 'blas_ext', 'gemm_batch', 'gemm_batch_strided'] as $key) {
+            if(isset($this->loadedCodes[$key])) {
+                $declared = array_merge($declared, $this->declaredFunctions($this->loadedCodes[$key]));
+            }
+        }
+        $declared = array_flip($declared);
+        $capabilities = [];
+        foreach(self::CAPABILITY_SYMBOLS as $name => $symbol) {
+            $capabilities[$name] = isset($declared[$symbol.$suffix]);
+        }
+        return $capabilities;
+    }
+
     /**
      * @param array<array<mixed>> $params
      * @return array<mixed>
@@ -146,23 +659,48 @@ class OpenBLASFactory
             if($code===false) {
                 throw new RuntimeException('The header file not found: "'.$param['header'].'"');
             }
+            $suffix = $param['suffix'] ?? '';
+            $code = $this->adaptHeader($code, $param['ilp64'] ?? false, $suffix);
+            $errors = [];
             foreach($param['libs'] as $filename) {
                 $ffi = null;
                 try {
                     $ffi = FFI::cdef($code,$filename);
                 } catch(FFIException $e) {
-                    $this->errors[] = $e->getMessage();
-                    continue;
+                    // Older or reduced builds do not export every routine.
+                    // Load whatever they do export and report the rest through capabilities().
+                    if($param['probe'] ?? false) {
+                        $available = $this->removeMissingFunctions($code, $filename);
+                        if($available!==null) {
+                            try {
+                                $ffi = FFI::cdef($available,$filename);
+                                $code = $available;
+                            } catch(FFIException $e) {
+                                $ffi = null;
+                            }
+                        }
+                    }
+                    if($ffi===null) {
+                        $errors[] = $e->getMessage();
+                        continue;
+                    }
                 }
-                $ffis[$key] = $ffi;
+                $ffis[$key] = ($suffix!=='') ? new SuffixedFFI($ffi, $suffix) : $ffi;
+                $this->loadedCodes[$key] = $code;
+                $errors = [];
                 break;
             }
+            // Optional extensions are simply not available in older libraries.
+            if(!($param['optional'] ?? false)) {
+                $this->errors = array_merge($this->errors, $errors);
+            }
         }
         return $ffis;
     }
 
     public function isAvailable() : bool
     {
+        $this->load('blas');
         return self::$ffi!==null;
         //$isAvailable = FFIEnvRuntime::isAvailable();
         //if(!$isAvailable) {
@@ -172,19 +710,183 @@ class OpenBLASFactory
         //return $pathname!==null;
     }
 
+    /**
+     * Whether blasint and lapack_int are 64-bit integers.
+     */
+    public function isIlp64() : bool
+    {
+        $this->resolvedConfig();
+        return self::$ilp64;
+    }
+
+    /**
+     * Routines that the loaded blas library exports, keyed by the names of CAPABILITY_SYMBOLS.
+     *
+     * @return array<string,bool>
+     */
+    public function capabilities() : array
+    {
+        $this->load('blas');
+        return self::$capabilities;
+    }
+
+    /**
+     * The ones vectors shared by Blas and Math.
+     */
+    protected function onesCache() : OnesCache
+    {
+        self::$onesCache ??= new OnesCache(self::$ffi);
+        return self::$onesCache;
+    }
+
     public function Blas() : Blas
     {
+        $this->load('blas');
         if(self::$ffi==null) {
             throw new RuntimeException('openblas library not loaded.');
         }
-        return new Blas(self::$ffi);
+        return new Blas(
+            self::$ffi, self::$ffiGemmBatch, self::$ffiGemmBatchStrided,
+            self::$capabilities, self::$profile, $this->onesCache());
+    }
+
+    /**
+     * Blas that records scal, axpy, axpby, copy, gemv and gemm and fuses them on flush().
+     */
+    public function DeferredBlas() : DeferredBlas
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new DeferredBlas(
+            self::$ffi, self::$ffiGemmBatch, self::$ffiGemmBatchStrided,
+            self::$capabilities, self::$profile, $this->onesCache());
+    }
+
+    /**
+     * Blas that writes each call with its shapes and time to the tracer.
+     */
+    public function TracedBlas(CallTracer $tracer) : TracedBlas
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new TracedBlas(
+            $tracer,
+            self::$ffi, self::$ffiGemmBatch, self::$ffiGemmBatchStrided,
+            self::$capabilities, self::$profile, $this->onesCache());
+    }
+
+    /**
+     * Elementwise functions and reductions that are not part of BLAS.
+     */
+    public function Math() : Math
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new Math(self::$ffi, $this->onesCache());
+    }
+
+    /**
+     * im2col, col2im and convolution by gemm.
+     */
+    public function Convolution() : Convolution
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new Convolution(self::$ffi);
+    }
+
+    /**
+     * Products of CSR and CSC sparse matrices.
+     */
+    public function Sparse() : Sparse
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new Sparse(self::$ffi);
+    }
+
+    /**
+     * GEMM on matrices in files, tiled to fit the memory budget in bytes.
+     */
+    public function OutOfCoreGemm(?int $memoryBudget=null) : OutOfCoreGemm
+    {
+        return new OutOfCoreGemm($this->Blas(), $memoryBudget ?? OutOfCoreGemm::DEFAULT_BUDGET);
+    }
+
+    /**
+     * Buffers on huge pages and with a NUMA placement.
+     */
+    public function MemoryAllocator() : MemoryAllocator
+    {
+        $this->load('blas');
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        return new MemoryAllocator(self::$ffi, $this->isIlp64());
+    }
+
+    /**
+     * A queue that runs Blas and Lapack operations in a worker process.
+     * Lapack is loaded on the first lapack() submission.
+     */
+    public function ExecutionQueue() : ExecutionQueue
+    {
+        return new ExecutionQueue($this->Blas(), fn() => $this->Lapack());
     }
 
     public function Lapack() : Lapack
     {
-        if(PHP_OS=='Darwin') {
-            return $this->Lapackb();
+        if($this->profile()->get('lapack')==='lapack') {
+            $this->load('lapack');
+            if(self::$ffiLapack!==null) {
+                return $this->Lapackb();
+            }
         }
+        $this->load('lapacke');
+        // vecLib has no LAPACKE; the Fortran interface is used instead.
+        if(self::$ffiLapacke==null) {
+            $this->load('lapack');
+            if(self::$ffiLapack!==null) {
+                return $this->Lapackb();
+            }
+        }
+        return $this->Lapacke();
+    }
+
+    /**
+     * Lapack() that writes each call with its shapes and time to the tracer.
+     */
+    public function TracedLapack(CallTracer $tracer) : TracedLapack
+    {
+        return new TracedLapack($this->Lapack(), $tracer);
+    }
+
+    /**
+     * Inverse, determinant and condition number of batches of square matrices.
+     */
+    public function LinearAlgebra() : LinearAlgebra
+    {
+        $this->load('lapack');
+        if(self::$ffiLapack==null) {
+            throw new RuntimeException('lapack library not loaded.');
+        }
+        self::$scratchPool ??= new ScratchPool(self::$ffiLapack);
+        return new LinearAlgebra(self::$ffiLapack, self::$scratchPool);
+    }
+
+    public function Lapacke() : Lapack
+    {
+        $this->load('lapacke');
         if(self::$ffiLapacke==null) {
             throw new RuntimeException('lapacke library not loaded.');
         }
@@ -193,9 +895,16 @@ class OpenBLASFactory
 
     public function Lapackb() : Lapack
     {
+        $this->load('lapack');
+        $this->load('blas');
         if(self::$ffiLapack==null) {
             throw new RuntimeException('lapack library not loaded.');
         }
-        return new Lapackb(self::$ffiLapack, self::$ffi);
+        if(self::$ffi==null) {
+            throw new RuntimeException('openblas library not loaded.');
+        }
+        // Every Lapackb shares the temporaries of one pool.
+        self::$scratchPool ??= new ScratchPool(self::$ffiLapack);
+        return new Lapackb(self::$ffiLapack, self::$ffi, self::$capabilities, self::$profile, self::$scratchPool);
     }
 }
@@ -0,0 +1,259 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use InvalidArgumentException;
+use RuntimeException;
+use FFI;
+
+/**
+ * GEMM on matrices stored in files that do not fit in memory.
+ *
+ * The product is split into tiles sized to the memory budget. The rows of
+ * each tile of A, B and C are copied from a MappedBuffer into packed
+ * scratch buffers and multiplied with Blas::gemm, and the tile of C is
+ * copied back when it is complete. Only the cols-wide run of each row is
+ * read, so a tile of a wide matrix does not pull in whole row stripes.
+ * The runs of the next tiles are advised with ADVICE_WILLNEED before the
+ * current gemm runs, and the kernel reads them ahead meanwhile. The packed
+ * tiles and the advised runs together stay within the budget.
+ */
+class OutOfCoreGemm
+{
+    use Utils;
+
+    const DEFAULT_BUDGET = 268435456;   // 256 MiB
+
+    protected Blas $blas;
+    protected int $memoryBudget;
+    protected int $peakBytes = 0;
+
+    public function __construct(Blas $blas, int $memoryBudget=self::DEFAULT_BUDGET)
+    {
+        if($memoryBudget<1) {
+            throw new InvalidArgumentException('Argument memoryBudget must be greater than 0.');
+        }
+        $this->blas = $blas;
+        $this->memoryBudget = $memoryBudget;
+    }
+
+    public function memoryBudget() : int
+    {
+        return $this->memoryBudget;
+    }
+
+    /**
+     * The tile shape [tm, tn, tk] used for an m x n x k product.
+     *
+     * @return array{int,int,int}
+     */
+    public function tileShape(int $m, int $n, int $k, int $dtype) : array
+    {
+        $valueSize = MappedBuffer::TYPES[$dtype][1] ?? null;
+        if($valueSize===null) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        // packed A, B and C tiles, and the advised next A and B tiles
+        $tile = (int)floor(sqrt($this->memoryBudget/(5*$valueSize)));
+        if($tile<1) {
+            throw new InvalidArgumentException('memoryBudget is too small.');
+        }
+        return [min($m, $tile), min($n, $tile), min($k, $tile)];
+    }
+
+    /**
+     * C := alpha * op(A) * op(B) + beta * C on files.
+     *
+     * The arguments follow Blas::gemm, with a file name and an element
+     * offset for each matrix, e.g. the size of a file header. The file of
+     * C is created or extended when it is too small.
+     */
+    public function gemm(
+        int $order,
+        int $transA,
+        int $transB,
+        int $m,
+        int $n,
+        int $k,
+        float $alpha,
+        string $fileA, int $offsetA, int $ldA,
+        string $fileB, int $offsetB, int $ldB,
+        float $beta,
+        string $fileC, int $offsetC, int $ldC,
+        int $dtype=NDArray::float32,
+        ) : void
+    {
+        if($order==BLASIF::ColMajor) {
+            // C^T := op(B)^T * op(A)^T in RowMajor
+            [$transA, $transB] = [$transB, $transA];
+            [$m, $n] = [$n, $m];
+            [$fileA, $offsetA, $ldA, $fileB, $offsetB, $ldB] = [$fileB, $offsetB, $ldB, $fileA, $offsetA, $ldA];
+        } elseif($order!=BLASIF::RowMajor) {
+            throw new InvalidArgumentException("unknown order: {$order}");
+        }
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        foreach(['A'=>$transA, 'B'=>$transB] as $name => $trans) {
+            if($trans!=BLASIF::NoTrans && $trans!=BLASIF::Trans) {
+                throw new InvalidArgumentException("unknown transpose mode for buffer{$name}.");
+            }
+        }
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        $this->assert_shape_parameter("k", $k);
+        $specs = [
+            'A' => [$offsetA, $ldA, ($transA==BLASIF::NoTrans) ? $k : $m],
+            'B' => [$offsetB, $ldB, ($transB==BLASIF::NoTrans) ? $n : $k],
+            'C' => [$offsetC, $ldC, $n],
+        ];
+        foreach($specs as $name => [$offset, $ld, $cols]) {
+            if($offset<0) {
+                throw new InvalidArgumentException("Argument offset$name must be greater than equals 0.");
+            }
+            if($ld<$cols) {
+                throw new InvalidArgumentException("Argument ld$name must be greater than or equal {$cols}.");
+            }
+        }
+        if(!file_exists($fileC) && !touch($fileC)) {
+            throw new RuntimeException("Cannot create file: {$fileC}");
+        }
+
+        [$tm, $tn, $tk] = $this->tileShape($m, $n, $k, $dtype);
+        $valueSize = MappedBuffer::TYPES[$dtype][1];
+        $packedA = new AnonymousBuffer($tm*$tk, $dtype);
+        $packedB = new AnonymousBuffer($tk*$tn, $dtype);
+        $packedC = new AnonymousBuffer($tm*$tn, $dtype);
+        $packedBytes = ($tm*$tk+$tk*$tn+$tm*$tn)*$valueSize;
+        $this->peakBytes = $packedBytes;
+
+        $steps = [];
+        for($i=0; $i<$m; $i+=$tm) {
+            for($j=0; $j<$n; $j+=$tn) {
+                for($p=0; $p<$k; $p+=$tk) {
+                    $steps[] = [$i, $j, $p];
+                }
+            }
+        }
+        // the stored tiles [file, offset, ld, row, rows, col, cols] of op(A) and op(B)
+        $operands = function(int $i, int $j, int $p)
+            use ($m, $n, $k, $tm, $tn, $tk, $transA, $transB,
+                $fileA, $offsetA, $ldA, $fileB, $offsetB, $ldB) : array {
+            $rows = min($tm, $m-$i);
+            $cols = min($tn, $n-$j);
+            $depth = min($tk, $k-$p);
+            $A = ($transA==BLASIF::NoTrans) ?
+                [$fileA, $offsetA, $ldA, $i, $rows, $p, $depth] :
+                [$fileA, $offsetA, $ldA, $p, $depth, $i, $rows];
+            $B = ($transB==BLASIF::NoTrans) ?
+                [$fileB, $offsetB, $ldB, $p, $depth, $j, $cols] :
+                [$fileB, $offsetB, $ldB, $j, $cols, $p, $depth];
+            return [$A, $B];
+        };
+
+        $next = $operands(...$steps[0]);
+        foreach($steps as $s => [$i, $j, $p]) {
+            [$A, $B] = $next;
+            $this->copyTile($A, $packedA, $dtype);
+            $this->copyTile($B, $packedB, $dtype);
+            // start reading the next tiles before this one is computed
+            $advised = 0;
+            $next = isset($steps[$s+1]) ? $operands(...$steps[$s+1]) : null;
+            if($next!==null) {
+                foreach($next as $tile) {
+                    $advised += $this->adviseTile($tile, $dtype);
+                }
+            }
+            $this->peakBytes = max($this->peakBytes, $packedBytes+$advised);
+            $rows = min($tm, $m-$i);
+            $cols = min($tn, $n-$j);
+            $depth = min($tk, $k-$p);
+            $tileC = [$fileC, $offsetC, $ldC, $i, $rows, $j, $cols];
+            if($p==0 && $beta!=0.0) {
+                $this->copyTile($tileC, $packedC, $dtype, MappedBuffer::SHARED);
+            }
+            $this->blas->gemm(
+                BLASIF::RowMajor, $transA, $transB,
+                $rows, $cols, $depth,
+                $alpha,
+                $packedA, 0, $A[6],
+                $packedB, 0, $B[6],
+                ($p==0) ? $beta : 1.0,
+                $packedC, 0, $cols);
+            if($p+$tk>=$k) {
+                $this->copyTile($tileC, $packedC, $dtype, MappedBuffer::SHARED, true);
+            }
+        }
+    }
+
+    /**
+     * Bytes of the packed tiles and of the advised runs of the next tiles
+     * at the peak of the last gemm. It does not exceed the memory budget.
+     */
+    public function peakBytes() : int
+    {
+        return $this->peakBytes;
+    }
+
+    /**
+     * Copy the rows x cols tile at (row, col) of a RowMajor matrix in a file
+     * into packed rows of a buffer, or back into the file with store. Only
+     * the cols-wide run of each row is touched, and the file is unmapped
+     * right after the copy.
+     *
+     * @param array{string,int,int,int,int,int,int} $tile
+     */
+    protected function copyTile(
+        array $tile, AnonymousBuffer $packed, int $dtype,
+        int $mode=MappedBuffer::READONLY, bool $store=false) : void
+    {
+        [, , $ld, , $rows, , $cols] = $tile;
+        $mapped = $this->mapTile($tile, $dtype, $mode);
+        $bytes = $cols*$packed->value_size();
+        for($r=0; $r<$rows; $r++) {
+            if($store) {
+                FFI::memcpy($mapped->addr($r*$ld), $packed->addr($r*$cols), $bytes);
+            } else {
+                FFI::memcpy($packed->addr($r*$cols), $mapped->addr($r*$ld), $bytes);
+            }
+        }
+        $mapped->close();
+    }
+
+    /**
+     * Ask the kernel to read the cols-wide run of each row of a tile ahead.
+     * Returns the advised bytes.
+     *
+     * @param array{string,int,int,int,int,int,int} $tile
+     */
+    protected function adviseTile(array $tile, int $dtype) : int
+    {
+        [, , $ld, , $rows, , $cols] = $tile;
+        $mapped = $this->mapTile($tile, $dtype);
+        for($r=0; $r<$rows; $r++) {
+            $mapped->advise(MappedBuffer::ADVICE_WILLNEED, $r*$ld, $cols);
+        }
+        $mapped->close();
+        return $rows*$cols*$mapped->value_size();
+    }
+
+    /**
+     * Map the rows of a tile. The mapping spans the whole row stripe, but
+     * the pages between the runs of the tile are never touched.
+     *
+     * @param array{string,int,int,int,int,int,int} $tile
+     */
+    protected function mapTile(array $tile, int $dtype, int $mode=MappedBuffer::READONLY) : MappedBuffer
+    {
+        [$filename, $offset, $ld, $row, $rows, $col, $cols] = $tile;
+        $valueSize = MappedBuffer::TYPES[$dtype][1];
+        return new MappedBuffer(
+            $filename,
+            $dtype,
+            size: ($rows-1)*$ld+$cols,
+            offset: ($offset+$row*$ld+$col)*$valueSize,
+            mode: $mode,
+        );
+    }
+}
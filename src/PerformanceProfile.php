@@ -0,0 +1,127 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use RuntimeException;
+
+/**
+ * Host specific thresholds measured by the autotuner.
+ *
+ * Profiles are stored as JSON, keyed by corename and config string,
+ * so a single file can hold the profiles of several hosts.
+ */
+class PerformanceProfile
+{
+    const DEFAULTS = [
+        // Number of OpenBLAS threads. 0 keeps the library default.
+        'num_threads' => 0,
+        // m*n*k from which complex gemm uses gemm3m.
+        'gemm3m_min_size' => PHP_INT_MAX,
+        // m*n from which Lapackb transposes with omatcopy instead of gemm.
+        'omatcopy_transpose_min_size' => PHP_INT_MAX,
+        // The LAPACK interface returned by OpenBLASFactory::Lapack(): "lapacke" or "lapack".
+        'lapack' => 'lapacke',
+    ];
+
+    /** @var array<string,int|string> $values */
+    protected array $values;
+
+    /**
+     * @param array<string,int|string> $values
+     */
+    public function __construct(array $values=[])
+    {
+        $this->values = array_merge(self::DEFAULTS, array_intersect_key($values, self::DEFAULTS));
+    }
+
+    public function get(string $name) : int|string
+    {
+        if(!array_key_exists($name, $this->values)) {
+            throw new RuntimeException('Unknown profile entry: "'.$name.'"');
+        }
+        return $this->values[$name];
+    }
+
+    public function getInt(string $name) : int
+    {
+        return (int)$this->get($name);
+    }
+
+    /**
+     * @return array<string,int|string>
+     */
+    public function toArray() : array
+    {
+        return $this->values;
+    }
+
+    public static function key(string $corename, string $config) : string
+    {
+        return $corename.'|'.$config;
+    }
+
+    /**
+     * RINDOW_OPENBLAS_PROFILE, or rindow/openblas-profile.json in the user configuration directory.
+     * This is where the autotuner writes; the factory reads it only when asked to.
+     */
+    public static function defaultPath() : string
+    {
+        $path = getenv('RINDOW_OPENBLAS_PROFILE');
+        if($path!==false && $path!=='') {
+            return $path;
+        }
+        $base = getenv('XDG_CONFIG_HOME');
+        if($base===false || $base==='') {
+            $home = getenv('HOME') ?: getenv('USERPROFILE') ?: sys_get_temp_dir();
+            $base = $home.DIRECTORY_SEPARATOR.'.config';
+        }
+        return $base.DIRECTORY_SEPARATOR.'rindow'.DIRECTORY_SEPARATOR.'openblas-profile.json';
+    }
+
+    /**
+     * Returns null when the file or the entry for the key does not exist.
+     */
+    public static function load(string $path, string $key) : ?self
+    {
+        if(!is_file($path)) {
+            return null;
+        }
+        $profiles = self::readFile($path);
+        if(!isset($profiles[$key]) || !is_array($profiles[$key])) {
+            return null;
+        }
+        return new self($profiles[$key]);
+    }
+
+    /**
+     * Add or replace the entry for the key, keeping the other hosts.
+     */
+    public static function save(string $path, string $key, self $profile) : void
+    {
+        $profiles = is_file($path) ? self::readFile($path) : [];
+        $profiles[$key] = $profile->toArray();
+        $dir = dirname($path);
+        if(!is_dir($dir) && !mkdir($dir, 0777, true) && !is_dir($dir)) {
+            throw new RuntimeException('Cannot create the directory: "'.$dir.'"');
+        }
+        $json = json_encode($profiles, JSON_PRETTY_PRINT|JSON_UNESCAPED_SLASHES);
+        if($json===false || file_put_contents($path, $json."\n", LOCK_EX)===false) {
+            throw new RuntimeException('Cannot write the profile: "'.$path.'"');
+        }
+    }
+
+    /**
+     * @return array<mixed>
+     */
+    protected static function readFile(string $path) : array
+    {
+        $json = file_get_contents($path);
+        if($json===false) {
+            throw new RuntimeException('Cannot read the profile: "'.$path.'"');
+        }
+        $profiles = json_decode($json, true);
+        if(!is_array($profiles)) {
+            throw new RuntimeException('Broken profile: "'.$path.'"');
+        }
+        return $profiles;
+    }
+}
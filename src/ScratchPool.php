@@ -0,0 +1,190 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use InvalidArgumentException;
+use FFI;
+
+/**
+ * Reusable, cache-line aligned scratch memory for temporaries.
+ *
+ * Blocks come in power-of-two size classes and go back to the free list of
+ * their class when released, so repeated calls reuse the same memory
+ * instead of allocating and leaving it to the garbage collector.
+ * Temporaries of a call are released together:
+ *
+ *     $mark = $pool->mark();
+ *     try {
+ *         $work = $pool->acquire('double', $lwork);
+ *         ...
+ *     } finally {
+ *         $pool->releaseTo($mark);
+ *     }
+ */
+class ScratchPool
+{
+    const ALIGNMENT = 64;
+    const MIN_BLOCK_SIZE = 64;
+
+    protected FFI|SuffixedFFI $ffi;
+    /** @var array<int,array<FFI\CData>> $free blocks by size class */
+    protected array $free = [];
+    /** @var array<int,array{FFI\CData,int,int}> $used block, size class and sequence by address */
+    protected array $used = [];
+    protected int $sequence = 0;
+    protected int $inUse = 0;
+    protected int $reserved = 0;
+    protected int $highWaterMark = 0;
+
+    /**
+     * Types are resolved in the scope of ffi, e.g. lapack_int.
+     */
+    public function __construct(FFI|SuffixedFFI $ffi)
+    {
+        $this->ffi = $ffi;
+    }
+
+    /**
+     * A pointer to count elements of type, aligned to ALIGNMENT.
+     * The memory is not initialized.
+     */
+    public function acquire(string $type, int $count=1) : FFI\CData
+    {
+        if($count<1) {
+            throw new InvalidArgumentException('Argument count must be greater than 0.');
+        }
+        $ffi = $this->ffi;
+        $bytes = $count*FFI::sizeof($ffi->type($type));
+        $class = self::MIN_BLOCK_SIZE;
+        while($class<$bytes) {
+            $class *= 2;
+        }
+        if(!empty($this->free[$class])) {
+            $block = array_pop($this->free[$class]);
+        } else {
+            $block = $ffi->new('char['.($class+self::ALIGNMENT-1).']');
+            $this->reserved += $class;
+        }
+        $base = FFI::addr($block[0]);
+        $address = $ffi->cast('uintptr_t', $base)->cdata;
+        $padding = (self::ALIGNMENT - $address % self::ALIGNMENT) % self::ALIGNMENT;
+        $aligned = $base+$padding;
+        $this->used[$address+$padding] = [$block, $class, $this->sequence++];
+        $this->inUse += $class;
+        $this->highWaterMark = max($this->highWaterMark, $this->inUse);
+        return $ffi->cast($type.'*', $aligned);
+    }
+
+    /**
+     * A one-element cell holding value, e.g. an argument of a Fortran routine.
+     */
+    public function cell(string $type, mixed $value) : FFI\CData
+    {
+        $cell = $this->acquire($type);
+        $cell[0] = $value;
+        return $cell;
+    }
+
+    /**
+     * Return blocks to their free lists.
+     */
+    public function release(FFI\CData ...$pointers) : void
+    {
+        foreach($pointers as $pointer) {
+            $address = $this->ffi->cast('uintptr_t', $pointer)->cdata;
+            if(!isset($this->used[$address])) {
+                throw new InvalidArgumentException('The pointer was not acquired from this pool.');
+            }
+            $this->releaseBlock($address);
+        }
+    }
+
+    /**
+     * The position to give releaseTo().
+     */
+    public function mark() : int
+    {
+        return $this->sequence;
+    }
+
+    /**
+     * Release every block acquired since mark.
+     */
+    public function releaseTo(int $mark) : void
+    {
+        foreach($this->used as $address => [, , $sequence]) {
+            if($sequence>=$mark) {
+                $this->releaseBlock($address);
+            }
+        }
+    }
+
+    protected function releaseBlock(int $address) : void
+    {
+        [$block, $class] = $this->used[$address];
+        unset($this->used[$address]);
+        $this->free[$class][] = $block;
+        $this->inUse -= $class;
+    }
+
+    /**
+     * Free the unused blocks and return the number of bytes freed.
+     */
+    public function trim() : int
+    {
+        $freed = 0;
+        foreach($this->free as $class => $blocks) {
+            $freed += $class*count($blocks);
+        }
+        $this->free = [];
+        $this->reserved -= $freed;
+        return $freed;
+    }
+
+    /**
+     * Bytes of the blocks in use.
+     */
+    public function inUse() : int
+    {
+        return $this->inUse;
+    }
+
+    /**
+     * Bytes of all blocks held by the pool, in use or free.
+     */
+    public function reserved() : int
+    {
+        return $this->reserved;
+    }
+
+    /**
+     * The largest number of bytes in use at once since the last reset.
+     */
+    public function highWaterMark() : int
+    {
+        return $this->highWaterMark;
+    }
+
+    public function resetHighWaterMark() : void
+    {
+        $this->highWaterMark = $this->inUse;
+    }
+
+    /**
+     * Free and used blocks of each size class.
+     *
+     * @return array<int,array{free:int,used:int}>
+     */
+    public function stats() : array
+    {
+        $stats = [];
+        foreach($this->free as $class => $blocks) {
+            $stats[$class] = ['free'=>count($blocks), 'used'=>0];
+        }
+        foreach($this->used as [, $class]) {
+            $stats[$class] ??= ['free'=>0, 'used'=>0];
+            $stats[$class]['used']++;
+        }
+        ksort($stats);
+        return $stats;
+    }
+}
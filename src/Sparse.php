@@ -0,0 +1,364 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS as BLASIF;
+use InvalidArgumentException;
+use FFI;
+
+use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
+
+/**
+ * Products of CSR and CSC sparse matrices with dense vectors and matrices.
+ *
+ * A sparse matrix is given by three buffers: values (float32 or float64),
+ * indices and indptr (int32 or int64). The nonzeros of row i of a CSR matrix,
+ * or of column i of a CSC matrix, are at indptr[i] <= p < indptr[i+1].
+ * A CSC matrix has the same arrays as the CSR form of its transpose.
+ *
+ * csr() and csc() validate the arrays once and return a CompressedMatrix
+ * for mv() and mm(). csrmv, cscmv, csrmm and cscmm prepare the matrix on
+ * every call, so use the prepared form for repeated products.
+ *
+ * The dense matrices are RowMajor. For each compressed row of op(A) the
+ * rows of B selected by its indices are gathered into a scratch buffer and
+ * multiplied with one gemv. OpenBLAS has no gather, so the gather copies
+ * the rows with one substr per nonzero in PHP; it makes no library call
+ * per nonzero, but it is not a native sparse kernel either.
+ */
+class Sparse
+{
+    use Utils;
+
+    // Elements of the scratch buffer that holds gathered rows of B
+    const GATHER_SIZE = 65536;
+
+    protected object $ffi;
+    /** @var array<int,FFI\CData> $scratch */
+    protected array $scratch = [];
+    /** @var array<int,int> $scratchSize */
+    protected array $scratchSize = [];
+
+    public function __construct(FFI|SuffixedFFI $ffi)
+    {
+        $this->ffi = $ffi;
+    }
+
+    /**
+     * Prepare an m x n CSR matrix.
+     */
+    public function csr(
+        int $m,
+        int $n,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr ) : CompressedMatrix
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        [$ptr, $idx, $val] = $this->readCompressed(
+            $m, $n,
+            $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        return new CompressedMatrix($this->ffi, $m, $n, $values->dtype(), $ptr, $idx, $val);
+    }
+
+    /**
+     * Prepare an m x n CSC matrix.
+     */
+    public function csc(
+        int $m,
+        int $n,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr ) : CompressedMatrix
+    {
+        $this->assert_shape_parameter("m", $m);
+        $this->assert_shape_parameter("n", $n);
+        [$ptr, $idx, $val] = $this->readCompressed(
+            $n, $m,
+            $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        return new CompressedMatrix($this->ffi, $m, $n, $values->dtype(), $ptr, $idx, $val, transposed:true);
+    }
+
+    /**
+     *  Y := alpha * op(A) * X + beta * Y    for a prepared matrix A
+     */
+    public function mv(
+        int $trans,
+        float $alpha,
+        CompressedMatrix $A,
+        BufferInterface $X, int $offsetX, int $incX,
+        float $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $transpose = !$this->isNoTrans($trans);
+        [$sizeY, $sizeX] = $transpose ? [$A->cols(), $A->rows()] : [$A->rows(), $A->cols()];
+        // Check Buffer X and Y
+        $this->assert_vector_buffer_spec("X", $X, $sizeX, $offsetX, $incX);
+        $this->assert_vector_buffer_spec("Y", $Y, $sizeY, $offsetY, $incY);
+        if($X->dtype()!=$A->dtype() || $Y->dtype()!=$A->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for values and X and Y");
+        }
+        // a vector is a matrix of one column with the increment as ld
+        $this->gathermm(
+            $transpose, $A, 1,
+            $alpha,
+            $X, $offsetX, $incX,
+            $beta,
+            $Y, $offsetY, $incY);
+    }
+
+    /**
+     *  C := alpha * op(A) * B + beta * C    for a prepared matrix A
+     *
+     *  op(A) is m x k, B is k x n and C is m x n.
+     */
+    public function mm(
+        int $transA,
+        int $n,
+        float $alpha,
+        CompressedMatrix $A,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        $transpose = !$this->isNoTrans($transA);
+        [$m, $k] = $transpose ? [$A->cols(), $A->rows()] : [$A->rows(), $A->cols()];
+        $this->assert_shape_parameter("n", $n);
+        // Check Buffer B and C
+        $this->assert_matrix_buffer_spec("B", $B, $k, $n, $offsetB, $ldB);
+        $this->assert_matrix_buffer_spec("C", $C, $m, $n, $offsetC, $ldC);
+        if($B->dtype()!=$A->dtype() || $C->dtype()!=$A->dtype()) {
+            throw new InvalidArgumentException("Unmatch data type for values and B and C");
+        }
+        $this->gathermm(
+            $transpose, $A, $n,
+            $alpha,
+            $B, $offsetB, $ldB,
+            $beta,
+            $C, $offsetC, $ldC);
+    }
+
+    /**
+     *  Y := alpha * op(A) * X + beta * Y    for an m x n CSR matrix A
+     */
+    public function csrmv(
+        int $trans,
+        int $m,
+        int $n,
+        float $alpha,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr,
+        BufferInterface $X, int $offsetX, int $incX,
+        float $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $A = $this->csr($m, $n, $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        $this->mv($trans, $alpha, $A, $X, $offsetX, $incX, $beta, $Y, $offsetY, $incY);
+    }
+
+    /**
+     *  Y := alpha * op(A) * X + beta * Y    for an m x n CSC matrix A
+     */
+    public function cscmv(
+        int $trans,
+        int $m,
+        int $n,
+        float $alpha,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr,
+        BufferInterface $X, int $offsetX, int $incX,
+        float $beta,
+        BufferInterface $Y, int $offsetY, int $incY ) : void
+    {
+        $A = $this->csc($m, $n, $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        $this->mv($trans, $alpha, $A, $X, $offsetX, $incX, $beta, $Y, $offsetY, $incY);
+    }
+
+    /**
+     *  C := alpha * op(A) * B + beta * C
+     *
+     *  op(A) is m x k, B is k x n and C is m x n. A is a CSR matrix.
+     */
+    public function csrmm(
+        int $transA,
+        int $m,
+        int $n,
+        int $k,
+        float $alpha,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        [$rows, $cols] = $this->isNoTrans($transA) ? [$m, $k] : [$k, $m];
+        $A = $this->csr($rows, $cols, $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        $this->mm($transA, $n, $alpha, $A, $B, $offsetB, $ldB, $beta, $C, $offsetC, $ldC);
+    }
+
+    /**
+     *  C := alpha * op(A) * B + beta * C
+     *
+     *  op(A) is m x k, B is k x n and C is m x n. A is a CSC matrix.
+     */
+    public function cscmm(
+        int $transA,
+        int $m,
+        int $n,
+        int $k,
+        float $alpha,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        [$rows, $cols] = $this->isNoTrans($transA) ? [$m, $k] : [$k, $m];
+        $A = $this->csc($rows, $cols, $values, $offsetValues, $indices, $offsetIndices, $indptr, $offsetIndptr);
+        $this->mm($transA, $n, $alpha, $A, $B, $offsetB, $ldB, $beta, $C, $offsetC, $ldC);
+    }
+
+    protected function isNoTrans(int $trans) : bool
+    {
+        if($trans==BLASIF::NoTrans) {
+            return true;
+        } elseif($trans==BLASIF::Trans || $trans==BLASIF::ConjTrans) {
+            return false;
+        }
+        throw new InvalidArgumentException("unknown transpose mode for bufferA.");
+    }
+
+    /**
+     * Row i of C := alpha * (the rows of B selected by compressed row i of
+     * op(A))^T * (its values) + beta * row i of C, with one gemv per row.
+     * The selected rows of as many compressed rows as fit in the scratch
+     * buffer are gathered with one copy.
+     */
+    protected function gathermm(
+        bool $transpose,
+        CompressedMatrix $A,
+        int $n,
+        float $alpha,
+        BufferInterface $B, int $offsetB, int $ldB,
+        float $beta,
+        BufferInterface $C, int $offsetC, int $ldC ) : void
+    {
+        $ffi = $this->ffi;
+        $dtype = $A->dtype();
+        [$ptr, $idx, $values] = $A->compressedRows($transpose);
+        $major = count($ptr)-1;
+        $minor = $transpose ? $A->rows() : $A->cols();
+        [$gemv, $scal, $size] = ($dtype==NDArray::float32) ?
+            ['cblas_sgemv', 'cblas_sscal', 4] : ['cblas_dgemv', 'cblas_dscal', 8];
+        $rowBytes = $ldB*$size;
+        $bytes = $n*$size;
+        $b = ($A->nnz()>0) ? FFI::string($B->addr($offsetB), (($minor-1)*$ldB+$n)*$size) : '';
+
+        for($first=0; $first<$major; $first=$end) {
+            // the compressed rows whose selected rows fit in the scratch, at least one
+            $limit = $ptr[$first] + max(intdiv(self::GATHER_SIZE, $n), $ptr[$first+1]-$ptr[$first]);
+            for($end=$first+1; $end<$major && $ptr[$end+1]<=$limit; $end++) {
+            }
+            $gathered = '';
+            for($p=$ptr[$first]; $p<$ptr[$end]; $p++) {
+                $gathered .= substr($b, $idx[$p]*$rowBytes, $bytes);
+            }
+            $scratch = $this->scratch(($ptr[$end]-$ptr[$first])*$n, $dtype);
+            if($gathered!=='') {
+                FFI::memcpy($scratch, $gathered, strlen($gathered));
+            }
+            for($i=$first; $i<$end; $i++) {
+                $count = $ptr[$i+1]-$ptr[$i];
+                $rowC = $C->addr($offsetC+$i*$ldC);
+                if($count==0) {
+                    if($beta==0.0) {
+                        FFI::memset($rowC, 0, $bytes);
+                    } elseif($beta!=1.0) {
+                        $ffi->{$scal}($n, $beta, $rowC, 1);
+                    }
+                    continue;
+                }
+                $ffi->{$gemv}(
+                    BLASIF::RowMajor, BLASIF::Trans,
+                    $count, $n,
+                    $alpha,
+                    FFI::addr($scratch[($ptr[$i]-$ptr[$first])*$n]), $n,
+                    FFI::addr($values[$ptr[$i]]), 1,
+                    $beta,
+                    $rowC, 1);
+            }
+        }
+    }
+
+    /**
+     * Get the cached scratch buffer of at least size elements.
+     */
+    protected function scratch(int $size, int $dtype) : FFI\CData
+    {
+        if(($this->scratchSize[$dtype] ?? 0) >= $size) {
+            return $this->scratch[$dtype];
+        }
+        $size = max($size, self::GATHER_SIZE);
+        $type = ($dtype==NDArray::float32) ? 'float' : 'double';
+        $scratch = $this->ffi->new("{$type}[{$size}]");
+        $this->scratch[$dtype] = $scratch;
+        $this->scratchSize[$dtype] = $size;
+        return $scratch;
+    }
+
+    /**
+     * indptr relative to its first entry, indices and values as PHP arrays.
+     *
+     * @return array{array<int,int>,array<int,int>,array<int,float>}
+     */
+    protected function readCompressed(
+        int $major,
+        int $minor,
+        BufferInterface $values, int $offsetValues,
+        BufferInterface $indices, int $offsetIndices,
+        BufferInterface $indptr, int $offsetIndptr ) : array
+    {
+        $dtype = $values->dtype();
+        if($dtype!=NDArray::float32 && $dtype!=NDArray::float64) {
+            throw new InvalidArgumentException('Unsuppored data type');
+        }
+        foreach(['indices'=>$indices, 'indptr'=>$indptr] as $name => $buffer) {
+            if($buffer->dtype()!=NDArray::int32 && $buffer->dtype()!=NDArray::int64) {
+                throw new InvalidArgumentException("{$name} must be int32 or int64.");
+            }
+        }
+        $this->assert_buffer_size($indptr, $offsetIndptr, $major+1,
+            "Indptr specification too large for bufferIndptr.");
+        $ptr = $this->readValues($indptr, $offsetIndptr, $major+1);
+        $start = $ptr[0];
+        for($i=0; $i<$major; $i++) {
+            if($ptr[$i]>$ptr[$i+1]) {
+                throw new InvalidArgumentException("indptr must be non-decreasing.");
+            }
+            $ptr[$i] -= $start;
+        }
+        $ptr[$major] -= $start;
+        $nnz = $ptr[$major];
+        if($start<0) {
+            throw new InvalidArgumentException("indptr must be greater than equals 0.");
+        }
+        if($nnz==0) {
+            return [$ptr, [], []];
+        }
+        $this->assert_buffer_size($indices, $offsetIndices+$start, $nnz,
+            "Indices specification too large for bufferIndices.");
+        $this->assert_buffer_size($values, $offsetValues+$start, $nnz,
+            "Values specification too large for bufferValues.");
+        $idx = $this->readValues($indices, $offsetIndices+$start, $nnz);
+        if(min($idx)<0 || max($idx)>=$minor) {
+            throw new InvalidArgumentException("indices out of range.");
+        }
+        $val = $this->readValues($values, $offsetValues+$start, $nnz);
+        return [$ptr, $idx, $val];
+    }
+}
@@ -0,0 +1,58 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use FFI;
+use FFI\CData;
+use FFI\CType;
+
+/**
+ * FFI handle for libraries built with a symbol suffix.
+ *
+ * OpenBLAS built with SYMBOLSUFFIX (e.g. libopenblas64_.so) exports
+ * cblas_sgemm64_ instead of cblas_sgemm. The headers are loaded with the
+ * suffixed names, and this class forwards the plain names to them.
+ */
+class SuffixedFFI
+{
+    protected FFI $ffi;
+    protected string $suffix;
+
+    public function __construct(FFI $ffi, string $suffix)
+    {
+        $this->ffi = $ffi;
+        $this->suffix = $suffix;
+    }
+
+    public function ffi() : FFI
+    {
+        return $this->ffi;
+    }
+
+    public function suffix() : string
+    {
+        return $this->suffix;
+    }
+
+    public function new(CType|string $type, bool $owned=true, bool $persistent=false) : ?CData
+    {
+        return $this->ffi->new($type, $owned, $persistent);
+    }
+
+    public function cast(CType|string $type, mixed $ptr) : ?CData
+    {
+        return $this->ffi->cast($type, $ptr);
+    }
+
+    public function type(string $type) : ?CType
+    {
+        return $this->ffi->type($type);
+    }
+
+    /**
+     * @param array<mixed> $args
+     */
+    public function __call(string $name, array $args) : mixed
+    {
+        return $this->ffi->{$name.$this->suffix}(...$args);
+    }
+}
@@ -0,0 +1,248 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+use FFI;
+
+/**
+ * Blas that writes every call with its shapes and time to a CallTracer.
+ *
+ * Only the calls of the user are written; calls that Blas makes internally
+ * are part of the time of the call that made them.
+ */
+class TracedBlas extends Blas
+{
+    protected CallTracer $tracer;
+    protected int $depth = 0;
+
+    /**
+     * @param array<string,bool>|null $capabilities
+     */
+    public function __construct(
+        CallTracer $tracer,
+        FFI|SuffixedFFI $ffi,
+        FFI|SuffixedFFI|null $ffiGemmBatch=null,
+        FFI|SuffixedFFI|null $ffiGemmBatchStrided=null,
+        ?array $capabilities=null,
+        ?PerformanceProfile $profile=null,
+        ?OnesCache $onesCache=null,
+        )
+    {
+        parent::__construct($ffi, $ffiGemmBatch, $ffiGemmBatchStrided, $capabilities, $profile, $onesCache);
+        $this->tracer = $tracer;
+    }
+
+    public function tracer() : CallTracer
+    {
+        return $this->tracer;
+    }
+
+    public function scal(mixed ...$args) : void
+    {
+        $this->trace('scal', $args);
+    }
+
+    public function axpy(mixed ...$args) : void
+    {
+        $this->trace('axpy', $args);
+    }
+
+    public function axpby(mixed ...$args) : void
+    {
+        $this->trace('axpby', $args);
+    }
+
+    public function dot(mixed ...$args) : float
+    {
+        return $this->trace('dot', $args);
+    }
+
+    public function dotu(mixed ...$args) : object
+    {
+        return $this->trace('dotu', $args);
+    }
+
+    public function dotuSub(mixed ...$args) : void
+    {
+        $this->trace('dotuSub', $args);
+    }
+
+    public function dotc(mixed ...$args) : object
+    {
+        return $this->trace('dotc', $args);
+    }
+
+    public function dotcSub(mixed ...$args) : void
+    {
+        $this->trace('dotcSub', $args);
+    }
+
+    public function asum(mixed ...$args) : float
+    {
+        return $this->trace('asum', $args);
+    }
+
+    public function iamax(mixed ...$args) : int
+    {
+        return $this->trace('iamax', $args);
+    }
+
+    public function iamin(mixed ...$args) : int
+    {
+        return $this->trace('iamin', $args);
+    }
+
+    public function copy(mixed ...$args) : void
+    {
+        $this->trace('copy', $args);
+    }
+
+    public function nrm2(mixed ...$args) : float
+    {
+        return $this->trace('nrm2', $args);
+    }
+
+    public function rotg(mixed ...$args) : void
+    {
+        $this->trace('rotg', $args);
+    }
+
+    public function rot(mixed ...$args) : void
+    {
+        $this->trace('rot', $args);
+    }
+
+    public function rotm(mixed ...$args) : void
+    {
+        $this->trace('rotm', $args);
+    }
+
+    public function rotmg(mixed ...$args) : void
+    {
+        $this->trace('rotmg', $args);
+    }
+
+    public function swap(mixed ...$args) : void
+    {
+        $this->trace('swap', $args);
+    }
+
+    public function dotStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('dotStridedBatch', $args);
+    }
+
+    public function nrm2StridedBatch(mixed ...$args) : void
+    {
+        $this->trace('nrm2StridedBatch', $args);
+    }
+
+    public function axpyStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('axpyStridedBatch', $args);
+    }
+
+    public function scalStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('scalStridedBatch', $args);
+    }
+
+    public function gemv(mixed ...$args) : void
+    {
+        $this->trace('gemv', $args);
+    }
+
+    public function trsv(mixed ...$args) : void
+    {
+        $this->trace('trsv', $args);
+    }
+
+    public function gemm(mixed ...$args) : void
+    {
+        $this->trace('gemm', $args);
+    }
+
+    public function gemmBatch(mixed ...$args) : void
+    {
+        $this->trace('gemmBatch', $args);
+    }
+
+    public function gemmStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('gemmStridedBatch', $args);
+    }
+
+    public function symm(mixed ...$args) : void
+    {
+        $this->trace('symm', $args);
+    }
+
+    public function syrk(mixed ...$args) : void
+    {
+        $this->trace('syrk', $args);
+    }
+
+    public function syr2k(mixed ...$args) : void
+    {
+        $this->trace('syr2k', $args);
+    }
+
+    public function trmm(mixed ...$args) : void
+    {
+        $this->trace('trmm', $args);
+    }
+
+    public function trsm(mixed ...$args) : void
+    {
+        $this->trace('trsm', $args);
+    }
+
+    public function omatcopy(mixed ...$args) : void
+    {
+        $this->trace('omatcopy', $args);
+    }
+
+    public function copyStrided(mixed ...$args) : void
+    {
+        $this->trace('copyStrided', $args);
+    }
+
+    public function permute(mixed ...$args) : void
+    {
+        $this->trace('permute', $args);
+    }
+
+    public function gemmInt8(mixed ...$args) : void
+    {
+        $this->trace('gemmInt8', $args);
+    }
+
+    public function quantize(mixed ...$args) : void
+    {
+        $this->trace('quantize', $args);
+    }
+
+    public function dequantize(mixed ...$args) : void
+    {
+        $this->trace('dequantize', $args);
+    }
+
+    /**
+     * @param array<mixed> $args
+     */
+    protected function trace(string $name, array $args) : mixed
+    {
+        if($this->depth>0) {
+            return parent::$name(...$args);
+        }
+        $this->depth++;
+        try {
+            $start = hrtime(true);
+            $result = parent::$name(...$args);
+            $elapsed = hrtime(true)-$start;
+        } finally {
+            $this->depth--;
+        }
+        $this->tracer->record('blas', Blas::class, $name, $args, $elapsed);
+        return $result;
+    }
+}
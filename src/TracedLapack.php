@@ -0,0 +1,67 @@
+<?php
+namespace Rindow\OpenBLAS\FFI;
+
+/**
+ * Lapack that writes every call with its shapes and time to a CallTracer.
+ */
+class TracedLapack implements Lapack
+{
+    protected Lapack $lapack;
+    protected CallTracer $tracer;
+
+    public function __construct(Lapack $lapack, CallTracer $tracer)
+    {
+        $this->lapack = $lapack;
+        $this->tracer = $tracer;
+    }
+
+    public function tracer() : CallTracer
+    {
+        return $this->tracer;
+    }
+
+    /**
+     * The traced Lapack.
+     */
+    public function inner() : Lapack
+    {
+        return $this->lapack;
+    }
+
+    public function ffi() : object
+    {
+        return $this->lapack->ffi();
+    }
+
+    public function gesvd(mixed ...$args) : void
+    {
+        $this->trace('gesvd', $args);
+    }
+
+    public function gesvdWorkspaceSize(mixed ...$args) : int
+    {
+        return $this->lapack->gesvdWorkspaceSize(...$args);
+    }
+
+    public function gesvdStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('gesvdStridedBatch', $args);
+    }
+
+    public function syevStridedBatch(mixed ...$args) : void
+    {
+        $this->trace('syevStridedBatch', $args);
+    }
+
+    /**
+     * @param array<mixed> $args
+     */
+    protected function trace(string $name, array $args) : mixed
+    {
+        $start = hrtime(true);
+        $result = $this->lapack->$name(...$args);
+        $elapsed = hrtime(true)-$start;
+        $this->tracer->record('lapack', Lapack::class, $name, $args, $elapsed);
+        return $result;
+    }
+}
@@ -2,7 +2,10 @@
 namespace Rindow\OpenBLAS\FFI;
 
 use InvalidArgumentException;
+use RuntimeException;
+use FFI;
 
+use Interop\Polite\Math\Matrix\NDArray;
 use Interop\Polite\Math\Matrix\LinearBuffer as BufferInterface;
 
 trait Utils
@@ -29,6 +32,18 @@ trait Utils
         }
     }
 
+    protected function assert_strided_vector_buffer_spec(
+        string $name, BufferInterface $buffer,
+        int $n, int $offset, int $inc, int $stride, int $batchCount) : void
+    {
+        if($stride<0) {
+            throw new InvalidArgumentException("Argument stride$name must be greater than equals 0.");
+        }
+        // Check the first and the last vector in the batch
+        $this->assert_vector_buffer_spec($name, $buffer, $n, $offset, $inc);
+        $this->assert_vector_buffer_spec($name, $buffer, $n, $offset+($batchCount-1)*$stride, $inc);
+    }
+
     protected function assert_matrix_buffer_spec(
         string $name, BufferInterface $buffer,
         int $m, int $n, int $offset, int $ld) : void
@@ -53,5 +68,59 @@ trait Utils
             throw new InvalidArgumentException($message);
         }
     }
-    
+
+    /**
+     * The pack() format of a data type and its element size in bytes.
+     * Complex elements are packed as their real and imaginary parts.
+     *
+     * @return array{string,int}
+     */
+    protected function packFormat(int $dtype) : array
+    {
+        return match($dtype) {
+            NDArray::bool       => ['C', 1],
+            NDArray::int8       => ['c', 1],
+            NDArray::uint8      => ['C', 1],
+            NDArray::int16      => ['s', 2],
+            NDArray::uint16     => ['S', 2],
+            NDArray::int32      => ['l', 4],
+            NDArray::uint32     => ['L', 4],
+            NDArray::int64      => ['q', 8],
+            NDArray::uint64     => ['Q', 8],
+            NDArray::float32    => ['f', 4],
+            NDArray::float64    => ['d', 8],
+            NDArray::complex64  => ['f', 8],
+            NDArray::complex128 => ['d', 16],
+            default => throw new InvalidArgumentException('Unsuppored data type'),
+        };
+    }
+
+    /**
+     * count contiguous elements of a buffer as PHP numbers, read with one
+     * FFI access. Complex elements give their real and imaginary parts.
+     *
+     * @return array<int,int|float>
+     */
+    protected function readValues(BufferInterface $X, int $offset, int $count) : array
+    {
+        [$format, $size] = $this->packFormat($X->dtype());
+        $values = unpack($format.'*', FFI::string($X->addr($offset), $count*$size));
+        if($values===false) {
+            throw new RuntimeException('Cannot read the buffer.');
+        }
+        return array_values($values);
+    }
+
+    /**
+     * Write PHP numbers to contiguous elements of a buffer with one FFI access.
+     *
+     * @param array<int,int|float> $values
+     */
+    protected function writeValues(BufferInterface $X, int $offset, array $values) : void
+    {
+        [$format] = $this->packFormat($X->dtype());
+        $data = pack($format.'*', ...$values);
+        $addr = $X->addr($offset);
+        FFI::memcpy($addr, $data, strlen($data));
+    }
 }
\ No newline at end of file
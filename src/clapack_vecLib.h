@@ -18,3 +18,111 @@ int dgesvd_(char *__jobu, char *__jobvt, __CLPK_integer *__m,
         __CLPK_doublereal *__vt, __CLPK_integer *__ldvt,
         __CLPK_doublereal *__work, __CLPK_integer *__lwork,
         __CLPK_integer *__info);
+
+int ssyev_(char *__jobz, char *__uplo, __CLPK_integer *__n, __CLPK_real *__a,
+        __CLPK_integer *__lda, __CLPK_real *__w, __CLPK_real *__work,
+        __CLPK_integer *__lwork, __CLPK_integer *__info);
+
+int dsyev_(char *__jobz, char *__uplo, __CLPK_integer *__n,
+        __CLPK_doublereal *__a, __CLPK_integer *__lda, __CLPK_doublereal *__w,
+        __CLPK_doublereal *__work, __CLPK_integer *__lwork,
+        __CLPK_integer *__info);
+
+// Complex matrices are passed as void* to take the pointers of any buffer.
+// The real functions return doublereal by the f2c convention.
+
+int sgetrf_(__CLPK_integer *__m, __CLPK_integer *__n, __CLPK_real *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__ipiv, __CLPK_integer *__info);
+
+int sgetri_(__CLPK_integer *__n, __CLPK_real *__a, __CLPK_integer *__lda,
+        __CLPK_integer *__ipiv, __CLPK_real *__work, __CLPK_integer *__lwork,
+        __CLPK_integer *__info);
+
+int spotrf_(char *__uplo, __CLPK_integer *__n, __CLPK_real *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__info);
+
+int sgecon_(char *__norm, __CLPK_integer *__n, __CLPK_real *__a,
+        __CLPK_integer *__lda, __CLPK_real *__anorm, __CLPK_real *__rcond,
+        __CLPK_real *__work, __CLPK_integer *__iwork, __CLPK_integer *__info);
+
+int spocon_(char *__uplo, __CLPK_integer *__n, __CLPK_real *__a,
+        __CLPK_integer *__lda, __CLPK_real *__anorm, __CLPK_real *__rcond,
+        __CLPK_real *__work, __CLPK_integer *__iwork, __CLPK_integer *__info);
+
+__CLPK_doublereal slange_(char *__norm, __CLPK_integer *__m, __CLPK_integer *__n,
+        __CLPK_real *__a, __CLPK_integer *__lda, __CLPK_real *__work);
+
+__CLPK_doublereal slansy_(char *__norm, char *__uplo, __CLPK_integer *__n,
+        __CLPK_real *__a, __CLPK_integer *__lda, __CLPK_real *__work);
+
+int dgetrf_(__CLPK_integer *__m, __CLPK_integer *__n, __CLPK_doublereal *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__ipiv, __CLPK_integer *__info);
+
+int dgetri_(__CLPK_integer *__n, __CLPK_doublereal *__a, __CLPK_integer *__lda,
+        __CLPK_integer *__ipiv, __CLPK_doublereal *__work, __CLPK_integer *__lwork,
+        __CLPK_integer *__info);
+
+int dpotrf_(char *__uplo, __CLPK_integer *__n, __CLPK_doublereal *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__info);
+
+int dgecon_(char *__norm, __CLPK_integer *__n, __CLPK_doublereal *__a,
+        __CLPK_integer *__lda, __CLPK_doublereal *__anorm, __CLPK_doublereal *__rcond,
+        __CLPK_doublereal *__work, __CLPK_integer *__iwork, __CLPK_integer *__info);
+
+int dpocon_(char *__uplo, __CLPK_integer *__n, __CLPK_doublereal *__a,
+        __CLPK_integer *__lda, __CLPK_doublereal *__anorm, __CLPK_doublereal *__rcond,
+        __CLPK_doublereal *__work, __CLPK_integer *__iwork, __CLPK_integer *__info);
+
+__CLPK_doublereal dlange_(char *__norm, __CLPK_integer *__m, __CLPK_integer *__n,
+        __CLPK_doublereal *__a, __CLPK_integer *__lda, __CLPK_doublereal *__work);
+
+__CLPK_doublereal dlansy_(char *__norm, char *__uplo, __CLPK_integer *__n,
+        __CLPK_doublereal *__a, __CLPK_integer *__lda, __CLPK_doublereal *__work);
+
+int cgetrf_(__CLPK_integer *__m, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__ipiv, __CLPK_integer *__info);
+
+int cgetri_(__CLPK_integer *__n, void *__a, __CLPK_integer *__lda,
+        __CLPK_integer *__ipiv, void *__work, __CLPK_integer *__lwork,
+        __CLPK_integer *__info);
+
+int cpotrf_(char *__uplo, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__info);
+
+int cgecon_(char *__norm, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_real *__anorm, __CLPK_real *__rcond,
+        void *__work, __CLPK_real *__rwork, __CLPK_integer *__info);
+
+int cpocon_(char *__uplo, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_real *__anorm, __CLPK_real *__rcond,
+        void *__work, __CLPK_real *__rwork, __CLPK_integer *__info);
+
+__CLPK_doublereal clange_(char *__norm, __CLPK_integer *__m, __CLPK_integer *__n,
+        void *__a, __CLPK_integer *__lda, __CLPK_real *__work);
+
+__CLPK_doublereal clanhe_(char *__norm, char *__uplo, __CLPK_integer *__n,
+        void *__a, __CLPK_integer *__lda, __CLPK_real *__work);
+
+int zgetrf_(__CLPK_integer *__m, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__ipiv, __CLPK_integer *__info);
+
+int zgetri_(__CLPK_integer *__n, void *__a, __CLPK_integer *__lda,
+        __CLPK_integer *__ipiv, void *__work, __CLPK_integer *__lwork,
+        __CLPK_integer *__info);
+
+int zpotrf_(char *__uplo, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_integer *__info);
+
+int zgecon_(char *__norm, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_doublereal *__anorm, __CLPK_doublereal *__rcond,
+        void *__work, __CLPK_doublereal *__rwork, __CLPK_integer *__info);
+
+int zpocon_(char *__uplo, __CLPK_integer *__n, void *__a,
+        __CLPK_integer *__lda, __CLPK_doublereal *__anorm, __CLPK_doublereal *__rcond,
+        void *__work, __CLPK_doublereal *__rwork, __CLPK_integer *__info);
+
+__CLPK_doublereal zlange_(char *__norm, __CLPK_integer *__m, __CLPK_integer *__n,
+        void *__a, __CLPK_integer *__lda, __CLPK_doublereal *__work);
+
+__CLPK_doublereal zlanhe_(char *__norm, char *__uplo, __CLPK_integer *__n,
+        void *__a, __CLPK_integer *__lda, __CLPK_doublereal *__work);
@@ -23,3 +23,255 @@ void dgesvd_(
     double* work, lapack_int const* lwork,
     lapack_int* info
 );
+
+void ssyev_(
+    char const* jobz, char const* uplo,
+    lapack_int const* n,
+    float* A, lapack_int const* lda,
+    float* W,
+    float* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+void dsyev_(
+    char const* jobz, char const* uplo,
+    lapack_int const* n,
+    double* A, lapack_int const* lda,
+    double* W,
+    double* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+// Complex matrices are passed as void* to take the pointers of any buffer.
+
+void sgetrf_(
+    lapack_int const* m, lapack_int const* n,
+    float* A, lapack_int const* lda,
+    lapack_int* ipiv,
+    lapack_int* info
+);
+
+void sgetri_(
+    lapack_int const* n,
+    float* A, lapack_int const* lda,
+    lapack_int const* ipiv,
+    float* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+void spotrf_(
+    char const* uplo,
+    lapack_int const* n,
+    float* A, lapack_int const* lda,
+    lapack_int* info
+);
+
+void sgecon_(
+    char const* norm,
+    lapack_int const* n,
+    float const* A, lapack_int const* lda,
+    float const* anorm,
+    float* rcond,
+    float* work,
+    lapack_int* iwork,
+    lapack_int* info
+);
+
+void spocon_(
+    char const* uplo,
+    lapack_int const* n,
+    float const* A, lapack_int const* lda,
+    float const* anorm,
+    float* rcond,
+    float* work,
+    lapack_int* iwork,
+    lapack_int* info
+);
+
+float slange_(
+    char const* norm,
+    lapack_int const* m, lapack_int const* n,
+    float const* A, lapack_int const* lda,
+    float* work
+);
+
+float slansy_(
+    char const* norm, char const* uplo,
+    lapack_int const* n,
+    float const* A, lapack_int const* lda,
+    float* work
+);
+
+void dgetrf_(
+    lapack_int const* m, lapack_int const* n,
+    double* A, lapack_int const* lda,
+    lapack_int* ipiv,
+    lapack_int* info
+);
+
+void dgetri_(
+    lapack_int const* n,
+    double* A, lapack_int const* lda,
+    lapack_int const* ipiv,
+    double* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+void dpotrf_(
+    char const* uplo,
+    lapack_int const* n,
+    double* A, lapack_int const* lda,
+    lapack_int* info
+);
+
+void dgecon_(
+    char const* norm,
+    lapack_int const* n,
+    double const* A, lapack_int const* lda,
+    double const* anorm,
+    double* rcond,
+    double* work,
+    lapack_int* iwork,
+    lapack_int* info
+);
+
+void dpocon_(
+    char const* uplo,
+    lapack_int const* n,
+    double const* A, lapack_int const* lda,
+    double const* anorm,
+    double* rcond,
+    double* work,
+    lapack_int* iwork,
+    lapack_int* info
+);
+
+double dlange_(
+    char const* norm,
+    lapack_int const* m, lapack_int const* n,
+    double const* A, lapack_int const* lda,
+    double* work
+);
+
+double dlansy_(
+    char const* norm, char const* uplo,
+    lapack_int const* n,
+    double const* A, lapack_int const* lda,
+    double* work
+);
+
+void cgetrf_(
+    lapack_int const* m, lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int* ipiv,
+    lapack_int* info
+);
+
+void cgetri_(
+    lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int const* ipiv,
+    void* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+void cpotrf_(
+    char const* uplo,
+    lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int* info
+);
+
+void cgecon_(
+    char const* norm,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    float const* anorm,
+    float* rcond,
+    void* work,
+    float* rwork,
+    lapack_int* info
+);
+
+void cpocon_(
+    char const* uplo,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    float const* anorm,
+    float* rcond,
+    void* work,
+    float* rwork,
+    lapack_int* info
+);
+
+float clange_(
+    char const* norm,
+    lapack_int const* m, lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    float* work
+);
+
+float clanhe_(
+    char const* norm, char const* uplo,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    float* work
+);
+
+void zgetrf_(
+    lapack_int const* m, lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int* ipiv,
+    lapack_int* info
+);
+
+void zgetri_(
+    lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int const* ipiv,
+    void* work, lapack_int const* lwork,
+    lapack_int* info
+);
+
+void zpotrf_(
+    char const* uplo,
+    lapack_int const* n,
+    void* A, lapack_int const* lda,
+    lapack_int* info
+);
+
+void zgecon_(
+    char const* norm,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    double const* anorm,
+    double* rcond,
+    void* work,
+    double* rwork,
+    lapack_int* info
+);
+
+void zpocon_(
+    char const* uplo,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    double const* anorm,
+    double* rcond,
+    void* work,
+    double* rwork,
+    lapack_int* info
+);
+
+double zlange_(
+    char const* norm,
+    lapack_int const* m, lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    double* work
+);
+
+double zlanhe_(
+    char const* norm, char const* uplo,
+    lapack_int const* n,
+    void const* A, lapack_int const* lda,
+    double* work
+);
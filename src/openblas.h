@@ -153,6 +153,9 @@ void cblas_srotg(float *a, float *b, float *c, float *s);
 void cblas_drotg(double *a, double *b, double *c, double *s);
 void cblas_crotg(void *a, void *b, void *c, void *s);
 void cblas_zrotg(void *a, void *b, void *c, void *s);
+// Fortran interface for builds whose CBLAS lacks the complex rotg
+void crotg_(void *a, void *b, void *c, void *s);
+void zrotg_(void *a, void *b, void *c, void *s);
 
 
 void cblas_srotm(const blasint N, float *X, const blasint incX, float *Y, const blasint incY, const float *P);
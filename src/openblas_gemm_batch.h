@@ -0,0 +1,26 @@
+#define FFI_SCOPE "Rindow\\OpenBLAS\\FFI"
+
+/////////////////////////////////////////////
+typedef int32_t                     blasint;
+/////////////////////////////////////////////
+
+typedef enum CBLAS_ORDER     {CblasRowMajor=101, CblasColMajor=102} CBLAS_ORDER;
+typedef enum CBLAS_TRANSPOSE {CblasNoTrans=111, CblasTrans=112, CblasConjTrans=113, CblasConjNoTrans=114} CBLAS_TRANSPOSE;
+
+/*** Batched GEMM (array of pointers, grouped) ***/
+void cblas_sgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE *TransA_array, const enum CBLAS_TRANSPOSE *TransB_array,
+		       const blasint *M_array, const blasint *N_array, const blasint *K_array,
+		       const float *alpha_array, const void **A_array, const blasint *lda_array, const void **B_array, const blasint *ldb_array,
+		       const float *beta_array, void **C_array, const blasint *ldc_array, const blasint group_count, const blasint *group_size);
+void cblas_dgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE *TransA_array, const enum CBLAS_TRANSPOSE *TransB_array,
+		       const blasint *M_array, const blasint *N_array, const blasint *K_array,
+		       const double *alpha_array, const void **A_array, const blasint *lda_array, const void **B_array, const blasint *ldb_array,
+		       const double *beta_array, void **C_array, const blasint *ldc_array, const blasint group_count, const blasint *group_size);
+void cblas_cgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE *TransA_array, const enum CBLAS_TRANSPOSE *TransB_array,
+		       const blasint *M_array, const blasint *N_array, const blasint *K_array,
+		       const void *alpha_array, const void **A_array, const blasint *lda_array, const void **B_array, const blasint *ldb_array,
+		       const void *beta_array, void **C_array, const blasint *ldc_array, const blasint group_count, const blasint *group_size);
+void cblas_zgemm_batch(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE *TransA_array, const enum CBLAS_TRANSPOSE *TransB_array,
+		       const blasint *M_array, const blasint *N_array, const blasint *K_array,
+		       const void *alpha_array, const void **A_array, const blasint *lda_array, const void **B_array, const blasint *ldb_array,
+		       const void *beta_array, void **C_array, const blasint *ldc_array, const blasint group_count, const blasint *group_size);
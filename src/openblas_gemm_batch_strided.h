@@ -0,0 +1,26 @@
+#define FFI_SCOPE "Rindow\\OpenBLAS\\FFI"
+
+/////////////////////////////////////////////
+typedef int32_t                     blasint;
+/////////////////////////////////////////////
+
+typedef enum CBLAS_ORDER     {CblasRowMajor=101, CblasColMajor=102} CBLAS_ORDER;
+typedef enum CBLAS_TRANSPOSE {CblasNoTrans=111, CblasTrans=112, CblasConjTrans=113, CblasConjNoTrans=114} CBLAS_TRANSPOSE;
+
+/*** Batched GEMM (base pointer plus stride) ***/
+void cblas_sgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA, const enum CBLAS_TRANSPOSE TransB,
+		       const blasint M, const blasint N, const blasint K,
+		       const float alpha, const float *A, const blasint lda, const blasint stridea, const float *B, const blasint ldb, const blasint strideb,
+		       const float beta, float *C, const blasint ldc, const blasint stridec, const blasint batch_size);
+void cblas_dgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA, const enum CBLAS_TRANSPOSE TransB,
+		       const blasint M, const blasint N, const blasint K,
+		       const double alpha, const double *A, const blasint lda, const blasint stridea, const double *B, const blasint ldb, const blasint strideb,
+		       const double beta, double *C, const blasint ldc, const blasint stridec, const blasint batch_size);
+void cblas_cgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA, const enum CBLAS_TRANSPOSE TransB,
+		       const blasint M, const blasint N, const blasint K,
+		       const void *alpha, const void *A, const blasint lda, const blasint stridea, const void *B, const blasint ldb, const blasint strideb,
+		       const void *beta, void *C, const blasint ldc, const blasint stridec, const blasint batch_size);
+void cblas_zgemm_batch_strided(const enum CBLAS_ORDER Order, const enum CBLAS_TRANSPOSE TransA, const enum CBLAS_TRANSPOSE TransB,
+		       const blasint M, const blasint N, const blasint K,
+		       const void *alpha, const void *A, const blasint lda, const blasint stridea, const void *B, const blasint ldb, const blasint strideb,
+		       const void *beta, void *C, const blasint ldc, const blasint stridec, const blasint batch_size);
@@ -0,0 +1,59 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\AutotunerTest;
+
+use PHPUnit\Framework\TestCase;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use Rindow\OpenBLAS\FFI\Autotuner;
+use Rindow\OpenBLAS\FFI\PerformanceProfile;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class AutotunerTest extends TestCase
+{
+    use Utils;
+
+    protected string $path;
+
+    public function setUp() : void
+    {
+        $this->factory = new OpenBLASFactory();
+        $this->path = sys_get_temp_dir().'/rindow-openblas-autotune-'.getmypid().'.json';
+        @unlink($this->path);
+    }
+
+    public function tearDown() : void
+    {
+        @unlink($this->path);
+    }
+
+    public function testRunTiny()
+    {
+        $blas = $this->getBlas();
+        if(!$blas->hasCapability('openblas')) {
+            $this->markTestSkipped('The autotuner needs OpenBLAS.');
+        }
+        $threads = $blas->getNumThreads();
+        $messages = [];
+        $tuner = new Autotuner($this->factory, repeat:1,
+            logger:function(string $message) use (&$messages) { $messages[] = $message; },
+            maxSize:8);
+        $key = $tuner->key();
+        $this->assertEquals(PerformanceProfile::key($blas->getCorename(),$blas->getConfig()),$key);
+
+        $profile = $tuner->run();
+        // the tuner leaves the thread count as it was
+        $this->assertEquals($threads,$blas->getNumThreads());
+        $this->assertNotEmpty($messages);
+        $this->assertMatchesRegularExpression('/sgemm\(8\)/',implode("\n",$messages));
+
+        PerformanceProfile::save($this->path,$key,$profile);
+        $saved = PerformanceProfile::load($this->path,$key);
+        $this->assertEquals($profile->toArray(),$saved->toArray());
+        $this->assertEquals(array_keys(PerformanceProfile::DEFAULTS),array_keys($saved->toArray()));
+        $this->assertGreaterThanOrEqual(0,$saved->getInt('num_threads'));
+        $this->assertGreaterThanOrEqual(0,$saved->getInt('gemm3m_min_size'));
+        $this->assertGreaterThanOrEqual(0,$saved->getInt('omatcopy_transpose_min_size'));
+        $this->assertContains($saved->get('lapack'),['lapack','lapacke']);
+    }
+}
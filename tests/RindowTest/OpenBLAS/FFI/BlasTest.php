@@ -10,7 +10,9 @@ use Interop\Polite\Math\Matrix\BLAS;
 use Rindow\Math\Matrix\MatrixOperator;
 use Rindow\OpenBLAS\FFI\Blas as OpenBLAS;
 use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use Rindow\OpenBLAS\FFI\SuffixedFFI;
 use InvalidArgumentException;
+use RuntimeException;
 use TypeError;
 use FFI;
 
@@ -830,6 +832,43 @@ class BlasTest extends TestCase
         );
     }
 
+    public function testIsIlp64()
+    {
+        $blas = $this->getBlas();
+        $s = $blas->getConfig();
+
+        $this->assertEquals(
+            strpos($s,'USE64BITINT')!==false,
+            $this->factory->isIlp64()
+        );
+    }
+
+    public function testCapabilities()
+    {
+        $blas = $this->getBlas();
+        $capabilities = $this->factory->capabilities();
+
+        foreach(array_keys(OpenBLASFactory::CAPABILITY_SYMBOLS) as $name) {
+            $this->assertArrayHasKey($name,$capabilities);
+        }
+        $this->assertEquals($capabilities['iamin'],$blas->hasIamin());
+        $this->assertEquals($capabilities['omatcopy'],$blas->hasOmatcopy());
+        $this->assertEquals(
+            strpos($blas->getConfig(),'vecLib')!==0,
+            $blas->hasCapability('openblas')
+        );
+    }
+
+    public function testLoadStatus()
+    {
+        $blas = $this->getBlas();
+        $status = $this->factory->loadStatus();
+
+        $this->assertTrue($status['blas']['loaded']);
+        $this->assertIsFloat($status['blas']['seconds']);
+        $this->assertEquals([],$status['blas']['errors']);
+    }
+
     public function testGetCorename()
     {
         $blas = $this->getBlas();
@@ -856,6 +895,27 @@ class BlasTest extends TestCase
         $this->assertTrue($cval instanceof FFI\CData);
     }
 
+    public function testComplexRotgWithoutAnyInterface()
+    {
+        // neither cblas_crotg nor crotg_ is declared
+        $blas = new OpenBLAS(FFI::cdef(''),capabilities:['crotg'=>false]);
+        $A = $this->array([1],dtype:NDArray::complex64)->buffer();
+        $this->expectException(RuntimeException::class);
+        $this->expectExceptionMessage('The BLAS library exports neither cblas_crotg nor crotg_.');
+        $blas->rotg($A,0,$A,0,$A,0,$A,0);
+    }
+
+    public function testSuffixedFFI()
+    {
+        $ffi = new SuffixedFFI(FFI::cdef('int abs(int x);'),'');
+        $this->assertEquals(3,$ffi->abs(-3));
+        $values = $ffi->new('int[2]');
+        // a temporary pointer can be cast
+        $first = $ffi->cast('uintptr_t',FFI::addr($values[0]))->cdata;
+        $second = $ffi->cast('uintptr_t',FFI::addr($values[1]))->cdata;
+        $this->assertEquals(FFI::sizeof($ffi->type('int')),$second-$first);
+    }
+
     public function testScalNormal()
     {
         $blas = $this->getBlas();
@@ -1247,6 +1307,132 @@ class BlasTest extends TestCase
         $blas->axpy($N,$alpha,$XX,$offX,$incX,$YY,$offY,$incY);
     }
 
+    public function testAxpbyNormal()
+    {
+        $blas = $this->getBlas();
+
+        // float32
+        $X = $this->array([1,2,3],dtype:NDArray::float32);
+        $Y = $this->array([10,20,30],dtype:NDArray::float32);
+        $blas->axpby(3,2,$X->buffer(),0,1,0.5,$Y->buffer(),0,1);
+        $this->assertEquals([7,14,21],$Y->toArray());
+
+        if(!$this->notSupportComplex()) {
+            // complex64
+            $X = $this->array([C(1),C(2),C(3)],dtype:NDArray::complex64);
+            $Y = $this->array([C(10),C(20),C(30)],dtype:NDArray::complex64);
+            $blas->axpby(3,C(2),$X->buffer(),0,1,C(0.5),$Y->buffer(),0,1);
+            $this->assertEquals($this->toComplex([7,14,21]),$this->toComplex($Y->toArray()));
+        }
+
+        if($this->fp64()) {
+            // float64
+            $X = $this->array([1,2,3],dtype:NDArray::float64);
+            $Y = $this->array([10,20,30],dtype:NDArray::float64);
+            $blas->axpby(3,2,$X->buffer(),0,1,0.5,$Y->buffer(),0,1);
+            $this->assertEquals([7,14,21],$Y->toArray());
+        }
+    }
+
+    public function testDeferredBlasScalAxpy()
+    {
+        $blas = $this->factory->DeferredBlas();
+
+        $X = $this->array([1,2,3],dtype:NDArray::float32);
+        $Y = $this->array([10,20,30],dtype:NDArray::float32);
+        $blas->scal(3,2.0,$Y->buffer(),0,1);
+        $blas->axpy(3,1.0,$X->buffer(),0,1,$Y->buffer(),0,1);
+        $blas->scal(3,0.5,$Y->buffer(),0,1);
+
+        $this->assertEquals(3,$blas->pending());
+        $this->assertEquals([10,20,30],$Y->toArray());
+        // scal + axpy + scal => axpby
+        $this->assertEquals(1,$blas->flush());
+        $this->assertEquals(0,$blas->pending());
+        $this->assertEquals([10.5,21,31.5],$Y->toArray());
+
+        // other methods see the recorded operations
+        $blas->scal(3,2.0,$X->buffer(),0,1);
+        $this->assertEquals(4+16+36,$blas->dot(3,$X->buffer(),0,1,$X->buffer(),0,1));
+        $this->assertEquals(0,$blas->pending());
+    }
+
+    public function testDeferredBlasDestructorDropsRecordedOperations()
+    {
+        $log = tempnam(sys_get_temp_dir(),'rindow-openblas-log');
+        $saved = ini_set('error_log',$log);
+        try {
+            $blas = $this->factory->DeferredBlas();
+            $X = $this->array([1,2,3],dtype:NDArray::float32);
+            $blas->scal(3,2.0,$X->buffer(),0,1);
+            $blas->scal(3,2.0,$X->buffer(),0,1);
+            unset($blas);
+            $this->assertEquals([1,2,3],$X->toArray());
+            $this->assertStringContainsString(
+                'DeferredBlas destroyed without flush(). 2 recorded operations were dropped.',
+                file_get_contents($log));
+
+            $blas = $this->factory->DeferredBlas();
+            $blas->scal(3,2.0,$X->buffer(),0,1);
+            $this->assertEquals(1,$blas->discard());
+            $this->assertEquals(0,$blas->flush());
+            $this->assertEquals([1,2,3],$X->toArray());
+        } finally {
+            ini_set('error_log',$saved===false ? '' : $saved);
+            @unlink($log);
+        }
+    }
+
+    public function testDeferredBlasCopyGemm()
+    {
+        $blas = $this->factory->DeferredBlas();
+
+        $A = $this->array([[1,2],[3,4]],dtype:NDArray::float32);
+        $B = $this->array([[1,0],[0,1]],dtype:NDArray::float32);
+        $C = $this->array([[9,9],[9,9]],dtype:NDArray::float32);
+        $D = $this->array([[5,6],[7,8]],dtype:NDArray::float32);
+        $blas->copy(4,$D->buffer(),0,1,$C->buffer(),0,1);
+        $blas->gemm(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,2,
+            1.0,$A->buffer(),0,2,$B->buffer(),0,2,0.0,$C->buffer(),0,2);
+        $blas->scal(4,2.0,$C->buffer(),0,1);
+
+        // the copy is overwritten and the scal is folded into alpha
+        $this->assertEquals(1,$blas->flush());
+        $this->assertEquals([[2,4],[6,8]],$C->toArray());
+    }
+
+    public function testDeferredBlasGemvBatch()
+    {
+        $blas = $this->factory->DeferredBlas();
+
+        $A = $this->array([[1,2,3],[4,5,6]],dtype:NDArray::float32);
+        $X = $this->array([[1,0,0],[0,1,0],[1,1,1]],dtype:NDArray::float32);
+        $Y = $this->array([[1,1],[1,1],[1,1]],dtype:NDArray::float32);
+        for($i=0;$i<3;$i++) {
+            $blas->gemv(BLAS::RowMajor,BLAS::NoTrans,2,3,
+                1.0,$A->buffer(),0,3,$X->buffer(),$i*3,1,1.0,$Y->buffer(),$i*2,1);
+        }
+        // folded into one gemm
+        $this->assertEquals(1,$blas->flush());
+        $this->assertEquals([[2,5],[3,6],[7,16]],$Y->toArray());
+
+        $Z = $this->array([[0,0,0],[0,0,0]],dtype:NDArray::float32);
+        for($i=0;$i<2;$i++) {
+            $blas->gemv(BLAS::RowMajor,BLAS::Trans,2,3,
+                1.0,$A->buffer(),0,3,$Y->buffer(),$i*2,1,0.0,$Z->buffer(),$i*3,1);
+        }
+        $this->assertEquals(1,$blas->flush());
+        $this->assertEquals([[22,29,36],[27,36,45]],$Z->toArray());
+
+        // the output of a gemv is the input of the next one
+        $blas->gemv(BLAS::RowMajor,BLAS::NoTrans,2,2,
+            1.0,$A->buffer(),0,3,$Y->buffer(),0,1,0.0,$Y->buffer(),2,1);
+        $blas->gemv(BLAS::RowMajor,BLAS::NoTrans,2,2,
+            1.0,$A->buffer(),0,3,$Y->buffer(),2,1,0.0,$Y->buffer(),4,1);
+        $this->assertEquals(2,$blas->flush());
+        $this->assertEquals([[2,5],[12,33],[78,213]],$Y->toArray());
+    }
+
     public function testDotNormal()
     {
         $blas = $this->getBlas();
@@ -2755,6 +2941,153 @@ class BlasTest extends TestCase
         }
     }
 
+    #[DataProvider('providerDtypesFloats')]
+    public function testDotStridedBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        // packed
+        $X = $this->array([[1,2,3],[4,5,6]],dtype:$dtype);
+        $Y = $this->array([[1,1,1],[2,0,1]],dtype:$dtype);
+        $R = $this->zeros([2],dtype:$dtype);
+        $blas->dotStridedBatch(
+            3,
+            $X->buffer(),$X->offset(),1,3,
+            $Y->buffer(),$Y->offset(),1,3,
+            $R->buffer(),$R->offset(),1,
+            2);
+        $this->assertEquals([6,14],$R->toArray());
+
+        // longer vectors grow the cached ones and scratch
+        $X = $this->array([[1,2,3,4,5],[1,1,1,1,1]],dtype:$dtype);
+        $R = $this->zeros([2],dtype:$dtype);
+        $blas->dotStridedBatch(
+            5,
+            $X->buffer(),$X->offset(),1,5,
+            $X->buffer(),$X->offset(),1,5,
+            $R->buffer(),$R->offset(),1,
+            2);
+        $this->assertEquals([55,5],$R->toArray());
+
+        // columns of a matrix
+        $X = $this->array([[1,4],[2,5],[3,6]],dtype:$dtype);
+        $Y = $this->array([[1,2],[1,0],[1,1]],dtype:$dtype);
+        $R = $this->zeros([2],dtype:$dtype);
+        $blas->dotStridedBatch(
+            3,
+            $X->buffer(),$X->offset(),2,1,
+            $Y->buffer(),$Y->offset(),2,1,
+            $R->buffer(),$R->offset(),1,
+            2);
+        $this->assertEquals([6,14],$R->toArray());
+    }
+
+    public function testDotStridedBatchOverflowBufferY()
+    {
+        $blas = $this->getBlas();
+        $X = $this->zeros([2,3]);
+        $Y = $this->zeros([5]);
+        $R = $this->zeros([2]);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Vector specification too large for bufferY.');
+        $blas->dotStridedBatch(
+            3,
+            $X->buffer(),$X->offset(),1,3,
+            $Y->buffer(),$Y->offset(),1,3,
+            $R->buffer(),$R->offset(),1,
+            2);
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testNrm2StridedBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        $X = $this->array([[3,4],[6,8],[0,5]],dtype:$dtype);
+        $R = $this->zeros([3],dtype:$dtype);
+        $blas->nrm2StridedBatch(
+            2,
+            $X->buffer(),$X->offset(),1,2,
+            $R->buffer(),$R->offset(),1,
+            3);
+        $this->assertTrue($this->isclose($R,$this->array([5,10,5],dtype:$dtype)));
+    }
+
+    public function testNrm2StridedBatchOutOfSquareRange()
+    {
+        $blas = $this->getBlas();
+
+        // the squares of 3e20 overflow and those of 3e-25 underflow in float32
+        $X = $this->array([[3e20,4e20],[3e-25,4e-25],[3,4]],dtype:NDArray::float32);
+        $R = $this->zeros([3],dtype:NDArray::float32);
+        $blas->nrm2StridedBatch(
+            2,
+            $X->buffer(),0,1,2,
+            $R->buffer(),0,1,
+            3);
+        $r = $R->toArray();
+        $this->assertEqualsWithDelta(5e20,$r[0],5e14);
+        $this->assertEqualsWithDelta(5e-25,$r[1],5e-31);
+        $this->assertEqualsWithDelta(5.0,$r[2],1e-6);
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testAxpyStridedBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        // packed
+        $X = $this->array([[1,2],[3,4]],dtype:$dtype);
+        $Y = $this->array([[10,20],[30,40]],dtype:$dtype);
+        $blas->axpyStridedBatch(
+            2,
+            2.0,
+            $X->buffer(),$X->offset(),1,2,
+            $Y->buffer(),$Y->offset(),1,2,
+            2);
+        $this->assertEquals([[12,24],[36,48]],$Y->toArray());
+
+        // leading two columns of each row
+        $X = $this->array([[1,2,9],[3,4,9]],dtype:$dtype);
+        $Y = $this->array([[10,20,0],[30,40,0]],dtype:$dtype);
+        $blas->axpyStridedBatch(
+            2,
+            2.0,
+            $X->buffer(),$X->offset(),1,3,
+            $Y->buffer(),$Y->offset(),1,3,
+            2);
+        $this->assertEquals([[12,24,0],[36,48,0]],$Y->toArray());
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testScalStridedBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        // leading two columns of each row
+        $X = $this->array([[1,2,9],[3,4,9]],dtype:$dtype);
+        $blas->scalStridedBatch(
+            2,
+            2.0,
+            $X->buffer(),$X->offset(),1,3,
+            2);
+        $this->assertEquals([[2,4,9],[6,8,9]],$X->toArray());
+
+        // every other element
+        $X = $this->array([[1,2,3,4],[5,6,7,8]],dtype:$dtype);
+        $blas->scalStridedBatch(
+            2,
+            2.0,
+            $X->buffer(),$X->offset(),2,4,
+            2);
+        $this->assertEquals([[2,2,6,4],[10,6,14,8]],$X->toArray());
+    }
+
     public function testGemvNormal()
     {
         $blas = $this->getBlas();
@@ -5557,6 +5890,124 @@ class BlasTest extends TestCase
             $CC,$offC,$ldc);
     }
 
+    #[DataProvider('providerDtypesFloats')]
+    public function testGemmBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        $A0 = $this->array([[1,2,3],[4,5,6]],dtype:$dtype);
+        $B0 = $this->array([[1,0],[0,1],[1,1]],dtype:$dtype);
+        $C0 = $this->ones([2,2],dtype:$dtype);
+        $A1 = $this->array([[1,1,1],[2,2,2]],dtype:$dtype);
+        $B1 = $this->array([[1,2],[3,4],[5,6]],dtype:$dtype);
+        $C1 = $this->ones([2,2],dtype:$dtype);
+
+        $blas->gemmBatch(
+            BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,
+            2,2,3,
+            1.0,
+            [$A0->buffer(),$A1->buffer()],[$A0->offset(),$A1->offset()],3,
+            [$B0->buffer(),$B1->buffer()],[$B0->offset(),$B1->offset()],2,
+            0.0,
+            [$C0->buffer(),$C1->buffer()],[$C0->offset(),$C1->offset()],2);
+
+        $this->assertEquals([[4,5],[10,11]],$C0->toArray());
+        $this->assertEquals([[9,12],[18,24]],$C1->toArray());
+    }
+
+    public function testGemmBatchUnmatchBatchCount()
+    {
+        $blas = $this->getBlas();
+        $A = $this->array([[1,2],[3,4]]);
+        $B = $this->array([[1,2],[3,4]]);
+        $C = $this->zeros([2,2]);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unmatch batch count for A and B and C');
+        $blas->gemmBatch(
+            BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,
+            2,2,2,
+            1.0,
+            [$A->buffer(),$A->buffer()],[0,0],2,
+            [$B->buffer()],[0],2,
+            0.0,
+            [$C->buffer(),$C->buffer()],[0,0],2);
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testGemmStridedBatchNormal($params)
+    {
+        extract($params);
+        $blas = $this->getBlas();
+
+        $A = $this->array([
+            [[1,2,3],[4,5,6]],
+            [[1,1,1],[2,2,2]],
+        ],dtype:$dtype);
+        $B = $this->array([
+            [[1,0],[0,1],[1,1]],
+            [[1,2],[3,4],[5,6]],
+        ],dtype:$dtype);
+        $C = $this->ones([2,2,2],dtype:$dtype);
+
+        $blas->gemmStridedBatch(
+            BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,
+            2,2,3,
+            1.0,
+            $A->buffer(),$A->offset(),3,6,
+            $B->buffer(),$B->offset(),2,6,
+            0.0,
+            $C->buffer(),$C->offset(),2,4,
+            2);
+
+        $this->assertEquals([
+            [[4,5],[10,11]],
+            [[9,12],[18,24]],
+        ],$C->toArray());
+    }
+
+    public function testGemmStridedBatchOutputOverFlow()
+    {
+        $blas = $this->getBlas();
+        $A = $this->zeros([3,2,3]);
+        $B = $this->zeros([3,3,2]);
+        $C = $this->zeros([2,2,2]);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Matrix specification too large for bufferC');
+        $blas->gemmStridedBatch(
+            BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,
+            2,2,3,
+            1.0,
+            $A->buffer(),$A->offset(),3,6,
+            $B->buffer(),$B->offset(),2,6,
+            0.0,
+            $C->buffer(),$C->offset(),2,4,
+            3);
+    }
+
+    public function testGemmStridedBatchOverlappingOutputs()
+    {
+        $blas = $this->getBlas();
+        $A = $this->zeros([3,2,3]);
+        $B = $this->zeros([3,3,2]);
+        $C = $this->zeros([3,2,2]);
+
+        // a 2x2 C with ldC=2 takes 4 elements, so a stride of 3 overlaps
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Argument strideC must be greater than or equal 4.');
+        $blas->gemmStridedBatch(
+            BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,
+            2,2,3,
+            1.0,
+            $A->buffer(),$A->offset(),3,6,
+            $B->buffer(),$B->offset(),2,6,
+            0.0,
+            $C->buffer(),$C->offset(),2,3,
+            3);
+    }
+
     public function testSymmNormal()
     {
         $blas = $this->getBlas();
@@ -7581,4 +8032,224 @@ class BlasTest extends TestCase
         }
     }
 
+    protected function permuteExpected(array $shape, array $perm) : array
+    {
+        $ndim = count($shape);
+        $shapeY = array_map(fn($p)=>$shape[$p], $perm);
+        $expected = [];
+        for($j=0; $j<array_product($shape); $j++) {
+            $rest = $j;
+            $indexY = [];
+            for($i=$ndim-1; $i>=0; $i--) {
+                $indexY[$i] = $rest % $shapeY[$i];
+                $rest = intdiv($rest, $shapeY[$i]);
+            }
+            $indexX = [];
+            foreach($perm as $i => $p) {
+                $indexX[$p] = $indexY[$i];
+            }
+            $pos = 0;
+            for($i=0; $i<$ndim; $i++) {
+                $pos = $pos*$shape[$i] + $indexX[$i];
+            }
+            $expected[] = $pos;
+        }
+        return $expected;
+    }
+
+    public function testPermute()
+    {
+        $blas = $this->getBlas();
+
+        $cases = [
+            [[2,3,4,5], [0,2,3,1]],     // NCHW -> NHWC
+            [[2,3,4,5], [3,1,0,2]],
+            [[6,7], [1,0]],
+            [[2,3,4], [0,1,2]],
+        ];
+        foreach([NDArray::float32, NDArray::float64, NDArray::int32] as $dtype) {
+            foreach($cases as [$shape, $perm]) {
+                $size = array_product($shape);
+                $X = $this->array(range(0,$size-1),dtype:$dtype);
+                $Y = $this->zeros([$size],dtype:$dtype);
+                $blas->permute($shape,$perm,$X->buffer(),0,$Y->buffer(),0);
+                $this->assertEquals($this->permuteExpected($shape,$perm),$Y->toArray());
+            }
+        }
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Argument perm must be a permutation of the axes.');
+        $blas->permute([2,3],[1,1],$X->buffer(),0,$Y->buffer(),0);
+    }
+
+    public function testCopyStrided()
+    {
+        $blas = $this->getBlas();
+
+        // X[1:3, 0:5:2] of a 4x5 matrix
+        $X = $this->array(range(0,19),dtype:NDArray::float32);
+        $Y = $this->zeros([2,3],dtype:NDArray::float32);
+        $blas->copyStrided([2,3],$X->buffer(),5,[5,2],$Y->buffer(),0,[3,1]);
+        $this->assertEquals([[5,7,9],[10,12,14]],$Y->toArray());
+
+        // into the columns of a 3x2 matrix
+        $Y = $this->zeros([3,2],dtype:NDArray::float32);
+        $blas->copyStrided([2,3],$X->buffer(),5,[5,2],$Y->buffer(),0,[1,2]);
+        $this->assertEquals([[5,10],[7,12],[9,14]],$Y->toArray());
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Strided specification too large for bufferX.');
+        $blas->copyStrided([2,3],$X->buffer(),11,[5,2],$Y->buffer(),0,[1,2]);
+    }
+
+    public function testGemmInt8Int32()
+    {
+        $blas = $this->getBlas();
+
+        $A = $this->array([[1,-2,3],[-4,5,-6]],dtype:NDArray::int8);
+        $B = $this->array([[1,2],[3,4],[5,-128]],dtype:NDArray::int8);
+        $C = $this->zeros([2,2],dtype:NDArray::int32);
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,3,
+            $A->buffer(),0,3,$B->buffer(),0,2,$C->buffer(),0,2);
+        $this->assertEquals([[10,-390],[-19,780]],$C->toArray());
+
+        // ColMajor: B is a 2x3 and AT a 2x3 matrix in column major
+        $AT = $this->array([[1,-4],[-2,5],[3,-6]],dtype:NDArray::int8);
+        $C = $this->zeros([2,2],dtype:NDArray::int32);
+        $blas->gemmInt8(BLAS::ColMajor,BLAS::NoTrans,BLAS::Trans,2,2,3,
+            $B->buffer(),0,2,$AT->buffer(),0,2,$C->buffer(),0,2);
+        $this->assertEquals([[10,-390],[-19,780]],$C->toArray());
+
+        $X = $this->zeros([2,2],dtype:NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('BufferA must be int8 or uint8.');
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,2,
+            $X->buffer(),0,2,$X->buffer(),0,2,$C->buffer(),0,2);
+    }
+
+    public function testGemmInt8ZeroPointAndScale()
+    {
+        $blas = $this->getBlas();
+
+        // u8 x s8 with a zero point for each row of A and column of B
+        $A = $this->array([[130,128],[126,129]],dtype:NDArray::uint8);
+        $B = $this->array([[1,2],[3,4]],dtype:NDArray::int8);
+        $za = $this->array([128,127],dtype:NDArray::int32);
+        $zb = $this->array([1,0],dtype:NDArray::int32);
+        $C = $this->zeros([2,2],dtype:NDArray::int32);
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,2,
+            $A->buffer(),0,2,$B->buffer(),0,2,$C->buffer(),0,2,
+            $za->buffer(),0,$zb->buffer(),0);
+        // (A-za) = [[2,0],[-1,2]], (B-zb) = [[0,2],[2,4]]
+        $this->assertEquals([[0,4],[4,6]],$C->toArray());
+
+        $sa = $this->array([0.5,2.0],dtype:NDArray::float32);
+        $sb = $this->array([1.0,0.25],dtype:NDArray::float32);
+        $Y = $this->zeros([2,2],dtype:NDArray::float32);
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,2,
+            $A->buffer(),0,2,$B->buffer(),0,2,$Y->buffer(),0,2,
+            $za->buffer(),0,$zb->buffer(),0,$sa->buffer(),0,$sb->buffer(),0);
+        $this->assertEquals([[0,0.5],[8,3]],$Y->toArray());
+    }
+
+    public function testGemmInt8Blocked()
+    {
+        $blas = $this->getBlas();
+
+        // more rows than one panel of op(A): A is s8 m x k and B is
+        // u8 n x k, used transposed
+        $m = 129; $n = 130; $k = 257;
+        $a = []; $b = [];
+        for($i=0; $i<$m; $i++) {
+            for($p=0; $p<$k; $p++) {
+                $a[$i][$p] = ($i*7+$p*3)%256-128;
+            }
+        }
+        for($j=0; $j<$n; $j++) {
+            for($p=0; $p<$k; $p++) {
+                $b[$j][$p] = ($j*5+$p*11)%256;
+            }
+        }
+        $za = []; $sa = [];
+        for($i=0; $i<$m; $i++) {
+            $za[] = $i%5-2;
+            $sa[] = 0.5+($i%3);
+        }
+        $zb = []; $sb = [];
+        for($j=0; $j<$n; $j++) {
+            $zb[] = 128-$j%4;
+            $sb[] = 0.25*(1+$j%2);
+        }
+        $expected = []; $scaled = [];
+        for($i=0; $i<$m; $i++) {
+            for($j=0; $j<$n; $j++) {
+                $sum = 0;
+                for($p=0; $p<$k; $p++) {
+                    $sum += ($a[$i][$p]-$za[$i])*($b[$j][$p]-$zb[$j]);
+                }
+                $expected[$i][$j] = $sum;
+                $scaled[$i][$j] = $sum*$sa[$i]*$sb[$j];
+            }
+        }
+        $A = $this->array($a,dtype:NDArray::int8);
+        $B = $this->array($b,dtype:NDArray::uint8);
+        $ZA = $this->array($za,dtype:NDArray::int32);
+        $ZB = $this->array($zb,dtype:NDArray::int32);
+        $C = $this->zeros([$m,$n],dtype:NDArray::int32);
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::Trans,$m,$n,$k,
+            $A->buffer(),0,$k,$B->buffer(),0,$k,$C->buffer(),0,$n,
+            $ZA->buffer(),0,$ZB->buffer(),0);
+        $this->assertEquals($expected,$C->toArray());
+
+        // float64 is accumulated in place, here with ldC > n
+        $SA = $this->array($sa,dtype:NDArray::float64);
+        $SB = $this->array($sb,dtype:NDArray::float64);
+        $Y = $this->zeros([$m,$n+1],dtype:NDArray::float64);
+        $blas->gemmInt8(BLAS::RowMajor,BLAS::NoTrans,BLAS::Trans,$m,$n,$k,
+            $A->buffer(),0,$k,$B->buffer(),0,$k,$Y->buffer(),0,$n+1,
+            $ZA->buffer(),0,$ZB->buffer(),0,$SA->buffer(),0,$SB->buffer(),0);
+        $y = $Y->toArray();
+        for($i=0; $i<$m; $i++) {
+            $this->assertEquals(0.0,$y[$i][$n]);
+            $this->assertEquals($scaled[$i],array_slice($y[$i],0,$n));
+        }
+    }
+
+    public function testQuantizeDequantize()
+    {
+        $blas = $this->getBlas();
+
+        $X = $this->array([[0.1,-0.5,2.0],[1.0,3.0,-1.0]],dtype:NDArray::float32);
+        $scale = $this->array([0.1,0.01],dtype:NDArray::float32);
+        $Q = $this->zeros([2,3],dtype:NDArray::int8);
+        $blas->quantize(2,3,$X->buffer(),0,3,$scale->buffer(),0,null,0,$Q->buffer(),0,3);
+        // clamped to [-128,127]
+        $this->assertEquals([[1,-5,20],[100,127,-100]],$Q->toArray());
+
+        $Y = $this->zeros([2,3],dtype:NDArray::float32);
+        $blas->dequantize(2,3,$Q->buffer(),0,3,$scale->buffer(),0,null,0,$Y->buffer(),0,3);
+        $this->assertTrue($this->isclose($this->array([[0.1,-0.5,2.0],[1.0,1.27,-1.0]]),$Y));
+
+        // uint8 with a zero point for each column
+        $scale = $this->array([0.5,1.0,0.1],dtype:NDArray::float32);
+        $zp = $this->array([128,0,10],dtype:NDArray::int32);
+        $U = $this->zeros([2,3],dtype:NDArray::uint8);
+        $blas->quantize(2,3,$X->buffer(),0,3,$scale->buffer(),0,$zp->buffer(),0,$U->buffer(),0,3,perColumn:true);
+        $this->assertEquals([[128,0,30],[130,3,0]],$U->toArray());
+        $blas->dequantize(2,3,$U->buffer(),0,3,$scale->buffer(),0,$zp->buffer(),0,$Y->buffer(),0,3,perColumn:true);
+        $this->assertTrue($this->isclose($this->array([[0.0,0.0,2.0],[1.0,3.0,-1.0]]),$Y));
+    }
+
+    public function testQuantizeZeroScale()
+    {
+        $blas = $this->getBlas();
+
+        $X = $this->array([[0.1,-0.5],[1.0,3.0]],dtype:NDArray::float32);
+        $scale = $this->array([0.1,0.0],dtype:NDArray::float32);
+        $Q = $this->zeros([2,2],dtype:NDArray::int8);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('scale must be finite and non-zero.');
+        $blas->quantize(2,2,$X->buffer(),0,2,$scale->buffer(),0,null,0,$Q->buffer(),0,2);
+    }
+
 }
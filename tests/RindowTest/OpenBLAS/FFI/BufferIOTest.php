@@ -0,0 +1,98 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\BufferIOTest;
+
+use PHPUnit\Framework\TestCase;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\BufferIO;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use InvalidArgumentException;
+use RuntimeException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class BufferIOTest extends TestCase
+{
+    use Utils;
+
+    protected string $path;
+
+    public function setUp() : void
+    {
+        $this->factory = new OpenBLASFactory();
+        $this->path = sys_get_temp_dir().'/rindow-openblas-io-'.getmypid().'.bin';
+    }
+
+    public function tearDown() : void
+    {
+        if(file_exists($this->path)) {
+            unlink($this->path);
+        }
+    }
+
+    public function testRaw()
+    {
+        $io = new BufferIO();
+        file_put_contents($this->path, pack('g*',1,2,3,4,5,6));
+        $X = $this->zeros([8],dtype:NDArray::float32);
+        $this->assertEquals(6,$io->readRaw($this->path,$X->buffer(),1));
+        $this->assertEquals([0,1,2,3,4,5,6,0],$X->toArray());
+
+        // part of the file
+        $X = $this->zeros([2],dtype:NDArray::float32);
+        $this->assertEquals(2,$io->readRaw($this->path,$X->buffer(),0,2,fileOffset:8));
+        $this->assertEquals([3,4],$X->toArray());
+
+        // big endian
+        file_put_contents($this->path, pack('E*',1.5,-2.0,3.25));
+        $X = $this->zeros([3],dtype:NDArray::float64);
+        $io->readRaw($this->path,$X->buffer(),bigEndian:true);
+        $this->assertEquals([1.5,-2.0,3.25],$X->toArray());
+
+        $X = $this->array([1,-2,300],dtype:NDArray::int32);
+        $io->writeRaw($this->path,$X->buffer(),bigEndian:true);
+        $io->writeRaw($this->path,$X->buffer(),2,1,append:true);
+        $this->assertEquals(pack('N*',1,-2,300).pack('V',300),file_get_contents($this->path));
+
+        $X = $this->zeros([2],dtype:NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Buffer size is too small for 3 elements.');
+        $io->readRaw($this->path,$X->buffer(),0,3);
+    }
+
+    public function testNpy()
+    {
+        $io = new BufferIO();
+        $X = $this->array([[1,2,3],[4,5,6]],dtype:NDArray::float64);
+        $io->saveNpy($this->path,$X->buffer(),0,[2,3]);
+        $data = file_get_contents($this->path);
+        $this->assertStringStartsWith("\x93NUMPY\x01\x00",$data);
+        $this->assertStringContainsString("{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }",$data);
+        $this->assertEquals(0,(strlen($data)-6*8)%64);
+
+        $header = $io->npyHeader($this->path);
+        $this->assertEquals(NDArray::float64,$header['dtype']);
+        $this->assertEquals([2,3],$header['shape']);
+        $this->assertFalse($header['fortranOrder']);
+        $this->assertEquals(strlen($data)-6*8,$header['dataOffset']);
+
+        $Y = $this->zeros([6],dtype:NDArray::float64);
+        $io->loadNpy($this->path,$Y->buffer());
+        $this->assertEquals([1,2,3,4,5,6],$Y->toArray());
+
+        // a version 2 file of big-endian int16
+        $dict = "{'descr': '>i2', 'fortran_order': True, 'shape': (3,), }\n";
+        file_put_contents($this->path,"\x93NUMPY\x02\x00".pack('V',strlen($dict)).$dict.pack('n*',1,2,0xfffd));
+        $Z = $this->zeros([3],dtype:NDArray::int16);
+        $header = $io->loadNpy($this->path,$Z->buffer());
+        $this->assertEquals([3],$header['shape']);
+        $this->assertTrue($header['fortranOrder']);
+        $this->assertTrue($header['bigEndian']);
+        $this->assertEquals([1,2,-3],$Z->toArray());
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unmatch data type');
+        $io->loadNpy($this->path,$Y->buffer());
+    }
+}
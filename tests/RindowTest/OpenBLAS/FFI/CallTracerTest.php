@@ -0,0 +1,114 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\CallTracerTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use Rindow\OpenBLAS\FFI\CallTracer;
+use Rindow\OpenBLAS\FFI\CallReplayer;
+use Rindow\OpenBLAS\FFI\TracedBlas;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class CallTracerTest extends TestCase
+{
+    use Utils;
+
+    protected string $path;
+
+    public function setUp() : void
+    {
+        $this->factory = new OpenBLASFactory();
+        $this->path = sys_get_temp_dir().'/rindow-openblas-trace-'.getmypid().'.jsonl';
+    }
+
+    public function tearDown() : void
+    {
+        if(file_exists($this->path)) {
+            unlink($this->path);
+        }
+    }
+
+    protected function traceCalls() : void
+    {
+        $tracer = new CallTracer($this->path);
+        $blas = $this->factory->TracedBlas($tracer);
+        $this->assertInstanceOf(TracedBlas::class,$blas);
+
+        $A = $this->array([[1,2,3],[4,5,6]],dtype:NDArray::float32);
+        $B = $this->array([[1,0],[0,1],[1,1]],dtype:NDArray::float32);
+        $C = $this->zeros([2,2],dtype:NDArray::float32);
+        $blas->gemm(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,3,
+            1.0,$A->buffer(),0,3,$B->buffer(),0,2,0.0,$C->buffer(),0,2);
+        $this->assertEquals([[4,5],[10,11]],$C->toArray());
+
+        // the same buffer twice
+        $X = $this->array([1,2,3],dtype:NDArray::float64);
+        $blas->axpy(3,2.0,$X->buffer(),0,1,$X->buffer(),0,1);
+        $this->assertEquals([3,6,9],$X->toArray());
+
+        // the copies made inside permute are not written
+        $Y = $this->zeros([6],dtype:NDArray::float32);
+        $blas->permute([2,3],[1,0],$A->buffer(),0,$Y->buffer(),0);
+        $this->assertEquals([1,4,2,5,3,6],$Y->toArray());
+
+        $this->assertEquals(3,$tracer->calls());
+        $tracer->close();
+    }
+
+    public function testTrace()
+    {
+        $this->traceCalls();
+        $records = iterator_to_array(CallTracer::read($this->path));
+        $this->assertCount(3,$records);
+        [$gemm,$axpy,$permute] = $records;
+
+        $this->assertEquals('blas',$gemm['library']);
+        $this->assertEquals('gemm',$gemm['routine']);
+        $this->assertEquals(NDArray::float32,$gemm['dtype']);
+        $this->assertEquals(BLAS::RowMajor,$gemm['args']['order']);
+        $this->assertEquals(BLAS::NoTrans,$gemm['args']['transA']);
+        $this->assertEquals([2,2,3],[$gemm['args']['m'],$gemm['args']['n'],$gemm['args']['k']]);
+        $this->assertEquals(['buffer'=>NDArray::float32,'size'=>6,'id'=>0],$gemm['args']['A']);
+        $this->assertEquals(['buffer'=>NDArray::float32,'size'=>4,'id'=>2],$gemm['args']['C']);
+        $this->assertGreaterThan(0,$gemm['ns']);
+
+        $this->assertEquals('axpy',$axpy['routine']);
+        $this->assertEquals(NDArray::float64,$axpy['dtype']);
+        $this->assertEquals($axpy['args']['X'],$axpy['args']['Y']);
+
+        $this->assertEquals('permute',$permute['routine']);
+        $this->assertEquals([2,3],$permute['args']['shape']);
+        $this->assertEquals([1,0],$permute['args']['perm']);
+    }
+
+    #[RequiresOperatingSystem('Linux|Darwin')]
+    public function testReplay()
+    {
+        $this->traceCalls();
+        $replayer = new CallReplayer($this->getBlas());
+        // filling the buffers does not reseed the global generator
+        mt_srand(1234);
+        $expected = mt_rand();
+        mt_srand(1234);
+        $results = $replayer->replay(CallTracer::read($this->path),repeat:2);
+        $this->assertEquals($expected,mt_rand());
+        $this->assertCount(3,$results);
+        $this->assertEquals(['gemm','axpy','permute'],array_column($results,'routine'));
+        foreach($results as $result) {
+            $this->assertGreaterThan(0,$result['replayed']);
+        }
+        $replayer->clear();
+
+        file_put_contents($this->path,
+            '{"library":"blas","routine":"nothing","dtype":null,"args":{},"ns":1}'."\n");
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unknown routine in the trace: blas.nothing');
+        $replayer->replay(CallTracer::read($this->path));
+    }
+}
@@ -0,0 +1,176 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\ConvolutionTest;
+
+use PHPUnit\Framework\TestCase;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\Convolution;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class ConvolutionTest extends TestCase
+{
+    use Utils;
+
+    public function getConvolution()
+    {
+        return $this->factory->Convolution();
+    }
+
+    /**
+     * Direct 2D convolution of [batches, h, w, c] images with a [kh, kw, c, filters] kernel.
+     */
+    protected function naiveConv2d(
+        array $images, array $kernel,
+        int $stride, int $padding, int $dilation) : array
+    {
+        $h = count($images[0]); $w = count($images[0][0]);
+        $kh = count($kernel); $kw = count($kernel[0]);
+        $channels = count($kernel[0][0]); $filters = count($kernel[0][0][0]);
+        $outH = intdiv($h+2*$padding-$dilation*($kh-1)-1,$stride)+1;
+        $outW = intdiv($w+2*$padding-$dilation*($kw-1)-1,$stride)+1;
+        $outputs = [];
+        foreach($images as $b => $image) {
+            for($oh=0;$oh<$outH;$oh++) {
+                for($ow=0;$ow<$outW;$ow++) {
+                    for($f=0;$f<$filters;$f++) {
+                        $sum = 0;
+                        for($i=0;$i<$kh;$i++) {
+                            for($j=0;$j<$kw;$j++) {
+                                $y = $oh*$stride-$padding+$i*$dilation;
+                                $x = $ow*$stride-$padding+$j*$dilation;
+                                if($y<0||$y>=$h||$x<0||$x>=$w) {
+                                    continue;
+                                }
+                                for($c=0;$c<$channels;$c++) {
+                                    $sum += $image[$y][$x][$c]*$kernel[$i][$j][$c][$f];
+                                }
+                            }
+                        }
+                        $outputs[$b][$oh][$ow][$f] = $sum;
+                    }
+                }
+            }
+        }
+        return $outputs;
+    }
+
+    protected function sequence(array $shape, int $mod=7) : array
+    {
+        $size = array_product($shape);
+        $flat = [];
+        for($i=0;$i<$size;$i++) {
+            $flat[] = ($i*5)%$mod - 3;
+        }
+        foreach(array_reverse(array_slice($shape,1)) as $n) {
+            $flat = array_chunk($flat,$n);
+        }
+        return $flat;
+    }
+
+    public function testOutputShape()
+    {
+        $conv = $this->getConvolution();
+        $this->assertEquals([4],$conv->outputShape([4],[3],[1],[1],[1]));
+        $this->assertEquals([2,3],$conv->outputShape([5,7],[3,3],[2,2]));
+        $this->assertEquals([1,3,3],$conv->outputShape([3,5,5],[3,3,3],null,null,[1,1,1]));
+        $this->assertEquals([1,1],$conv->outputShape([3,3],[2,2],null,null,[2,2]));
+    }
+
+    public function testIm2col1d()
+    {
+        $conv = $this->getConvolution();
+
+        $images = $this->array([1,2,3,4],dtype:NDArray::float32);
+        $cols = $this->array(null,dtype:NDArray::float32,shape:[4,3]);
+        $conv->im2col(1,[4],1,[3],[1],[1],[1],$images->buffer(),0,$cols->buffer(),0);
+        $this->assertEquals([[0,1,2],[1,2,3],[2,3,4],[3,4,0]],$cols->toArray());
+
+        // cols filled with ones count how often each pixel is used
+        $ones = $this->array(array_fill(0,12,1),dtype:NDArray::float32);
+        $conv->col2im(1,[4],1,[3],[1],[1],[1],$ones->buffer(),0,$images->buffer(),0);
+        $this->assertEquals([2,3,3,2],$images->toArray());
+    }
+
+    public function testIm2col2dDilationAndChannels()
+    {
+        $conv = $this->getConvolution();
+
+        // 3x3 image with 2 channels
+        $images = $this->array([
+            [[1,-1],[2,-2],[3,-3]],
+            [[4,-4],[5,-5],[6,-6]],
+            [[7,-7],[8,-8],[9,-9]],
+        ],dtype:NDArray::float64);
+        $cols = $this->array(null,dtype:NDArray::float64,shape:[1,2,2,2]);
+        $conv->im2col(1,[3,3],2,[2,2],null,null,[2,2],$images->buffer(),0,$cols->buffer(),0);
+        $this->assertEquals([[[[1,-1],[3,-3]],[[7,-7],[9,-9]]]],$cols->toArray());
+
+        // stride 2 with padding 1: the corners of the padded image
+        $cols = $this->array(null,dtype:NDArray::float64,shape:[4,2,2,2]);
+        $conv->im2col(1,[3,3],2,[2,2],[2,2],[1,1],null,$images->buffer(),0,$cols->buffer(),0);
+        $this->assertEquals([
+            [[[0,0],[0,0]],[[0,0],[1,-1]]],
+            [[[0,0],[0,0]],[[2,-2],[3,-3]]],
+            [[[0,0],[4,-4]],[[0,0],[7,-7]]],
+            [[[5,-5],[6,-6]],[[8,-8],[9,-9]]],
+        ],$cols->toArray());
+    }
+
+    public function testIm2col3d()
+    {
+        $conv = $this->getConvolution();
+
+        $images = $this->array([[[[1],[2]],[[3],[4]]],[[[5],[6]],[[7],[8]]]],dtype:NDArray::float32);
+        $cols = $this->array(null,dtype:NDArray::float32,shape:[1,8]);
+        $conv->im2col(1,[2,2,2],1,[2,2,2],null,null,null,$images->buffer(),0,$cols->buffer(),0);
+        $this->assertEquals([[1,2,3,4,5,6,7,8]],$cols->toArray());
+    }
+
+    public function testConvolution()
+    {
+        $conv = $this->getConvolution();
+
+        $imagesArray = $this->sequence([2,5,6,3]);
+        $kernelArray = $this->sequence([3,3,3,4],5);
+        foreach([[1,1,1],[2,0,1],[1,2,2]] as [$stride,$padding,$dilation]) {
+            $expected = $this->naiveConv2d($imagesArray,$kernelArray,$stride,$padding,$dilation);
+            $outShape = $conv->outputShape([5,6],[3,3],[$stride,$stride],[$padding,$padding],[$dilation,$dilation]);
+            $images = $this->array($imagesArray,dtype:NDArray::float32);
+            $kernel = $this->array($kernelArray,dtype:NDArray::float32);
+            $outputs = $this->array(null,dtype:NDArray::float32,shape:array_merge([2],$outShape,[4]));
+            $conv->convolution(2,[5,6],3,[3,3],4,
+                [$stride,$stride],[$padding,$padding],[$dilation,$dilation],
+                $images->buffer(),0,$kernel->buffer(),0,$outputs->buffer(),0);
+            $this->assertEquals($expected,$outputs->toArray());
+        }
+    }
+
+    public function testConvolutionTiles()
+    {
+        // a scratch buffer of two patches
+        $conv = new class ($this->getBlas()->ffi()) extends Convolution {
+            const SCRATCH_SIZE = 2*3*3*3;
+        };
+
+        $imagesArray = $this->sequence([2,4,4,3]);
+        $kernelArray = $this->sequence([3,3,3,2],5);
+        $expected = $this->naiveConv2d($imagesArray,$kernelArray,1,1,1);
+        $images = $this->array($imagesArray,dtype:NDArray::float64);
+        $kernel = $this->array($kernelArray,dtype:NDArray::float64);
+        $outputs = $this->array(null,dtype:NDArray::float64,shape:[2,4,4,2]);
+        $conv->convolution(2,[4,4],3,[3,3],2,null,[1,1],null,
+            $images->buffer(),0,$kernel->buffer(),0,$outputs->buffer(),0);
+        $this->assertEquals($expected,$outputs->toArray());
+    }
+
+    public function testKernelLargerThanImage()
+    {
+        $conv = $this->getConvolution();
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('The kernel is larger than the padded image.');
+        $conv->outputShape([2,2],[3,3]);
+    }
+}
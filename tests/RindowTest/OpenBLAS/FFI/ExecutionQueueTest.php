@@ -0,0 +1,155 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\ExecutionQueueTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\RequiresFunction;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\AnonymousBuffer;
+use Rindow\OpenBLAS\FFI\ExecutionQueue;
+use InvalidArgumentException;
+use RuntimeException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+#[RequiresFunction('pcntl_fork')]
+#[RequiresOperatingSystem('Linux|Darwin')]
+class ExecutionQueueTest extends TestCase
+{
+    use Utils;
+
+    /**
+     * @param array<float> $values
+     */
+    protected function shared(array $values) : AnonymousBuffer
+    {
+        $buffer = new AnonymousBuffer(count($values),NDArray::float32,shared:true);
+        foreach($values as $i => $value) {
+            $buffer[$i] = $value;
+        }
+        return $buffer;
+    }
+
+    public function testBlasInOrder()
+    {
+        $queue = $this->factory->ExecutionQueue();
+
+        $X = $this->shared([1,2,3]);
+        $Y = $this->shared([10,20,30]);
+        $scal = $queue->blas('scal',3,2.0,$X,0,1);
+        $axpy = $queue->blas('axpy',3,1.0,$X,0,1,$Y,0,1);
+        $dot = $queue->blas('dot',3,$X,0,1,$Y,0,1);
+
+        // operations run in submission order in the worker
+        $this->assertEquals(2*12+4*24+6*36,$dot->wait());
+        $this->assertTrue($scal->isDone());
+        $this->assertTrue($axpy->isDone());
+        $this->assertEquals([2,4,6],iterator_to_array($X));
+        $this->assertEquals([12,24,36],iterator_to_array($Y));
+        $this->assertEquals(0,$queue->pending());
+    }
+
+    public function testDestructorRunsWaitingOperations()
+    {
+        $queue = $this->factory->ExecutionQueue();
+        $X = $this->shared([1,2,3]);
+
+        // the first worker is busy, so scal waits for the next one
+        $queue->submit(function() {
+            usleep(100000);
+            return null;
+        });
+        $queue->blas('scal',3,2.0,$X,0,1);
+        $this->assertEquals(2,$queue->pending());
+        // the futures refer to the queue, so it is freed by the cycle collector
+        unset($queue);
+        gc_collect_cycles();
+        $this->assertEquals([2,4,6],iterator_to_array($X));
+    }
+
+    public function testOverlapsWithCaller()
+    {
+        $queue = $this->factory->ExecutionQueue();
+        $X = $this->shared([1,2,3]);
+
+        $start = hrtime(true);
+        $future = $queue->submit(function($X) {
+            usleep(300000);
+            $X[0] = 5.0;
+            return 'slept';
+        },[$X]);
+        $queue->blas('scal',3,2.0,$X,0,1);
+        // the caller goes on while the worker sleeps
+        $this->assertLessThan(0.2,(hrtime(true)-$start)/1e9);
+        $this->assertFalse($future->poll());
+        $this->assertEquals(2,$queue->pending());
+
+        $this->assertEquals('slept',$future->wait());
+        $this->assertGreaterThanOrEqual(0.3,(hrtime(true)-$start)/1e9);
+        $queue->flush();
+        $this->assertEquals([10,4,6],iterator_to_array($X));
+        $this->assertEquals(0,$queue->pending());
+    }
+
+    public function testLaterSubmissionsGoToTheNextWorker()
+    {
+        $queue = $this->factory->ExecutionQueue();
+        $X = $this->shared([1,2,3]);
+
+        $first = $queue->blas('scal',3,2.0,$X,0,1);
+        $first->wait();
+        $second = $queue->blas('scal',3,3.0,$X,0,1);
+        $third = $queue->blas('nrm2',3,$X,0,1);
+        $this->assertEqualsWithDelta(sqrt(36+144+324),$third->wait(),1e-4);
+        $this->assertTrue($second->isDone());
+        $this->assertEquals([6,12,18],iterator_to_array($X));
+    }
+
+    public function testErrorIsThrownByWait()
+    {
+        $queue = $this->factory->ExecutionQueue();
+        $X = $this->shared([1,2,3]);
+        $failed = $queue->blas('scal',4,2.0,$X,0,1);
+        $next = $queue->blas('scal',3,2.0,$X,0,1);
+        $queue->flush();
+
+        // the queue goes on after a failed operation
+        $this->assertTrue($failed->isDone());
+        $next->wait();
+        $this->assertEquals([2,4,6],iterator_to_array($X));
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Vector specification too large for bufferX.');
+        $failed->wait();
+    }
+
+    public function testPrivateBufferIsRejected()
+    {
+        $queue = $this->factory->ExecutionQueue();
+        $X = new AnonymousBuffer(3,NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('The buffers of a queued operation must be shared with the worker');
+        $queue->blas('scal',3,2.0,$X,0,1);
+    }
+
+    public function testResolvesLapackOnFirstUse()
+    {
+        $calls = 0;
+        $queue = new ExecutionQueue($this->getBlas(),function() use (&$calls) {
+            $calls++;
+            throw new RuntimeException('lapack library not loaded.');
+        });
+        $X = $this->shared([1,2,3]);
+        $queue->blas('scal',3,2.0,$X,0,1)->wait();
+        $this->assertEquals(0,$calls);
+
+        try {
+            $queue->lapack('gesvd');
+            $this->fail('lapack() must fail without lapack');
+        } catch(RuntimeException $e) {
+            $this->assertEquals('lapack is not available for this queue.',$e->getMessage());
+        }
+        $this->assertEquals(1,$calls);
+    }
+}
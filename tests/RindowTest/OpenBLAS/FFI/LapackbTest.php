@@ -10,6 +10,9 @@ use Rindow\Math\Matrix\MatrixOperator;
 use Rindow\Math\Buffer\FFI\Buffer;
 use Rindow\OpenBLAS\FFI\Blas as OpenBLAS;
 use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use Rindow\OpenBLAS\FFI\Lapackb;
+use Rindow\OpenBLAS\FFI\TracedLapack;
+use Rindow\OpenBLAS\FFI\ScratchPool;
 use InvalidArgumentException;
 use RuntimeException;
 use LogicException;
@@ -477,5 +480,255 @@ class LapackbTest extends TestCase
         $this->assertTrue($this->isclose($this->absarray($vt),$this->absarray($correctVT),rtol:1e-2,atol:1e-3));
         $this->assertTrue(true);
     }
+    #[DataProvider('providerDtypesFloats')]
+    public function testSvdStridedBatch($params)
+    {
+        extract($params);
+        $lapack = $this->getLapack();
+        $a = [
+            [ 8.79,  9.93,  9.83,  5.45,  3.16,],
+            [ 6.11,  6.91,  5.04, -0.27,  7.98,],
+            [-9.15, -7.93,  4.86,  4.85,  3.01,],
+            [ 9.57,  1.64,  8.83,  0.74,  5.80,],
+            [-3.49,  4.02,  9.80, 10.00,  4.27,],
+            [ 9.84,  0.15, -8.99, -6.02, -5.31,],
+        ];
+        $a2 = array_map(fn($row)=>array_map(fn($v)=>2*$v,$row),$a);
+        $A = $this->array([$a,$a2],dtype:$dtype);
+        $S = $this->zeros([2,5],dtype:$dtype);
+        $U = $this->zeros([2,6,6],dtype:$dtype);
+        $VT = $this->zeros([2,5,5],dtype:$dtype);
+
+        $lapack->gesvdStridedBatch(
+            self::LAPACK_ROW_MAJOR,
+            ord('A'),
+            ord('A'),
+            6,
+            5,
+            $A->buffer(),  $A->offset(),  5, 30,
+            $S->buffer(),  $S->offset(),  5,
+            $U->buffer(),  $U->offset(),  6, 36,
+            $VT->buffer(), $VT->offset(), 5, 25,
+            2
+        );
+
+        $correctS = [27.47,22.64, 8.56, 5.99, 2.01];
+        $this->assertTrue($this->isclose(
+            $this->array($S->buffer(),$dtype,[5],0),
+            $this->array($correctS,dtype:$dtype),rtol:1e-2,atol:1e-3));
+        $this->assertTrue($this->isclose(
+            $this->array($S->buffer(),$dtype,[5],5),
+            $this->array(array_map(fn($v)=>2*$v,$correctS),dtype:$dtype),rtol:1e-2,atol:1e-3));
+
+        $correctU = $this->array([
+            [-0.59, 0.26, 0.36, 0.31, 0.23, 0.55],
+            [-0.40, 0.24,-0.22,-0.75,-0.36, 0.18],
+            [-0.03,-0.60,-0.45, 0.23,-0.31, 0.54],
+            [-0.43, 0.24,-0.69, 0.33, 0.16,-0.39],
+            [-0.47,-0.35, 0.39, 0.16,-0.52,-0.46],
+            [ 0.29, 0.58,-0.02, 0.38,-0.65, 0.11],
+        ],dtype:$dtype);
+        $correctVT = $this->array([
+            [-0.25,-0.40,-0.69,-0.37,-0.41],
+            [ 0.81, 0.36,-0.25,-0.37,-0.10],
+            [-0.26, 0.70,-0.22, 0.39,-0.49],
+            [ 0.40,-0.45, 0.25, 0.43,-0.62],
+            [-0.22, 0.14, 0.59,-0.63,-0.44],
+        ],dtype:$dtype);
+        for($i=0;$i<2;$i++) {
+            $u = $this->array($U->buffer(),$dtype,[6,6],$i*36);
+            $vt = $this->array($VT->buffer(),$dtype,[5,5],$i*25);
+            $this->assertTrue($this->isclose($this->absarray($u),$this->absarray($correctU),rtol:1e-2,atol:1e-3));
+            $this->assertTrue($this->isclose($this->absarray($vt),$this->absarray($correctVT),rtol:1e-2,atol:1e-3));
+        }
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testSvdWithWork($params)
+    {
+        extract($params);
+        $lapack = $this->getLapack();
+        $a = $this->array([
+            [ 8.79,  9.93,  9.83,  5.45,  3.16,],
+            [ 6.11,  6.91,  5.04, -0.27,  7.98,],
+            [-9.15, -7.93,  4.86,  4.85,  3.01,],
+            [ 9.57,  1.64,  8.83,  0.74,  5.80,],
+            [-3.49,  4.02,  9.80, 10.00,  4.27,],
+            [ 9.84,  0.15, -8.99, -6.02, -5.31,],
+        ],dtype:$dtype);
+        $correctS = $this->array([27.47,22.64, 8.56, 5.99, 2.01],dtype:$dtype);
+        $correctVT = $this->array([
+            [-0.25,-0.40,-0.69,-0.37,-0.41],
+            [ 0.81, 0.36,-0.25,-0.37,-0.10],
+            [-0.26, 0.70,-0.22, 0.39,-0.49],
+            [ 0.40,-0.45, 0.25, 0.43,-0.62],
+            [-0.22, 0.14, 0.59,-0.63,-0.44],
+        ],dtype:$dtype);
+
+        $lwork = $lapack->gesvdWorkspaceSize(self::LAPACK_ROW_MAJOR,ord('A'),ord('A'),6,5,$dtype);
+        $this->assertGreaterThanOrEqual(5,$lwork);
+        $work = $this->zeros([$lwork+2],dtype:$dtype);
+        // the work buffer is reused by every call
+        for($i=0;$i<2;$i++) {
+            [$matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+             $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB,$U,$S,$VT,$SuperB] =
+                $this->translate_gesvd($this->copy($a),fullMatrices:true);
+            $lapack->gesvd($matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+                $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB,
+                $work->buffer(),2,$lwork);
+            $this->assertTrue($this->isclose($S,$correctS,rtol:1e-2,atol:1e-3));
+            $this->assertTrue($this->isclose($this->absarray($VT),$this->absarray($correctVT),rtol:1e-2,atol:1e-3));
+            $this->assertEquals([6,6],$U->shape());
+            $this->assertEqualsWithDelta(1.0,$this->getBlas()->nrm2(6,$UU,0,6),1e-3);
+        }
+
+        // ColMajor and the strided batch
+        $lwork = $lapack->gesvdWorkspaceSize(self::LAPACK_COL_MAJOR,ord('N'),ord('N'),5,6,$dtype);
+        $work = $this->zeros([$lwork],dtype:$dtype);
+        $A = $this->copy($a);
+        $S = $this->zeros([5],dtype:$dtype);
+        $dummy = $this->zeros([1],dtype:$dtype);
+        $lapack->gesvdStridedBatch(
+            self::LAPACK_COL_MAJOR,ord('N'),ord('N'),5,6,
+            $A->buffer(),0,5,30,
+            $S->buffer(),0,5,
+            $dummy->buffer(),0,1,0,
+            $dummy->buffer(),0,1,0,
+            1,
+            $work->buffer(),0,$lwork);
+        $this->assertTrue($this->isclose($S,$correctS,rtol:1e-2,atol:1e-3));
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('BufferWork size is too small');
+        $lapack->gesvdStridedBatch(
+            self::LAPACK_COL_MAJOR,ord('N'),ord('N'),5,6,
+            $A->buffer(),0,5,30,
+            $S->buffer(),0,5,
+            $dummy->buffer(),0,1,0,
+            $dummy->buffer(),0,1,0,
+            1,
+            $work->buffer(),1,$lwork);
+    }
 
+    #[DataProvider('providerDtypesFloats')]
+    public function testSyevStridedBatch($params)
+    {
+        extract($params);
+        $lapack = $this->getLapack();
+        $A = $this->array([
+            [[2,1],[1,2]],
+            [[4,0],[0,1]],
+        ],dtype:$dtype);
+        $W = $this->zeros([2,2],dtype:$dtype);
+
+        $lapack->syevStridedBatch(
+            self::LAPACK_ROW_MAJOR,
+            ord('V'),
+            ord('U'),
+            2,
+            $A->buffer(), $A->offset(), 2, 4,
+            $W->buffer(), $W->offset(), 2,
+            2
+        );
+
+        $this->assertTrue($this->isclose($W,$this->array([[1,3],[1,4]],dtype:$dtype)));
+        $r = sqrt(0.5);
+        $this->assertTrue($this->isclose($this->absarray($A),$this->array([
+            [[$r,$r],[$r,$r]],
+            [[0,1],[1,0]],
+        ],dtype:$dtype)));
+        // eigenvectors of the first matrix are columns: [1,-1] and [1,1]
+        $v = $A->toArray();
+        $this->assertLessThan(0,$v[0][0][0]*$v[0][1][0]);
+        $this->assertGreaterThan(0,$v[0][0][1]*$v[0][1][1]);
+    }
+
+    public function testSyevStridedBatchOverflowBufferA()
+    {
+        $lapack = $this->getLapack();
+        $A = $this->zeros([7]);
+        $W = $this->zeros([4]);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Matrix specification too large for bufferA.');
+        $lapack->syevStridedBatch(
+            self::LAPACK_ROW_MAJOR,
+            ord('N'),
+            ord('U'),
+            2,
+            $A->buffer(), $A->offset(), 2, 4,
+            $W->buffer(), $W->offset(), 2,
+            2
+        );
+    }
+
+    protected function getScratchPool(object $lapack) : ScratchPool
+    {
+        if($lapack instanceof TracedLapack) {
+            $lapack = $lapack->inner();
+        }
+        if(!($lapack instanceof Lapackb)) {
+            $this->markTestSkipped('The scratch pool is only used by Lapackb.');
+        }
+        return $lapack->scratchPool();
+    }
+
+    public function testScratchPool()
+    {
+        $lapack = $this->getLapack();
+        $pool = $this->getScratchPool($lapack);
+        $pool->trim();
+        $a = $this->array([
+            [ 8.79,  9.93,  9.83,],
+            [ 6.11,  6.91,  5.04,],
+            [-9.15, -7.93,  4.86,],
+            [ 9.57,  1.64,  8.83,],
+        ],dtype:NDArray::float64);
+
+        [$matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+         $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB,$U,$S,$VT,$SuperB] =
+            $this->translate_gesvd($this->copy($a),fullMatrices:true);
+        $lapack->gesvd($matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+            $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB);
+        $this->assertEquals(0,$pool->inUse());
+        $reserved = $pool->reserved();
+        $this->assertGreaterThan(0,$reserved);
+        $this->assertGreaterThanOrEqual($reserved,$pool->highWaterMark());
+
+        // the second call reuses the blocks
+        [$matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+         $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB,$U,$S,$VT,$SuperB] =
+            $this->translate_gesvd($this->copy($a),fullMatrices:true);
+        $lapack->gesvd($matrix_layout,$jobu,$jobvt,$m,$n,$AA,$offsetA,$ldA,$SS,$offsetS,
+            $UU,$offsetU,$ldU,$VVT,$offsetVT,$ldVT,$SuperBB,$offsetSuperB);
+        $this->assertEquals($reserved,$pool->reserved());
+        $this->assertEquals(0,$pool->inUse());
+
+        $this->assertEquals($reserved,$pool->trim());
+        $this->assertEquals(0,$pool->reserved());
+        $this->assertEquals([],$pool->stats());
+    }
+
+    public function testScratchPoolAlignment()
+    {
+        $pool = $this->getScratchPool($this->getLapack());
+        $mark = $pool->mark();
+        $cell = $pool->cell('lapack_int',7);
+        $work = $pool->acquire('double',100);
+        $this->assertEquals(7,$cell[0]);
+        foreach([$cell,$work] as $pointer) {
+            $this->assertEquals(0,\FFI::cdef()->cast('uintptr_t',$pointer)->cdata % 64);
+        }
+        $stats = $pool->stats();
+        $this->assertEquals(1,$stats[64]['used']);
+        $this->assertEquals(1,$stats[1024]['used']);
+        $pool->release($work);
+        $this->assertEquals(1,$pool->stats()[1024]['free']);
+        $pool->releaseTo($mark);
+        $this->assertEquals(0,$pool->stats()[64]['used']);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('The pointer was not acquired from this pool.');
+        $pool->release($work);
+    }
 }
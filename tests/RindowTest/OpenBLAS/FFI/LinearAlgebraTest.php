@@ -0,0 +1,141 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\LinearAlgebraTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\DataProvider;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use InvalidArgumentException;
+use RuntimeException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+use function RindowTest\OpenBLAS\FFI\C;
+
+class LinearAlgebraTest extends TestCase
+{
+    use Utils;
+
+    const LAPACK_ROW_MAJOR = 101;
+    const LAPACK_COL_MAJOR = 102;
+
+    public static function providerDtypesFloats()
+    {
+        return [
+            'float32' => [[
+                'dtype' => NDArray::float32,
+            ]],
+            'float64' => [[
+                'dtype' => NDArray::float64,
+            ]],
+        ];
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testInvDet($params)
+    {
+        extract($params);
+        $linalg = $this->factory->LinearAlgebra();
+        $A = $this->array([
+            [[4,7],[2,6]],
+            [[1,2],[3,4]],
+        ],dtype:$dtype);
+        $det = $this->zeros([2],dtype:$dtype);
+        $linalg->det(2,$A->buffer(),0,2,$det->buffer(),0,strideA:4,batchCount:2);
+        $this->assertTrue($this->isclose($det,$this->array([10,-2],dtype:$dtype)));
+
+        $sign = $this->zeros([2],dtype:$dtype);
+        $logAbsDet = $this->zeros([2],dtype:$dtype);
+        $linalg->slogdet(2,$A->buffer(),0,2,$sign->buffer(),0,$logAbsDet->buffer(),0,strideA:4,batchCount:2);
+        $this->assertEquals([1,-1],$sign->toArray());
+        $this->assertTrue($this->isclose($logAbsDet,$this->array([log(10),log(2)],dtype:$dtype)));
+
+        // A is kept by det and slogdet
+        $this->assertEquals([[[4,7],[2,6]],[[1,2],[3,4]]],$A->toArray());
+
+        $linalg->inv(2,$A->buffer(),0,2,strideA:4,batchCount:2);
+        $this->assertTrue($this->isclose($A,$this->array([
+            [[0.6,-0.7],[-0.2,0.4]],
+            [[-2,1],[1.5,-0.5]],
+        ],dtype:$dtype)));
+
+        // singular
+        $S = $this->array([[1,2],[2,4]],dtype:$dtype);
+        $linalg->slogdet(2,$S->buffer(),0,2,$sign->buffer(),0,$logAbsDet->buffer(),0);
+        $this->assertEquals(0.0,$sign->buffer()[0]);
+        $this->assertEquals(-INF,$logAbsDet->buffer()[0]);
+        $linalg->det(2,$S->buffer(),0,2,$det->buffer(),1);
+        $this->assertEquals(0.0,$det->buffer()[1]);
+
+        $this->expectException(RuntimeException::class);
+        $this->expectExceptionMessage('Matrix 0 is singular.');
+        $linalg->inv(2,$S->buffer(),0,2);
+    }
+
+    #[DataProvider('providerDtypesFloats')]
+    public function testCond($params)
+    {
+        extract($params);
+        $linalg = $this->factory->LinearAlgebra();
+        $A = $this->array([
+            [1,1,1],
+            [0,1,0],
+            [0,0,1],
+        ],dtype:$dtype);
+        $cond = $this->zeros([4],dtype:$dtype);
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),3,$A->buffer(),0,3,$cond->buffer(),0);
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('I'),3,$A->buffer(),0,3,$cond->buffer(),1);
+        // the same buffer is the transpose in ColMajor
+        $linalg->cond(self::LAPACK_COL_MAJOR,ord('1'),3,$A->buffer(),0,3,$cond->buffer(),2);
+        $this->assertTrue($this->isclose($cond,$this->array([4,9,9,0],dtype:$dtype)));
+
+        // positive definite, only the upper triangle is read (the lower one is not symmetric)
+        $P = $this->array([
+            [[2,0],[5,8]],
+            [[1,0],[9,1]],
+        ],dtype:$dtype);
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),2,$P->buffer(),0,2,$cond->buffer(),0,
+            strideA:4,batchCount:2,positiveDefinite:true,uplo:ord('U'));
+        $this->assertTrue($this->isclose($cond,$this->array([4,1,9,0],dtype:$dtype)));
+
+        // singular
+        $S = $this->array([[1,2],[2,4]],dtype:$dtype);
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),2,$S->buffer(),0,2,$cond->buffer(),3);
+        $this->assertEquals(INF,$cond->buffer()[3]);
+
+        $this->expectException(RuntimeException::class);
+        $this->expectExceptionMessage('Matrix 0 is not positive definite.');
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),2,$S->buffer(),0,2,$cond->buffer(),0,
+            positiveDefinite:true);
+    }
+
+    public function testComplex()
+    {
+        $linalg = $this->factory->LinearAlgebra();
+        $A = $this->array([[C(1,1),C(0)],[C(0),C(2)]],dtype:NDArray::complex64);
+        $det = $this->zeros([1],dtype:NDArray::complex64);
+        $linalg->det(2,$A->buffer(),0,2,$det->buffer(),0);
+        $this->assertEqualsWithDelta(2.0,$det->buffer()[0]->real,1e-6);
+        $this->assertEqualsWithDelta(2.0,$det->buffer()[0]->imag,1e-6);
+
+        $sign = $this->zeros([1],dtype:NDArray::complex64);
+        $logAbsDet = $this->zeros([1],dtype:NDArray::float32);
+        $linalg->slogdet(2,$A->buffer(),0,2,$sign->buffer(),0,$logAbsDet->buffer(),0);
+        $this->assertEqualsWithDelta(sqrt(0.5),$sign->buffer()[0]->real,1e-6);
+        $this->assertEqualsWithDelta(sqrt(0.5),$sign->buffer()[0]->imag,1e-6);
+        $this->assertEqualsWithDelta(log(sqrt(8)),$logAbsDet->buffer()[0],1e-6);
+
+        $cond = $this->zeros([1],dtype:NDArray::float32);
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),2,$A->buffer(),0,2,$cond->buffer(),0);
+        $this->assertEqualsWithDelta(sqrt(2),$cond->buffer()[0],1e-5);
+
+        $linalg->inv(2,$A->buffer(),0,2);
+        $this->assertEqualsWithDelta(0.5,$A->buffer()[0]->real,1e-6);
+        $this->assertEqualsWithDelta(-0.5,$A->buffer()[0]->imag,1e-6);
+        $this->assertEqualsWithDelta(0.5,$A->buffer()[3]->real,1e-6);
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unmatch data type of BufferCond');
+        $linalg->cond(self::LAPACK_ROW_MAJOR,ord('1'),2,$A->buffer(),0,2,$sign->buffer(),0);
+    }
+}
@@ -0,0 +1,97 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\MappedBufferTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS;
+use Rindow\OpenBLAS\FFI\MappedBuffer;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use LogicException;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+#[RequiresOperatingSystem('Linux|Darwin')]
+class MappedBufferTest extends TestCase
+{
+    use Utils;
+
+    protected string $path;
+
+    public function setUp() : void
+    {
+        $this->factory = new OpenBLASFactory();
+        $this->path = sys_get_temp_dir().'/rindow-openblas-mapped-'.getmypid().'.bin';
+    }
+
+    public function tearDown() : void
+    {
+        if(file_exists($this->path)) {
+            unlink($this->path);
+        }
+    }
+
+    public function testReadonly()
+    {
+        file_put_contents($this->path, pack('f*',1,2,3,4,5,6));
+        $A = new MappedBuffer($this->path,NDArray::float32);
+        $this->assertCount(6,$A);
+        $this->assertEquals(NDArray::float32,$A->dtype());
+        $this->assertEquals(4,$A->value_size());
+        $this->assertEquals(5.0,$A[4]);
+        $this->assertEquals([1,2,3,4,5,6],iterator_to_array($A));
+
+        // the weights are used in place
+        $blas = $this->getBlas();
+        $X = $this->array([1,1,1],dtype:NDArray::float32);
+        $Y = $this->zeros([2],dtype:NDArray::float32);
+        $blas->gemv(BLAS::RowMajor,BLAS::NoTrans,2,3,
+            1.0,$A,0,3,$X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+        $this->assertEquals([6,15],$Y->toArray());
+
+        $this->expectException(LogicException::class);
+        $this->expectExceptionMessage('The buffer is read-only.');
+        $A[0] = 1.0;
+    }
+
+    public function testOffsetAndAdvice()
+    {
+        // a 13 byte header that is not on a page boundary
+        file_put_contents($this->path, str_repeat('h',13).pack('d*',1.5,2.5,3.5));
+        $A = new MappedBuffer($this->path,NDArray::float64,size:2,offset:13,
+            advice:MappedBuffer::ADVICE_SEQUENTIAL);
+        $this->assertCount(2,$A);
+        $this->assertEquals([1.5,2.5],iterator_to_array($A));
+        $A->advise(MappedBuffer::ADVICE_WILLNEED,1,1);
+        $this->assertEquals(pack('d*',1.5,2.5),$A->dump());
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('File is too small');
+        new MappedBuffer($this->path,NDArray::float64,size:3,offset:13);
+    }
+
+    public function testCopyOnWriteAndShared()
+    {
+        file_put_contents($this->path, pack('f*',1,2,3,4));
+        $A = new MappedBuffer($this->path,NDArray::float32,mode:MappedBuffer::COPY_ON_WRITE);
+        $blas = $this->getBlas();
+        $blas->scal(4,2.0,$A,0,1);
+        $this->assertEquals([2,4,6,8],iterator_to_array($A));
+        $A->close();
+        $this->assertEquals(pack('f*',1,2,3,4),file_get_contents($this->path));
+
+        // a shared mapping extends the file and writes back to it
+        $B = new MappedBuffer($this->path,NDArray::float32,size:6,mode:MappedBuffer::SHARED);
+        $B[5] = 7.0;
+        $blas->scal(4,2.0,$B,0,1);
+        $B->close();
+        $this->assertEquals(pack('f*',2,4,6,8,0,7),file_get_contents($this->path));
+
+        $this->expectException(LogicException::class);
+        $this->expectExceptionMessage('The buffer is closed.');
+        $B->addr(0);
+    }
+}
@@ -0,0 +1,227 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\MathTest;
+
+use PHPUnit\Framework\TestCase;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class MathTest extends TestCase
+{
+    use Utils;
+
+    public function getMath()
+    {
+        return $this->factory->Math();
+    }
+
+    public function testMultiply()
+    {
+        $math = $this->getMath();
+
+        $X = $this->array([1,2,3],dtype:NDArray::float32);
+        $Y = $this->array([4,5,6],dtype:NDArray::float32);
+        $math->multiply(3,$X->buffer(),0,1,$Y->buffer(),0,1);
+        $this->assertEquals([4,10,18],$Y->toArray());
+        $this->assertEquals([1,2,3],$X->toArray());
+
+        // strided
+        $X = $this->array([1,0,2,0,3],dtype:NDArray::float64);
+        $Y = $this->array([4,5,6],dtype:NDArray::float64);
+        $math->multiply(3,$X->buffer(),0,2,$Y->buffer(),0,1);
+        $this->assertEquals([4,10,18],$Y->toArray());
+    }
+
+    public function testSumAndImax()
+    {
+        $math = $this->getMath();
+
+        $X = $this->array([1,5,3,5,-2],dtype:NDArray::float32);
+        $this->assertEquals(12,$math->sum(5,$X->buffer(),0,1));
+        $this->assertEquals(6,$math->sum(3,$X->buffer(),0,2));
+        $this->assertEquals(1,$math->imax(5,$X->buffer(),0,1));
+        $this->assertEquals(1,$math->imax(3,$X->buffer(),1,2));
+        // the cached ones vector grows
+        $Y = $this->array(array_fill(0,10,1.5),dtype:NDArray::float32);
+        $this->assertEquals(15,$math->sum(10,$Y->buffer(),0,1));
+    }
+
+    public function testElementwiseFunctions()
+    {
+        $math = $this->getMath();
+
+        $X = $this->array([-1,0,2],dtype:NDArray::float64);
+        $math->exp(3,$X->buffer(),0,1);
+        $this->assertEqualsWithDelta([exp(-1),1,exp(2)],$X->toArray(),1e-12);
+        $math->log(3,$X->buffer(),0,1);
+        $this->assertEqualsWithDelta([-1,0,2],$X->toArray(),1e-12);
+        $math->tanh(3,$X->buffer(),0,1);
+        $this->assertEqualsWithDelta([tanh(-1),0,tanh(2)],$X->toArray(),1e-12);
+
+        $X = $this->array([-1000,0,1000],dtype:NDArray::float32);
+        $math->sigmoid(3,$X->buffer(),0,1);
+        $this->assertEqualsWithDelta([0,0.5,1],$X->toArray(),1e-6);
+
+        $X = $this->array([-1,2,-3,4],dtype:NDArray::float32);
+        $math->relu(2,$X->buffer(),0,2);
+        $this->assertEquals([0,2,0,4],$X->toArray());
+    }
+
+    public function testSoftmax()
+    {
+        $math = $this->getMath();
+
+        $A = $this->array([[1,2,3],[1000,1000,1000]],dtype:NDArray::float32);
+        $math->softmax(2,3,$A->buffer(),0,3);
+        $e = [exp(1),exp(2),exp(3)];
+        $s = array_sum($e);
+        $this->assertEqualsWithDelta([
+            [$e[0]/$s,$e[1]/$s,$e[2]/$s],
+            [1/3,1/3,1/3],
+        ],$A->toArray(),1e-6);
+
+        // padded rows
+        $A = $this->array([[0,0,9],[0,0,9]],dtype:NDArray::float64);
+        $math->softmax(2,2,$A->buffer(),0,3);
+        $this->assertEquals([[0.5,0.5,9],[0.5,0.5,9]],$A->toArray());
+    }
+
+    public function testReduceSumAndMean()
+    {
+        $math = $this->getMath();
+
+        // a 2x3 view with ldA=4 at offset 1
+        $A = $this->array([9,1,2,3,9,4,5,6,9],dtype:NDArray::float32);
+        $X = $this->array([1,1,1],dtype:NDArray::float32);
+        $math->reduceSum(0,2,3,1.0,$A->buffer(),1,4,0.0,$X->buffer(),0,1);
+        $this->assertEquals([5,7,9],$X->toArray());
+        $math->reduceSum(0,2,3,2.0,$A->buffer(),1,4,1.0,$X->buffer(),0,1);
+        $this->assertEquals([15,21,27],$X->toArray());
+
+        $X = $this->array([0,-1,0],dtype:NDArray::float32);
+        $math->reduceSum(1,2,3,1.0,$A->buffer(),1,4,0.0,$X->buffer(),0,2);
+        $this->assertEquals([6,-1,15],$X->toArray());
+
+        $X = $this->array([0,0],dtype:NDArray::float64);
+        $A = $this->array([[1,2,3],[4,5,6]],dtype:NDArray::float64);
+        $math->reduceMean(1,2,3,$A->buffer(),0,3,$X->buffer(),0,1);
+        $this->assertEquals([2,5],$X->toArray());
+        $X = $this->array([0,0,0],dtype:NDArray::float64);
+        $math->reduceMean(0,2,3,$A->buffer(),0,3,$X->buffer(),0,1);
+        $this->assertEquals([2.5,3.5,4.5],$X->toArray());
+    }
+
+    public function testBroadcastAdd()
+    {
+        $math = $this->getMath();
+
+        $A = $this->array([[1,2,3],[4,5,6]],dtype:NDArray::float32);
+        $X = $this->array([10,20,30],dtype:NDArray::float32);
+        $math->broadcastAdd(0,2,3,1.0,$X->buffer(),0,1,$A->buffer(),0,3);
+        $this->assertEquals([[11,22,33],[14,25,36]],$A->toArray());
+
+        $X = $this->array([1,0,2],dtype:NDArray::float32);
+        $math->broadcastAdd(1,2,3,-1.0,$X->buffer(),0,2,$A->buffer(),0,3);
+        $this->assertEquals([[10,21,32],[12,23,34]],$A->toArray());
+
+        // the cached ones vector grows with the rows
+        $A = $this->array(array_fill(0,100,array_fill(0,2,0)),dtype:NDArray::float32);
+        $X = $this->array([1,2],dtype:NDArray::float32);
+        $math->broadcastAdd(0,100,2,1.0,$X->buffer(),0,1,$A->buffer(),0,2);
+        $this->assertEquals(array_fill(0,100,[1,2]),$A->toArray());
+    }
+
+    public function testReduceSumInvalidAxis()
+    {
+        $math = $this->getMath();
+
+        $A = $this->array([[1,2],[3,4]],dtype:NDArray::float32);
+        $X = $this->array([0,0],dtype:NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Argument axis must be 0 or 1.');
+        $math->reduceSum(2,2,2,1.0,$A->buffer(),0,2,0.0,$X->buffer(),0,1);
+    }
+
+    public function testGemmEpilogue()
+    {
+        $math = $this->getMath();
+
+        $A = $this->array([[1,2],[3,4]],dtype:NDArray::float32);
+        $B = $this->array([[1,-1,0],[0,1,-2]],dtype:NDArray::float32);
+        $bias = $this->array([1,-10,0.5],dtype:NDArray::float32);
+        $rowBias = $this->array([10,20],dtype:NDArray::float32);
+
+        // column bias and relu
+        $C = $this->array(null,dtype:NDArray::float32,shape:[2,3]);
+        $math->gemmEpilogue(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,3,2,
+            1.0,$A->buffer(),0,2,$B->buffer(),0,3,0.0,$C->buffer(),0,3,
+            $bias->buffer(),0,1,activation:'relu');
+        $this->assertEquals([[2,0,0],[4,0,0]],$C->toArray());
+
+        // row bias without activation
+        $C = $this->array(null,dtype:NDArray::float32,shape:[2,3]);
+        $math->gemmEpilogue(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,3,2,
+            1.0,$A->buffer(),0,2,$B->buffer(),0,3,0.0,$C->buffer(),0,3,
+            $rowBias->buffer(),0,1,rowBias:true);
+        $this->assertEquals([[11,11,6],[23,21,12]],$C->toArray());
+
+        // row bias and sigmoid, transposed A
+        $AT = $this->array([[1,3],[2,4]],dtype:NDArray::float32);
+        $rowBias = $this->array([-1,-3],dtype:NDArray::float32);
+        $C = $this->array(null,dtype:NDArray::float32,shape:[2,3]);
+        $math->gemmEpilogue(BLAS::RowMajor,BLAS::Trans,BLAS::NoTrans,2,3,2,
+            1.0,$AT->buffer(),0,2,$B->buffer(),0,3,0.0,$C->buffer(),0,3,
+            $rowBias->buffer(),0,1,rowBias:true,activation:'sigmoid');
+        $sigmoid = function($x) { return 1/(1+exp(-$x)); };
+        $this->assertEqualsWithDelta([
+            [0.5,0.5,$sigmoid(-5)],
+            [0.5,$sigmoid(-2),$sigmoid(-11)],
+        ],$C->toArray(),1e-6);
+
+        // ColMajor with a bias per column of C
+        $A = $this->array([1,3,2,4],dtype:NDArray::float64);
+        $B = $this->array([1,0,-1,1,0,-2],dtype:NDArray::float64);
+        $bias = $this->array([1,-10,0.5],dtype:NDArray::float64);
+        $C = $this->array(null,dtype:NDArray::float64,shape:[6]);
+        $math->gemmEpilogue(BLAS::ColMajor,BLAS::NoTrans,BLAS::NoTrans,2,3,2,
+            1.0,$A->buffer(),0,2,$B->buffer(),0,2,0.0,$C->buffer(),0,2,
+            $bias->buffer(),0,1);
+        $this->assertEquals([2,4,-9,-9,-3.5,-7.5],$C->toArray());
+
+        // gelu
+        $A = $this->array([[1]],dtype:NDArray::float64);
+        $B = $this->array([[-1,0,1]],dtype:NDArray::float64);
+        $C = $this->array(null,dtype:NDArray::float64,shape:[1,3]);
+        $math->gemmEpilogue(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,1,3,1,
+            1.0,$A->buffer(),0,1,$B->buffer(),0,3,0.0,$C->buffer(),0,3,
+            activation:'gelu');
+        $this->assertEqualsWithDelta([[-0.158808,0,0.841192]],$C->toArray(),1e-6);
+    }
+
+    public function testGemmEpilogueUnknownActivation()
+    {
+        $math = $this->getMath();
+
+        $A = $this->array([[1]],dtype:NDArray::float32);
+        $C = $this->array([[0]],dtype:NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unknown activation: swish');
+        $math->gemmEpilogue(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,1,1,1,
+            1.0,$A->buffer(),0,1,$A->buffer(),0,1,0.0,$C->buffer(),0,1,
+            activation:'swish');
+    }
+
+    public function testUnsupportedDtype()
+    {
+        $math = $this->getMath();
+
+        $X = $this->array(null,dtype:NDArray::complex64,shape:[3]);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unsuppored data type');
+        $math->exp(3,$X->buffer(),0,1);
+    }
+}
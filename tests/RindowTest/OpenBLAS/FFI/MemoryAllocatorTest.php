@@ -0,0 +1,93 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\MemoryAllocatorTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\AnonymousBuffer;
+use Rindow\OpenBLAS\FFI\MemoryAllocator;
+use InvalidArgumentException;
+use RuntimeException;
+use LogicException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class TestAllocator extends MemoryAllocator
+{
+    public function touchBuffer(AnonymousBuffer $buffer) : void
+    {
+        $this->touch($buffer);
+    }
+
+    protected function maxCount() : int
+    {
+        return 1000;
+    }
+}
+
+#[RequiresOperatingSystem('Linux|Darwin')]
+class MemoryAllocatorTest extends TestCase
+{
+    use Utils;
+
+    public function testAllocate()
+    {
+        $allocator = $this->factory->MemoryAllocator();
+        $X = $allocator->allocate(1000,NDArray::float64);
+        $this->assertInstanceOf(AnonymousBuffer::class,$X);
+        $this->assertCount(1000,$X);
+        $this->assertEquals(NDArray::float64,$X->dtype());
+        $this->assertEquals(0.0,$X[999]);
+
+        $blas = $this->getBlas();
+        $Y = $this->array([1,2,3],dtype:NDArray::float64);
+        $blas->axpy(3,2.0,$Y->buffer(),0,1,$X,10,1);
+        $this->assertEquals([0,2,4,6,0],array_slice(iterator_to_array($X),9,5));
+
+        $X->close();
+        $this->expectException(LogicException::class);
+        $X[0];
+    }
+
+    public function testTouchInChunks()
+    {
+        // blasint counts are split; here into calls of 1000 elements
+        $allocator = new TestAllocator($this->getBlas()->getFFI());
+        $X = new AnonymousBuffer(4096,NDArray::float32);
+        $X->load(str_repeat(pack('f',1.0),4096));
+        $allocator->touchBuffer($X);
+        $this->assertEquals(str_repeat("\0",4096*4),$X->dump());
+    }
+
+    public function testHugePagesAndNuma()
+    {
+        $allocator = $this->factory->MemoryAllocator();
+        $this->assertGreaterThanOrEqual(1,$allocator->numaNodes());
+
+        $size = 1<<20;
+        foreach([MemoryAllocator::NUMA_DEFAULT,MemoryAllocator::NUMA_LOCAL,MemoryAllocator::NUMA_INTERLEAVE] as $policy) {
+            $X = $allocator->allocate($size,NDArray::float32,
+                hugePages:AnonymousBuffer::HUGEPAGES_TRANSPARENT,
+                numaPolicy:$policy,firstTouch:true);
+            $this->assertEquals(AnonymousBuffer::HUGEPAGES_TRANSPARENT,$X->hugePages());
+            $this->assertEquals(0.0,$X[0]);
+            $this->assertEquals(0.0,$X[$size-1]);
+            $X[$size-1] = 1.5;
+            $this->assertEquals(1.5,$X[$size-1]);
+        }
+
+        // explicit huge pages only exist when they are reserved
+        try {
+            $X = $allocator->allocate(10,NDArray::float32,hugePages:AnonymousBuffer::HUGEPAGES_EXPLICIT);
+            $this->assertEquals(AnonymousBuffer::hugePageSize(),$X->mappedBytes());
+        } catch(RuntimeException $e) {
+            $this->assertStringContainsString('huge pages',$e->getMessage());
+        }
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('unknown NUMA policy: 9');
+        $allocator->allocate(10,numaPolicy:9);
+    }
+}
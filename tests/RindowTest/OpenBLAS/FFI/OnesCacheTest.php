@@ -0,0 +1,41 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\OnesCacheTest;
+
+use PHPUnit\Framework\TestCase;
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\OnesCache;
+use InvalidArgumentException;
+use FFI;
+
+class OnesCacheTest extends TestCase
+{
+    public function testAlignedAndGrowing()
+    {
+        $ffi = FFI::cdef('');
+        $cache = new OnesCache($ffi);
+        foreach([NDArray::float32, NDArray::float64] as $dtype) {
+            $ones = $cache->get(3,$dtype);
+            $this->assertEquals(0,$ffi->cast('uintptr_t',$ones)->cdata % OnesCache::ALIGNMENT);
+            $this->assertEquals(3,$cache->size($dtype));
+            $this->assertSame($ones,$cache->get(2,$dtype));
+
+            // grows by doubling
+            $ones = $cache->get(4,$dtype);
+            $this->assertEquals(6,$cache->size($dtype));
+            $this->assertEquals(0,$ffi->cast('uintptr_t',$ones)->cdata % OnesCache::ALIGNMENT);
+            for($i=0;$i<6;$i++) {
+                $this->assertEquals(1.0,$ones[$i]);
+            }
+            $cache->get(100,$dtype);
+            $this->assertEquals(100,$cache->size($dtype));
+        }
+    }
+
+    public function testUnsupportedDtype()
+    {
+        $cache = new OnesCache(FFI::cdef(''));
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unsuppored data type');
+        $cache->get(3,NDArray::int32);
+    }
+}
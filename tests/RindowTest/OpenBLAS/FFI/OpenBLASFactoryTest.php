@@ -0,0 +1,116 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\OpenBLASFactoryTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\DataProvider;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use InvalidArgumentException;
+use ReflectionProperty;
+
+class TestFactory extends OpenBLASFactory
+{
+    /**
+     * @return array{blas:array<string>,lapacke:array<string>,lapack:array<string>}
+     */
+    public function profileLibs(string $profile, ?bool $ilp64, ?string $suffix, string $arch) : array
+    {
+        return $this->threadingProfileLibs($profile, $ilp64, $suffix, $arch);
+    }
+
+    public function environmentThreading() : ?string
+    {
+        return $this->threadingFromEnvironment();
+    }
+}
+
+class OpenBLASFactoryTest extends TestCase
+{
+    public static function providerThreadingProfiles() : array
+    {
+        return [
+            'serial' => ['serial', 'libopenblas'],
+            'pthread' => ['pthread', 'libopenblasp'],
+            'openmp' => ['openmp', 'libopenblaso'],
+        ];
+    }
+
+    #[DataProvider('providerThreadingProfiles')]
+    public function testThreadingProfileLibsLP64(string $profile, string $rhel)
+    {
+        $factory = new TestFactory();
+        $libs = $factory->profileLibs($profile, false, null, 'x86_64');
+        $debian = "/usr/lib/x86_64-linux-gnu/openblas-{$profile}";
+        $this->assertEquals([
+            "{$debian}/libopenblas.so.0",
+            "/usr/lib64/{$rhel}.so.0",
+        ], $libs['blas']);
+        $this->assertEquals([
+            "{$debian}/libopenblas.so.0",
+            "/usr/lib64/{$rhel}.so.0",
+            'liblapacke.so.3',
+        ], $libs['lapacke']);
+        $this->assertEquals([
+            "{$debian}/liblapack.so.3",
+            "{$debian}/libopenblas.so.0",
+            "/usr/lib64/{$rhel}.so.0",
+        ], $libs['lapack']);
+    }
+
+    #[DataProvider('providerThreadingProfiles')]
+    public function testThreadingProfileLibsILP64(string $profile, string $rhel)
+    {
+        $factory = new TestFactory();
+        $libs = $factory->profileLibs($profile, true, '64_', 'aarch64');
+        $debian = "/usr/lib/aarch64-linux-gnu/openblas64-{$profile}";
+        $this->assertEquals([
+            "{$debian}/libopenblas64.so.0",
+            "/usr/lib64/{$rhel}64_.so.0",
+        ], $libs['blas']);
+        $this->assertEquals("{$debian}/liblapack64.so.3", $libs['lapack'][0]);
+
+        // the unsuffixed ILP64 builds
+        $libs = $factory->profileLibs($profile, true, null, 'x86_64');
+        $this->assertEquals("/usr/lib64/{$rhel}64.so.0", $libs['blas'][1]);
+    }
+
+    public function testThreadingProfileLibsMultiarch()
+    {
+        $factory = new TestFactory();
+        $this->assertEquals(
+            '/usr/lib/powerpc64le-linux-gnu/openblas-serial/libopenblas.so.0',
+            $factory->profileLibs('serial', false, null, 'ppc64le')['blas'][0]);
+        $this->assertEquals(
+            '/usr/lib/riscv64-linux-gnu/openblas-serial/libopenblas.so.0',
+            $factory->profileLibs('serial', false, null, 'riscv64')['blas'][0]);
+    }
+
+    public function testThreadingProfileLibsUnknownProfile()
+    {
+        $factory = new TestFactory();
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unknown threading profile: "pthraed"');
+        $factory->profileLibs('pthraed', false, null, 'x86_64');
+    }
+
+    public function testUnknownThreadingInEnvironmentIsReported()
+    {
+        $status = new ReflectionProperty(OpenBLASFactory::class, 'loadStatus');
+        $saved = $status->getValue();
+        $env = getenv('RINDOW_OPENBLAS_THREADING');
+        try {
+            putenv('RINDOW_OPENBLAS_THREADING=pthraed');
+            $factory = new TestFactory();
+            $this->assertNull($factory->environmentThreading());
+            $this->assertContains(
+                'Unknown threading profile in RINDOW_OPENBLAS_THREADING: "pthraed"',
+                $factory->errors());
+            $this->assertFalse($factory->loadStatus()['threading']['loaded']);
+
+            putenv('RINDOW_OPENBLAS_THREADING=openmp');
+            $this->assertEquals('openmp', $factory->environmentThreading());
+        } finally {
+            putenv(($env===false) ? 'RINDOW_OPENBLAS_THREADING' : "RINDOW_OPENBLAS_THREADING={$env}");
+            $status->setValue(null, $saved);
+        }
+    }
+}
@@ -0,0 +1,150 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\OutOfCoreGemmTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS;
+use Rindow\OpenBLAS\FFI\OpenBLASFactory;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+#[RequiresOperatingSystem('Linux|Darwin')]
+class OutOfCoreGemmTest extends TestCase
+{
+    use Utils;
+
+    /** @var array<string> */
+    protected array $files = [];
+
+    public function setUp() : void
+    {
+        $this->factory = new OpenBLASFactory();
+    }
+
+    public function tearDown() : void
+    {
+        foreach($this->files as $file) {
+            if(file_exists($file)) {
+                unlink($file);
+            }
+        }
+    }
+
+    protected function file(string $name, ?array $values=null, string $format='f') : string
+    {
+        $path = sys_get_temp_dir().'/rindow-openblas-ooc-'.getmypid().'-'.$name.'.bin';
+        $this->files[] = $path;
+        if($values!==null) {
+            file_put_contents($path, pack($format.'*', ...array_merge(...$values)));
+        }
+        return $path;
+    }
+
+    protected function read(string $path, int $m, int $n, int $offset=0, string $format='f') : array
+    {
+        $values = array_values(unpack($format.'*', file_get_contents($path), $offset));
+        return array_chunk(array_slice($values, 0, $m*$n), $n);
+    }
+
+    protected function product(array $A, array $B, float $alpha, float $beta, array $C) : array
+    {
+        foreach($C as $i => $row) {
+            foreach($row as $j => $value) {
+                $sum = 0.0;
+                foreach($B as $p => $rowB) {
+                    $sum += $A[$i][$p]*$rowB[$j];
+                }
+                $C[$i][$j] = $alpha*$sum + $beta*$value;
+            }
+        }
+        return $C;
+    }
+
+    public function testTileShape()
+    {
+        $gemm = $this->factory->OutOfCoreGemm(100);
+        $this->assertEquals([2,2,2],$gemm->tileShape(5,3,4,NDArray::float32));
+        $this->assertEquals([1,1,1],$gemm->tileShape(5,3,4,NDArray::float64));
+        $this->assertEquals([5,3,4],$this->factory->OutOfCoreGemm()->tileShape(5,3,4,NDArray::float32));
+    }
+
+    public function testGemm()
+    {
+        $A = [[1,2,3,4],[5,6,7,8],[9,10,11,12],[13,14,15,16],[17,18,19,20]];
+        $B = [[1,0,2],[0,1,3],[1,1,1],[2,0,1]];
+        $C = array_fill(0,5,[1,1,1]);
+        $fileA = $this->file('A',$A);
+        $fileB = $this->file('B',$B);
+        $fileC = $this->file('C',$C);
+
+        // 2x2x2 tiles
+        $gemm = $this->factory->OutOfCoreGemm(100);
+        $gemm->gemm(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,5,3,4,
+            2.0,$fileA,0,4,$fileB,0,3,0.5,$fileC,0,3);
+        $this->assertEquals($this->product($A,$B,2.0,0.5,$C),$this->read($fileC,5,3));
+
+        // transposed A behind a header row, a new file for C
+        $AT = [[0,0,0,0,0]];
+        foreach(range(0,3) as $p) {
+            $AT[] = array_column($A,$p);
+        }
+        $fileAT = $this->file('AT',$AT);
+        $fileD = $this->file('D');
+        $gemm->gemm(BLAS::RowMajor,BLAS::Trans,BLAS::NoTrans,5,3,4,
+            1.0,$fileAT,5,5,$fileB,0,3,0.0,$fileD,0,3,dtype:NDArray::float32);
+        $this->assertEquals($this->product($A,$B,1.0,0.0,$C),$this->read($fileD,5,3));
+    }
+
+    public function testTilesOfWideMatrixStayWithinBudget()
+    {
+        // rows of 256 floats (1KiB), of which a tile uses 2 at a time
+        $A = [];
+        foreach(range(0,4) as $i) {
+            $A[] = array_map(fn($p) => ($i+$p)%7-3, range(0,255));
+        }
+        $B = [];
+        foreach(range(0,255) as $p) {
+            $B[] = array_map(fn($j) => ($p*$j)%5-2, range(0,255));
+        }
+        $fileA = $this->file('A',$A);
+        $fileB = $this->file('B',$B);
+        $fileC = $this->file('C');
+
+        // only the first 4 columns of A and B and the first 3 of C are used
+        $budget = 100;
+        $gemm = $this->factory->OutOfCoreGemm($budget);
+        $gemm->gemm(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,5,3,4,
+            1.0,$fileA,0,256,$fileB,0,256,0.0,$fileC,0,3);
+        $this->assertGreaterThan(0,$gemm->peakBytes());
+        $this->assertLessThanOrEqual($budget,$gemm->peakBytes());
+
+        $a = array_map(fn($row) => array_slice($row,0,4),$A);
+        $b = array_map(fn($row) => array_slice($row,0,3),array_slice($B,0,4));
+        $this->assertEquals($this->product($a,$b,1.0,0.0,array_fill(0,5,[0,0,0])),
+            $this->read($fileC,5,3));
+    }
+
+    public function testGemmFloat64ColMajor()
+    {
+        // column major A(2x3) and B(3x2) are stored as their transposes
+        $AT = [[1,4],[2,5],[3,6]];
+        $BT = [[1,3,5],[2,4,6]];
+        $fileA = $this->file('A',$AT,'d');
+        $fileB = $this->file('B',$BT,'d');
+        $fileC = $this->file('C');
+        $gemm = $this->factory->OutOfCoreGemm(200);
+        $gemm->gemm(BLAS::ColMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,3,
+            1.0,$fileA,0,2,$fileB,0,3,0.0,$fileC,0,2,dtype:NDArray::float64);
+        // C = [[22,28],[49,64]] in column major
+        $this->assertEquals([[22,49],[28,64]],$this->read($fileC,2,2,0,'d'));
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Argument ldA must be greater than or equal 3.');
+        $gemm->gemm(BLAS::RowMajor,BLAS::NoTrans,BLAS::NoTrans,2,2,3,
+            1.0,$fileA,0,2,$fileB,0,3,0.0,$fileC,0,2,dtype:NDArray::float64);
+    }
+}
@@ -0,0 +1,84 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\PackFormatTest;
+
+use PHPUnit\Framework\TestCase;
+use PHPUnit\Framework\Attributes\DataProvider;
+use PHPUnit\Framework\Attributes\RequiresOperatingSystem;
+use Interop\Polite\Math\Matrix\NDArray;
+use Rindow\OpenBLAS\FFI\AnonymousBuffer;
+use Rindow\OpenBLAS\FFI\Utils;
+use InvalidArgumentException;
+
+class Values
+{
+    use Utils;
+
+    public function read(object $X, int $offset, int $count) : array
+    {
+        return $this->readValues($X, $offset, $count);
+    }
+
+    public function write(object $X, int $offset, array $values) : void
+    {
+        $this->writeValues($X, $offset, $values);
+    }
+
+    public function format(int $dtype) : array
+    {
+        return $this->packFormat($dtype);
+    }
+}
+
+#[RequiresOperatingSystem('Linux|Darwin')]
+class PackFormatTest extends TestCase
+{
+    public static function providerDtypes() : array
+    {
+        return [
+            'bool' => [NDArray::bool, [1, 0, 1]],
+            'int8' => [NDArray::int8, [-128, 0, 127]],
+            'uint8' => [NDArray::uint8, [0, 1, 255]],
+            'int16' => [NDArray::int16, [-32768, 0, 32767]],
+            'uint16' => [NDArray::uint16, [0, 1, 65535]],
+            'int32' => [NDArray::int32, [-2147483648, 0, 2147483647]],
+            'uint32' => [NDArray::uint32, [0, 1, 4294967295]],
+            'int64' => [NDArray::int64, [PHP_INT_MIN, 0, PHP_INT_MAX]],
+            'uint64' => [NDArray::uint64, [0, 1, PHP_INT_MAX]],
+            'float32' => [NDArray::float32, [-1.5, 0.0, 2.25]],
+            'float64' => [NDArray::float64, [-1.5, 0.0, 1e300]],
+        ];
+    }
+
+    #[DataProvider('providerDtypes')]
+    public function testRoundTrip(int $dtype, array $values)
+    {
+        $helper = new Values();
+        $X = new AnonymousBuffer(5, $dtype);
+        $this->assertEquals($X->value_size(), $helper->format($dtype)[1]);
+        $helper->write($X, 1, $values);
+        $this->assertEquals($values, $helper->read($X, 1, 3));
+        for($i=0; $i<3; $i++) {
+            $this->assertEquals($values[$i], $X[1+$i]);
+        }
+    }
+
+    public function testComplexParts()
+    {
+        $helper = new Values();
+        foreach([NDArray::complex64, NDArray::complex128] as $dtype) {
+            $X = new AnonymousBuffer(2, $dtype);
+            $this->assertEquals($X->value_size(), $helper->format($dtype)[1]);
+            $helper->write($X, 1, [1.5, -2.0]);
+            $this->assertEquals(1.5, $X[1]->real);
+            $this->assertEquals(-2.0, $X[1]->imag);
+            $this->assertEquals([0.0, 0.0, 1.5, -2.0], $helper->read($X, 0, 2));
+        }
+    }
+
+    public function testUnsupported()
+    {
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unsuppored data type');
+        (new Values())->format(0);
+    }
+}
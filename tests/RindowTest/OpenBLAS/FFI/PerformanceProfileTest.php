@@ -0,0 +1,56 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\PerformanceProfileTest;
+
+use PHPUnit\Framework\TestCase;
+use Rindow\OpenBLAS\FFI\PerformanceProfile;
+use RuntimeException;
+
+class PerformanceProfileTest extends TestCase
+{
+    protected string $path;
+
+    public function setUp() : void
+    {
+        $this->path = sys_get_temp_dir().'/rindow-openblas-profile-'.getmypid().'.json';
+        @unlink($this->path);
+    }
+
+    public function tearDown() : void
+    {
+        @unlink($this->path);
+    }
+
+    public function testDefaults()
+    {
+        $profile = new PerformanceProfile(['unknown'=>1]);
+        $this->assertEquals(PerformanceProfile::DEFAULTS,$profile->toArray());
+        $this->assertEquals(0,$profile->getInt('num_threads'));
+        $this->assertEquals('lapacke',$profile->get('lapack'));
+    }
+
+    public function testSaveAndLoad()
+    {
+        $key1 = PerformanceProfile::key('Haswell','OpenBLAS 0.3.26 DYNAMIC_ARCH');
+        $key2 = PerformanceProfile::key('Zen','OpenBLAS 0.3.26 DYNAMIC_ARCH');
+        $this->assertNull(PerformanceProfile::load($this->path,$key1));
+
+        PerformanceProfile::save($this->path,$key1,new PerformanceProfile(['num_threads'=>4]));
+        PerformanceProfile::save($this->path,$key2,new PerformanceProfile(['lapack'=>'lapack']));
+
+        $profile = PerformanceProfile::load($this->path,$key1);
+        $this->assertEquals(4,$profile->getInt('num_threads'));
+        $this->assertEquals('lapacke',$profile->get('lapack'));
+        $profile = PerformanceProfile::load($this->path,$key2);
+        $this->assertEquals(0,$profile->getInt('num_threads'));
+        $this->assertEquals('lapack',$profile->get('lapack'));
+        $this->assertNull(PerformanceProfile::load($this->path,'other'));
+    }
+
+    public function testBrokenFile()
+    {
+        file_put_contents($this->path,'{broken');
+        $this->expectException(RuntimeException::class);
+        $this->expectExceptionMessage('Broken profile');
+        PerformanceProfile::load($this->path,'key');
+    }
+}
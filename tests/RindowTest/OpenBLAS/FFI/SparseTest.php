@@ -0,0 +1,178 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\SparseTest;
+
+use PHPUnit\Framework\TestCase;
+
+use Interop\Polite\Math\Matrix\NDArray;
+use Interop\Polite\Math\Matrix\BLAS;
+use InvalidArgumentException;
+
+require_once __DIR__.'/Utils.php';
+use RindowTest\OpenBLAS\FFI\Utils;
+
+class SparseTest extends TestCase
+{
+    use Utils;
+
+    public function getSparse()
+    {
+        return $this->factory->Sparse();
+    }
+
+    /**
+     * [[1,0,2],
+     *  [0,0,3],
+     *  [4,5,0]] as CSR and CSC arrays
+     */
+    protected function matrix(string $format, int $dtype=NDArray::float32, int $indexType=NDArray::int32) : array
+    {
+        if($format=='csr') {
+            $values = [1,2,3,4,5];
+        } else {
+            $values = [1,4,5,2,3];
+        }
+        return [
+            $this->array($values,dtype:$dtype)->buffer(),
+            $this->array([0,2,2,0,1],dtype:$indexType)->buffer(),
+            $this->array([0,2,3,5],dtype:$indexType)->buffer(),
+        ];
+    }
+
+    public function testCsrmv()
+    {
+        $sparse = $this->getSparse();
+        [$values,$indices,$indptr] = $this->matrix('csr');
+
+        $X = $this->array([1,2,3],dtype:NDArray::float32);
+        $Y = $this->array([1,1,1],dtype:NDArray::float32);
+        $sparse->csrmv(BLAS::NoTrans,3,3,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+        $this->assertEquals([7,9,14],$Y->toArray());
+
+        $Y = $this->array([1,1,1],dtype:NDArray::float32);
+        $sparse->csrmv(BLAS::NoTrans,3,3,2.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,1.0,$Y->buffer(),0,1);
+        $this->assertEquals([15,19,29],$Y->toArray());
+
+        // transposed, strided Y
+        $Y = $this->array([0,9,0,9,0],dtype:NDArray::float32);
+        $sparse->csrmv(BLAS::Trans,3,3,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,2);
+        $this->assertEquals([13,9,15,9,8],$Y->toArray());
+    }
+
+    public function testCscmv()
+    {
+        $sparse = $this->getSparse();
+        [$values,$indices,$indptr] = $this->matrix('csc',NDArray::float64,NDArray::int64);
+
+        $X = $this->array([1,2,3],dtype:NDArray::float64);
+        $Y = $this->array([0,0,0],dtype:NDArray::float64);
+        $sparse->cscmv(BLAS::NoTrans,3,3,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+        $this->assertEquals([7,9,14],$Y->toArray());
+
+        $sparse->cscmv(BLAS::Trans,3,3,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+        $this->assertEquals([13,15,8],$Y->toArray());
+    }
+
+    public function testCsrmmAndCscmm()
+    {
+        $sparse = $this->getSparse();
+        $B = $this->array([[1,0],[0,1],[1,1]],dtype:NDArray::float32);
+
+        foreach(['csr','csc'] as $format) {
+            [$values,$indices,$indptr] = $this->matrix($format);
+            $func = $format.'mm';
+
+            $C = $this->array([[9,9],[9,9],[9,9]],dtype:NDArray::float32);
+            $sparse->$func(BLAS::NoTrans,3,2,3,1.0,$values,0,$indices,0,$indptr,0,
+                $B->buffer(),0,2,0.0,$C->buffer(),0,2);
+            $this->assertEquals([[3,2],[3,3],[4,5]],$C->toArray());
+
+            $C = $this->array([[1,1],[1,1],[1,1]],dtype:NDArray::float32);
+            $sparse->$func(BLAS::Trans,3,2,3,1.0,$values,0,$indices,0,$indptr,0,
+                $B->buffer(),0,2,2.0,$C->buffer(),0,2);
+            $this->assertEquals([[7,6],[7,7],[4,5]],$C->toArray());
+        }
+    }
+
+    public function testRectangular()
+    {
+        $sparse = $this->getSparse();
+        // [[0,1,0,2],
+        //  [3,0,0,0]]
+        $values = $this->array([1,2,3],dtype:NDArray::float32)->buffer();
+        $indices = $this->array([1,3,0],dtype:NDArray::int32)->buffer();
+        $indptr = $this->array([0,2,3],dtype:NDArray::int32)->buffer();
+
+        $X = $this->array([1,2,3,4],dtype:NDArray::float32);
+        $Y = $this->array([0,0],dtype:NDArray::float32);
+        $sparse->csrmv(BLAS::NoTrans,2,4,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+        $this->assertEquals([10,3],$Y->toArray());
+
+        $B = $this->array([[1,2,3],[4,5,6],[7,8,9],[1,1,1]],dtype:NDArray::float32);
+        $C = $this->array(null,dtype:NDArray::float32,shape:[2,3]);
+        $sparse->csrmm(BLAS::NoTrans,2,3,4,1.0,$values,0,$indices,0,$indptr,0,
+            $B->buffer(),0,3,0.0,$C->buffer(),0,3);
+        $this->assertEquals([[6,7,8],[3,6,9]],$C->toArray());
+    }
+
+    public function testPreparedMatrix()
+    {
+        $sparse = $this->getSparse();
+        foreach(['csr','csc'] as $format) {
+            [$values,$indices,$indptr] = $this->matrix($format,NDArray::float64);
+            $A = $sparse->$format(3,3,$values,0,$indices,0,$indptr,0);
+            $this->assertEquals(5,$A->nnz());
+            $this->assertEquals(NDArray::float64,$A->dtype());
+            // the values are copied when the matrix is prepared
+            $values[0] = 100.0;
+
+            $X = $this->array([1,2,3],dtype:NDArray::float64);
+            $Y = $this->array([0,0,0],dtype:NDArray::float64);
+            foreach([[BLAS::NoTrans,[7,9,14]],[BLAS::Trans,[13,15,8]]] as [$trans,$expected]) {
+                $sparse->mv($trans,1.0,$A,$X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+                $this->assertEquals($expected,$Y->toArray());
+            }
+
+            // B is wider than n, so ldB > n
+            $B = $this->array([[1,0,5,0],[0,1,5,0],[1,1,5,0]],dtype:NDArray::float64);
+            $C = $this->array([[1,1,1],[1,1,1],[1,1,1]],dtype:NDArray::float64);
+            $sparse->mm(BLAS::NoTrans,3,1.0,$A,$B->buffer(),0,4,0.5,$C->buffer(),0,3);
+            $this->assertEquals([[3.5,2.5,15.5],[3.5,3.5,15.5],[4.5,5.5,45.5]],$C->toArray());
+        }
+
+        // [[0,0],[0,2]] has an empty row and an empty column
+        $A = $sparse->csr(2,2,
+            $this->array([2],dtype:NDArray::float32)->buffer(),0,
+            $this->array([1],dtype:NDArray::int32)->buffer(),0,
+            $this->array([0,0,1],dtype:NDArray::int32)->buffer(),0);
+        $X = $this->array([1,3],dtype:NDArray::float32);
+        $Y = $this->array([4,4],dtype:NDArray::float32);
+        $sparse->mv(BLAS::Trans,1.0,$A,$X->buffer(),0,1,2.0,$Y->buffer(),0,1);
+        $this->assertEquals([8,14],$Y->toArray());
+
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('Unmatch data type for values and X and Y');
+        $Z = $this->array([1,3],dtype:NDArray::float64);
+        $sparse->mv(BLAS::NoTrans,1.0,$A,$Z->buffer(),0,1,0.0,$Y->buffer(),0,1);
+    }
+
+    public function testIndexOutOfRange()
+    {
+        $sparse = $this->getSparse();
+        $values = $this->array([1,2],dtype:NDArray::float32)->buffer();
+        $indices = $this->array([0,3],dtype:NDArray::int32)->buffer();
+        $indptr = $this->array([0,1,2],dtype:NDArray::int32)->buffer();
+
+        $X = $this->array([1,2,3],dtype:NDArray::float32);
+        $Y = $this->array([0,0],dtype:NDArray::float32);
+        $this->expectException(InvalidArgumentException::class);
+        $this->expectExceptionMessage('indices out of range.');
+        $sparse->csrmv(BLAS::NoTrans,2,3,1.0,$values,0,$indices,0,$indptr,0,
+            $X->buffer(),0,1,0.0,$Y->buffer(),0,1);
+    }
+}
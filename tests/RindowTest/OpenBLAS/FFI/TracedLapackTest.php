@@ -0,0 +1,15 @@
+<?php
+namespace RindowTest\OpenBLAS\FFI\TracedLapackTest;
+
+require_once __DIR__.'/LapackbTest.php';
+use RindowTest\OpenBLAS\FFI\LapackbTest\LapackbTest;
+use Rindow\OpenBLAS\FFI\CallTracer;
+
+class TracedLapackTest extends LapackbTest
+{
+    public function getLapack()
+    {
+        $lapack = $this->factory->TracedLapack(new CallTracer('php://memory'));
+        return $lapack;
+    }
+}